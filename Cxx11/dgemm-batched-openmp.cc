@@ -0,0 +1,212 @@
+///
+/// Copyright (c) 2017, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+//////////////////////////////////////////////////////////////////////
+///
+/// NAME:    dgemm-batched-openmp
+///
+/// PURPOSE: This program tests the efficiency with which a batch of
+///          small dense matrix-matrix multiplications is carried out
+///
+/// USAGE:   The program takes as input the matrix order,
+///          the number of times the batch of matrix-matrix
+///          multiplications is carried out, and the number of
+///          matrices in the batch
+///
+///          <progname> <# iterations> <matrix order> <batches>
+///
+///          The output consists of diagnostics to make sure the
+///          algorithm worked, and of timing statistics.
+///
+/// FUNCTIONS CALLED:
+///
+///          Other than OpenMP or standard C functions, the following
+///          functions are used in this program:
+///
+///          wtime()
+///
+/// HISTORY: Written by Rob Van der Wijngaart, February 2009.
+///          Converted to C++11 by Jeff Hammond, December, 2017.
+///          Native batched version with an interleaved batch layout.
+///
+//////////////////////////////////////////////////////////////////////
+
+#include "prk_util.h"
+#include "prk_dgemm.h"
+
+int main(int argc, char * argv[])
+{
+  //////////////////////////////////////////////////////////////////////
+  /// Read and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+#ifdef _OPENMP
+  std::cout << "C++11/OpenMP Batched dense matrix-matrix multiplication: C += A x B" << std::endl;
+#else
+  std::cout << "C++11 Batched dense matrix-matrix multiplication: C += A x B" << std::endl;
+#endif
+
+  int iterations;
+  int order;
+  int batches;
+  try {
+      if (argc < 4) {
+        throw "Usage: <# iterations> <matrix order> <batches>";
+      }
+
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      order = std::atoi(argv[2]);
+      if (order <= 0) {
+        throw "ERROR: Matrix Order must be greater than 0";
+      } else if (order > std::floor(std::sqrt(INT_MAX))) {
+        throw "ERROR: matrix dimension too large - overflow risk";
+      }
+
+      batches = std::atoi(argv[3]);
+      if (batches <= 0) {
+        throw "ERROR: batches must be greater than 0";
+      }
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  // PRK_DGEMM_ISA=none|avx2|avx512 caps the runtime ISA selection
+  const std::string isa = prk::dgemm_isa();
+  auto dgemm_batch = prk::make_dgemm_batch(order, isa);
+
+  // the last group of lanes is padded with zero matrices
+  const int L = prk::dgemm_batch_lanes;
+  const int groups = prk::divceil(batches, L);
+  const size_t group_size = static_cast<size_t>(order)*order*L;
+
+#ifdef _OPENMP
+  std::cout << "Number of threads    = " << omp_get_max_threads() << std::endl;
+#endif
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Matrix order         = " << order << std::endl;
+  std::cout << "Batch size           = " << batches << " (" << groups << " groups of " << L << ")" << std::endl;
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+  std::cout << "Specialized kernel   = " << (prk::dgemm_batch_specialized(order) ? "yes" : "no") << std::endl;
+
+  //////////////////////////////////////////////////////////////////////
+  /// Allocate space for matrices
+  //////////////////////////////////////////////////////////////////////
+
+  prk::bench::timer dgemm_time(iterations);
+  prk::bench::record record("dgemm", "batched", dgemm_time);
+  record.param("order", order).param("batches", batches).param("isa", isa).param("alloc", prk::alloc::name());
+
+  double * RESTRICT A = prk::malloc<double>(groups*group_size);
+  double * RESTRICT B = prk::malloc<double>(groups*group_size);
+  double * RESTRICT C = prk::malloc<double>(groups*group_size);
+
+  OMP_PARALLEL()
+  {
+    // every thread first touches the groups it multiplies
+    OMP_FOR()
+    for (auto g=0; g<groups; ++g) {
+      for (auto l=0; l<L; ++l) {
+        const size_t b = static_cast<size_t>(g)*L + l;
+        for (auto i=0; i<order; ++i) {
+          for (auto j=0; j<order; ++j) {
+            const auto ij = prk::dgemm_batch_index(order, b, i, j);
+            A[ij] = (b < static_cast<size_t>(batches)) ? i : 0.0;
+            B[ij] = (b < static_cast<size_t>(batches)) ? i : 0.0;
+            C[ij] = 0.0;
+          }
+        }
+      }
+    }
+
+    while (true) {
+      OMP_BARRIER
+      OMP_MASTER
+      dgemm_time.next();
+      OMP_BARRIER
+      if (!dgemm_time.running()) break;
+
+      OMP_FOR()
+      for (auto g=0; g<groups; ++g) {
+        dgemm_batch(order, &A[g*group_size], &B[g*group_size], &C[g*group_size]);
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  /// Analyze and output results
+  //////////////////////////////////////////////////////////////////////
+
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = dgemm_time.applications() - 1;
+
+  const double epsilon = 1.0e-8;
+  const double forder = static_cast<double>(order);
+  const double reference = 0.25 * std::pow(forder,3) * std::pow(forder-1.0,2) * (iterations+1);
+  double residuum(0);
+  for (auto b=0; b<batches; ++b) {
+      double checksum(0);
+      for (auto i=0; i<order; ++i) {
+        for (auto j=0; j<order; ++j) {
+          checksum += C[prk::dgemm_batch_index(order, b, i, j)];
+        }
+      }
+      residuum += (order > 1) ? std::abs(checksum-reference)/reference : std::abs(checksum);
+  }
+  residuum/=batches;
+
+  prk::free(A);
+  prk::free(B);
+  prk::free(C);
+
+  if (residuum < epsilon) {
+    std::cout << "Solution validates" << std::endl;
+    auto avgtime = dgemm_time.mean()/batches;
+    auto nflops = 2.0 * std::pow(forder,3);
+    std::cout << "Rate (MF/s): " << 1.0e-6 * nflops/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    std::cout << dgemm_time << std::endl;
+    prk::roofline::report(prk::roofline::dgemm(order), avgtime);
+    record.validated("MF/s", 1.0e-6 * nflops/avgtime);
+  } else {
+    std::cout << "Reference checksum = " << reference << "\n"
+              << "Residuum           = " << residuum << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
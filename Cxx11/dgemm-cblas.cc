@@ -252,7 +252,9 @@ int main(int argc, char * argv[])
   /// Allocate space for matrices
   //////////////////////////////////////////////////////////////////////
 
-  double dgemm_time(0);
+  prk::bench::timer dgemm_time(iterations);
+  prk::bench::record record("dgemm", "cblas", dgemm_time);
+  record.param("order", order).param("batches", batches);
 
   const int matrices = (batches==0 ? 1 : abs(batches));
 
@@ -281,10 +283,7 @@ int main(int argc, char * argv[])
   }
 
   {
-    for (int iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) dgemm_time = prk::wtime();
-
+    while (dgemm_time.next()) {
       if (batches == 0) {
           prk_dgemm(order, A[0], B[0], C[0]);
       } else if (batches < 0) {
@@ -293,13 +292,15 @@ int main(int argc, char * argv[])
           prk_dgemm(order, matrices, pA, pB, pC);
       }
     }
-    dgemm_time = prk::wtime() - dgemm_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = dgemm_time.applications() - 1;
+
   const double epsilon = 1.0e-8;
   const double forder = static_cast<double>(order);
   const double reference = 0.25 * std::pow(forder,3) * std::pow(forder-1.0,2) * (iterations+1);
@@ -316,10 +317,13 @@ int main(int argc, char * argv[])
               << "Actual checksum = " << checksum << std::endl;
 #endif
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = dgemm_time/iterations/matrices;
+    auto avgtime = dgemm_time.mean()/matrices;
     auto nflops = 2.0 * std::pow(forder,3);
     std::cout << "Rate (MF/s): " << 1.0e-6 * nflops/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << dgemm_time << std::endl;
+    prk::roofline::report(prk::roofline::dgemm(order), avgtime);
+    record.validated("MF/s", 1.0e-6 * nflops/avgtime);
   } else {
     std::cout << "Reference checksum = " << reference << "\n"
               << "Residuum           = " << residuum << std::endl;
@@ -0,0 +1,211 @@
+///
+/// Copyright (c) 2017, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+//////////////////////////////////////////////////////////////////////
+///
+/// NAME:    dgemm-vector-thread
+///
+/// PURPOSE: This program tests the efficiency with which a dense matrix
+///          dense multiplication is carried out
+///
+/// USAGE:   The program takes as input the matrix order,
+///          the number of times the matrix-matrix multiplication
+///          is carried out, and, optionally, a tile size for matrix
+///          blocking
+///
+///          <progname> <# iterations> <matrix order> [<tile size>]
+///
+///          The output consists of diagnostics to make sure the
+///          algorithm worked, and of timing statistics.
+///
+/// FUNCTIONS CALLED:
+///
+///          Other than OpenMP or standard C functions, the following
+///          functions are used in this program:
+///
+///          wtime()
+///
+/// HISTORY: Written by Rob Van der Wijngaart, February 2009.
+///          Converted to C++11 by Jeff Hammond, December, 2017.
+///          Thread pool version of the packed engine.
+///
+//////////////////////////////////////////////////////////////////////
+
+#include "prk_util.h"
+#include "prk_thread.h"
+#include "prk_dgemm.h"
+
+int main(int argc, char * argv[])
+{
+  //////////////////////////////////////////////////////////////////////
+  /// Read and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+  std::cout << "C++11/Threads Dense matrix-matrix multiplication: C += A x B" << std::endl;
+
+  int iterations;
+  int order;
+  int tile_size;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <matrix order> [tile size]";
+      }
+
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      order = std::atoi(argv[2]);
+      if (order <= 0) {
+        throw "ERROR: Matrix Order must be greater than 0";
+      } else if (order > std::floor(std::sqrt(INT_MAX))) {
+        throw "ERROR: matrix dimension too large - overflow risk";
+      }
+
+      tile_size = (argc>3) ? std::atoi(argv[3]) : 32;
+      if (tile_size <= 0) tile_size = order;
+
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  // PRK_NUM_THREADS workers are started once and reused for every iteration
+  prk::thread_pool pool;
+  const int num_threads = pool.size();
+
+  std::cout << "Number of threads    = " << num_threads << std::endl;
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
+  std::cout << "Matrix order         = " << order << std::endl;
+
+  // the tiled driver uses the packed engine unless PRK_DGEMM_PACKED=0
+  const bool packed = (tile_size < order) && (prk::bench::getenv_int("PRK_DGEMM_PACKED",1) != 0);
+  const std::string isa = packed ? prk::dgemm_isa() : std::string("none");
+  // PRK_DGEMM_GROUPS threads groups share the panels of B, one per NUMA node by default
+  const int groups = prk::bench::getenv_int("PRK_DGEMM_GROUPS", prk::alloc::numa_nodes());
+  prk::dgemm_packed dgemm_packed(isa, num_threads, groups);
+  if (packed) {
+      std::cout << "Packed micro-kernel  = " << isa << std::endl;
+      std::cout << "Register block       = " << dgemm_packed.mr() << "x" << dgemm_packed.nr() << std::endl;
+      std::cout << "Cache blocks         = " << dgemm_packed.mc() << "," << dgemm_packed.kc() << "," << dgemm_packed.nc() << " (MC,KC,NC)" << std::endl;
+      std::cout << "Thread groups        = " << dgemm_packed.groups() << std::endl;
+  } else if (tile_size < order) {
+      std::cout << "Tile size            = " << tile_size << std::endl;
+  } else {
+      std::cout << "Untiled (IKJ loop order)" << std::endl;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  /// Allocate space for matrices
+  //////////////////////////////////////////////////////////////////////
+
+  prk::bench::timer dgemm_time(iterations);
+  prk::bench::record record("dgemm", "thread", dgemm_time);
+  record.param("order", order).param("tile_size", tile_size).threads(num_threads).param("pinned", (pool.pinned() ? "yes" : "no")).param("alloc", prk::alloc::name()).param("packed", (packed ? isa : std::string("no")));
+  if (packed) record.param("groups", dgemm_packed.groups());
+
+  prk::vector<double> A(order*order, prk::uninitialized);
+  prk::vector<double> B(order*order, prk::uninitialized);
+  prk::vector<double> C(order*order,0.0);
+  for (auto i=0; i<order; ++i) {
+    for (auto j=0; j<order; ++j) {
+       A[i*order+j] = i;
+       B[i*order+j] = i;
+    }
+  }
+
+  // one task per rank; the pool joins them before the next phase
+  auto for_all = [&pool,num_threads](const auto & f) {
+    pool.parallel_for(0, num_threads, f);
+  };
+
+  {
+    while (dgemm_time.next()) {
+      if (packed) {
+          dgemm_packed(for_all, order, order, order, A.data(), order, B.data(), order, C.data(), order);
+      } else {
+          // rows of C are independent; the untiled loop is split by rows
+          const auto grain = (tile_size < order) ? tile_size : 1;
+          pool.parallel_for(prk::blocked_range(0, order, grain), [&](const prk::blocked_range & r) {
+            for (auto kt=0; kt<order; kt+=tile_size) {
+              const auto kend = std::min(order,kt+tile_size);
+              for (auto i=r.begin(); i<r.end(); ++i) {
+                for (auto k=kt; k<kend; ++k) {
+                  PRAGMA_SIMD
+                  for (auto j=0; j<order; ++j) {
+                    C[i*order+j] += A[i*order+k] * B[k*order+j];
+                  }
+                }
+              }
+            }
+          });
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  /// Analyze and output results
+  //////////////////////////////////////////////////////////////////////
+
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = dgemm_time.applications() - 1;
+
+  const auto forder = static_cast<double>(order);
+  const auto reference = 0.25 * std::pow(forder,3) * std::pow(forder-1.0,2) * (iterations+1);
+  const auto checksum = prk::reduce(C.begin(), C.end(), 0.0);
+
+  const auto epsilon = 1.0e-8;
+  const auto residuum = std::abs(checksum-reference)/reference;
+  if (residuum < epsilon) {
+#if VERBOSE
+    std::cout << "Reference checksum = " << reference << "\n"
+              << "Actual checksum = " << checksum << std::endl;
+#endif
+    std::cout << "Solution validates" << std::endl;
+    auto avgtime = dgemm_time.mean();
+    auto nflops = 2.0 * std::pow(forder,3);
+    std::cout << "Rate (MF/s): " << 1.0e-6 * nflops/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    std::cout << dgemm_time << std::endl;
+    prk::roofline::report(prk::roofline::dgemm(order), avgtime);
+    record.validated("MF/s", 1.0e-6 * nflops/avgtime);
+  } else {
+    std::cout << "Reference checksum = " << reference << "\n"
+              << "Actual checksum = " << checksum << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -154,7 +154,9 @@ int main(int argc, char * argv[])
   /// Allocate space for matrices
   //////////////////////////////////////////////////////////////////////
 
-  double dgemm_time(0);
+  prk::bench::timer dgemm_time(iterations);
+  prk::bench::record record("dgemm", "vector", dgemm_time);
+  record.param("order", order).param("tile_size", tile_size);
 
   std::vector<double> A(order*order);
   std::vector<double> B(order*order);
@@ -167,23 +169,22 @@ int main(int argc, char * argv[])
   }
 
   {
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) dgemm_time = prk::wtime();
-
+    while (dgemm_time.next()) {
       if (tile_size < order) {
           prk_dgemm(order, tile_size, A, B, C);
       } else {
           prk_dgemm(order, A, B, C);
       }
     }
-    dgemm_time = prk::wtime() - dgemm_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = dgemm_time.applications() - 1;
+
   const auto forder = static_cast<double>(order);
   const auto reference = 0.25 * std::pow(forder,3) * std::pow(forder-1.0,2) * (iterations+1);
   const auto checksum = prk::reduce(C.begin(), C.end(), 0.0);
@@ -196,10 +197,13 @@ int main(int argc, char * argv[])
               << "Actual checksum = " << checksum << std::endl;
 #endif
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = dgemm_time/iterations;
+    auto avgtime = dgemm_time.mean();
     auto nflops = 2.0 * std::pow(forder,3);
     std::cout << "Rate (MF/s): " << 1.0e-6 * nflops/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << dgemm_time << std::endl;
+    prk::roofline::report(prk::roofline::dgemm(order), avgtime);
+    record.validated("MF/s", 1.0e-6 * nflops/avgtime);
   } else {
     std::cout << "Reference checksum = " << reference << "\n"
               << "Actual checksum = " << checksum << std::endl;
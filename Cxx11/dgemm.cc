@@ -59,6 +59,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
+#include "prk_dgemm.h"
 
 void prk_dgemm(const int order,
                const prk::vector<double> & A,
@@ -143,8 +144,15 @@ int main(int argc, char * argv[])
   }
 
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order         = " << order << std::endl;
-  if (tile_size < order) {
+
+  // the tiled driver uses the packed engine unless PRK_DGEMM_PACKED=0
+  const bool packed = (tile_size < order) && (prk::bench::getenv_int("PRK_DGEMM_PACKED",1) != 0);
+  const std::string isa = packed ? prk::dgemm_isa() : std::string("none");
+  if (packed) {
+      std::cout << "Packed micro-kernel  = " << isa << std::endl;
+  } else if (tile_size < order) {
       std::cout << "Tile size            = " << tile_size << std::endl;
   } else {
       std::cout << "Untiled (IKJ loop order)" << std::endl;
@@ -154,10 +162,12 @@ int main(int argc, char * argv[])
   /// Allocate space for matrices
   //////////////////////////////////////////////////////////////////////
 
-  double dgemm_time(0);
+  prk::bench::timer dgemm_time(iterations);
+  prk::bench::record record("dgemm", "seq", dgemm_time);
+  record.param("order", order).param("tile_size", tile_size).param("alloc", prk::alloc::name()).param("packed", (packed ? isa : std::string("no")));
 
-  prk::vector<double> A(order*order);
-  prk::vector<double> B(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
+  prk::vector<double> B(order*order, prk::uninitialized);
   prk::vector<double> C(order*order,0.0);
   for (auto i=0; i<order; ++i) {
     for (auto j=0; j<order; ++j) {
@@ -166,24 +176,31 @@ int main(int argc, char * argv[])
     }
   }
 
-  {
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) dgemm_time = prk::wtime();
+  prk::dgemm_packed dgemm_packed(isa);
+  if (packed) {
+      std::cout << "Register block       = " << dgemm_packed.mr() << "x" << dgemm_packed.nr() << std::endl;
+      std::cout << "Cache blocks         = " << dgemm_packed.mc() << "," << dgemm_packed.kc() << "," << dgemm_packed.nc() << " (MC,KC,NC)" << std::endl;
+  }
 
-      if (tile_size < order) {
+  {
+    while (dgemm_time.next()) {
+      if (packed) {
+          dgemm_packed(order, order, order, A.data(), order, B.data(), order, C.data(), order);
+      } else if (tile_size < order) {
           prk_dgemm(order, tile_size, A, B, C);
       } else {
           prk_dgemm(order, A, B, C);
       }
     }
-    dgemm_time = prk::wtime() - dgemm_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = dgemm_time.applications() - 1;
+
   const auto forder = static_cast<double>(order);
   const auto reference = 0.25 * std::pow(forder,3) * std::pow(forder-1.0,2) * (iterations+1);
   const auto checksum = prk::reduce(C.begin(), C.end(), 0.0);
@@ -196,10 +213,13 @@ int main(int argc, char * argv[])
               << "Actual checksum = " << checksum << std::endl;
 #endif
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = dgemm_time/iterations;
+    auto avgtime = dgemm_time.mean();
     auto nflops = 2.0 * std::pow(forder,3);
     std::cout << "Rate (MF/s): " << 1.0e-6 * nflops/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << dgemm_time << std::endl;
+    prk::roofline::report(prk::roofline::dgemm(order), avgtime);
+    record.validated("MF/s", 1.0e-6 * nflops/avgtime);
   } else {
     std::cout << "Reference checksum = " << reference << "\n"
               << "Actual checksum = " << checksum << std::endl;
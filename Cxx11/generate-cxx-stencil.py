@@ -200,7 +200,9 @@ def instance(src,model,pattern,r):
     codegen(src,pattern,stencil_size,r,W,model)
 
 def main():
-    for model in ['seq','vector','rangefor','stl','pgnu','pstl','openmp','taskloop','target','tbb','raja','rajaview','kokkos','cuda']:
+    # The host backends (seq, vector, rangefor, stl, pgnu, pstl, openmp, taskloop, tbb)
+    # use the template engine in prk_stencil.h instead of generated code.
+    for model in ['target','raja','rajaview','kokkos','cuda']:
       src = open('stencil_'+model+'.hpp','w')
       if (model=='target'):
           src.write('#define RESTRICT __restrict__\n\n')
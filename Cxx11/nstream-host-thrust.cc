@@ -109,7 +109,9 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto nstream_time = 0.0;
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "thrust", nstream_time);
+  record.param("length", length).param("offset", offset);
 
   thrust::host_vector<double> A(length);
   thrust::host_vector<double> B(length);
@@ -125,22 +127,21 @@ int main(int argc, char * argv[])
         thrust::get<0>(t) +=  thrust::get<1>(t) + scalar * thrust::get<2>(t);
     };
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) nstream_time = prk::wtime();
-
+    while (nstream_time.next()) {
       thrust::for_each( thrust::host,
                         thrust::make_zip_iterator(thrust::make_tuple(A.begin(), B.begin(), C.begin())),
                         thrust::make_zip_iterator(thrust::make_tuple(A.end()  , B.end()  , C.end())),
                         nstream);
     }
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -166,10 +167,13 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
+      double avgtime = nstream_time.mean();
       double nbytes = 4.0 * length * sizeof(double);
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
@@ -64,64 +64,31 @@
 
 #include "prk_util.h"
 
-int main(int argc, char * argv[])
+template <typename TI, typename TO>
+int run(int iterations, size_t length, int offset)
 {
-  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
-#ifdef _OPENMP
-  std::cout << "C++11/OpenMP STREAM triad: A = B + scalar * C" << std::endl;
-#else
-  std::cout << "C++11 STREAM triad: A = B + scalar * C" << std::endl;
-#endif
-
-  //////////////////////////////////////////////////////////////////////
-  /// Read and test input parameters
-  //////////////////////////////////////////////////////////////////////
-
-  int iterations, offset;
-  size_t length;
-  try {
-      if (argc < 3) {
-        throw "Usage: <# iterations> <vector length>";
-      }
-
-      iterations  = std::atoi(argv[1]);
-      if (iterations < 1) {
-        throw "ERROR: iterations must be >= 1";
-      }
-
-      length = std::atol(argv[2]);
-      if (length <= 0) {
-        throw "ERROR: vector length must be positive";
-      }
-
-      offset = (argc>3) ? std::atoi(argv[3]) : 0;
-      if (length <= 0) {
-        throw "ERROR: offset must be nonnegative";
-      }
-  }
-  catch (const char * e) {
-    std::cout << e << std::endl;
-    return 1;
-  }
-
 #ifdef _OPENMP
   std::cout << "Number of threads    = " << omp_get_max_threads() << std::endl;
 #endif
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Vector length        = " << length << std::endl;
   std::cout << "Offset               = " << offset << std::endl;
+  std::cout << "Precision            = " << prk::precision::name<TI,TO>() << std::endl;
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto nstream_time = 0.0;
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "openmp", nstream_time);
+  record.param("length", length).param("offset", offset).param("alloc", prk::alloc::name()).param("precision", prk::precision::name<TI,TO>());
 
-  double * RESTRICT A = new double[length];
-  double * RESTRICT B = new double[length];
-  double * RESTRICT C = new double[length];
+  TO * RESTRICT A = prk::malloc<TO>(length);
+  TI * RESTRICT B = prk::malloc<TI>(length);
+  TI * RESTRICT C = prk::malloc<TI>(length);
 
-  double scalar = 3.0;
+  TO scalar = 3.0;
 
   OMP_PARALLEL()
   {
@@ -132,28 +99,27 @@ int main(int argc, char * argv[])
       C[i] = 2.0;
     }
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) {
-          OMP_BARRIER
-          OMP_MASTER
-          nstream_time = prk::wtime();
-      }
+    while (true) {
+      OMP_BARRIER
+      OMP_MASTER
+      nstream_time.next();
+      OMP_BARRIER
+      if (!nstream_time.running()) break;
 
       OMP_FOR_SIMD
       for (size_t i=0; i<length; i++) {
           A[i] += B[i] + scalar * C[i];
       }
     }
-    OMP_BARRIER
-    OMP_MASTER
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -169,7 +135,7 @@ int main(int argc, char * argv[])
       asum += std::fabs(A[i]);
   }
 
-  double epsilon=1.e-8;
+  double epsilon = prk::precision::epsilon<TO>(1.e-8, 1.0);
   if (std::fabs(ar-asum)/asum > epsilon) {
       std::cout << "Failed Validation on output array\n"
                 << "       Expected checksum: " << ar << "\n"
@@ -178,13 +144,66 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
-      double nbytes = 4.0 * length * sizeof(double);
+      double avgtime = nstream_time.mean();
+      double word = (2.0*sizeof(TO) + 2.0*sizeof(TI)) / 4.0;
+      double nbytes = 4.0 * length * word;
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length, word), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
 }
 
+int main(int argc, char * argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+#ifdef _OPENMP
+  std::cout << "C++11/OpenMP STREAM triad: A = B + scalar * C" << std::endl;
+#else
+  std::cout << "C++11 STREAM triad: A = B + scalar * C" << std::endl;
+#endif
+
+  //////////////////////////////////////////////////////////////////////
+  /// Read and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations, offset;
+  size_t length;
+  prk::precision::kind precision;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <vector length>";
+      }
+
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
 
+      length = std::atol(argv[2]);
+      if (length <= 0) {
+        throw "ERROR: vector length must be positive";
+      }
+
+      offset = (argc>3) ? std::atoi(argv[3]) : 0;
+      if (length <= 0) {
+        throw "ERROR: offset must be nonnegative";
+      }
+
+      // PRK_PRECISION=double|float|mixed
+      precision = prk::precision::get();
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  switch (precision) {
+    case prk::precision::kind::fp32:  return run<float,float>(iterations, length, offset);
+    case prk::precision::kind::mixed: return run<float,double>(iterations, length, offset);
+    default:                          return run<double,double>(iterations, length, offset);
+  }
+}
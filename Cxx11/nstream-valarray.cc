@@ -109,7 +109,9 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto nstream_time = 0.0;
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "valarray", nstream_time);
+  record.param("length", length).param("offset", offset);
 
   std::valarray<double> A(0.0,length);
   std::valarray<double> B(2.0,length);
@@ -118,19 +120,18 @@ int main(int argc, char * argv[])
   double scalar = 3.0;
 
   {
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) nstream_time = prk::wtime();
-
+    while (nstream_time.next()) {
       A += B + scalar * C;
     }
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -154,10 +155,13 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
+      double avgtime = nstream_time.mean();
       double nbytes = 4.0 * length * sizeof(double);
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
@@ -115,7 +115,9 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto nstream_time = 0.0;
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "pstl", nstream_time);
+  record.param("length", length).param("offset", offset);
 
   std::vector<double> A(length);
   std::vector<double> B(length);
@@ -140,10 +142,7 @@ int main(int argc, char * argv[])
         C[i] = 2;
     });
 
-    for (int iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) nstream_time = prk::wtime();
-
+    while (nstream_time.next()) {
 #if defined(USE_PSTL) && ( defined(USE_INTEL_PSTL) || ( defined(__GNUC__) && (__GNUC__ >= 9) ) )
       std::for_each( exec::par_unseq, std::begin(range), std::end(range), [&] (size_t i) {
 #elif defined(USE_PSTL) && defined(__GNUC__) && defined(__GNUC_MINOR__) \
@@ -155,13 +154,15 @@ int main(int argc, char * argv[])
           A[i] += B[i] + scalar * C[i];
       });
     }
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -185,10 +186,13 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
+      double avgtime = nstream_time.mean();
       double nbytes = 4.0 * length * sizeof(double);
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
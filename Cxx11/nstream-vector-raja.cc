@@ -118,7 +118,9 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  double nstream_time(0);
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "vector-raja", nstream_time);
+  record.param("length", length).param("offset", offset);
 
   std::vector<double> A(length);
   std::vector<double> B(length);
@@ -136,22 +138,21 @@ int main(int argc, char * argv[])
         C[i] = 2.0;
     });
 
-    for (int iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) nstream_time = prk::wtime();
-
+    while (nstream_time.next()) {
       //RAJA::forall<thread_exec>(RAJA::Index_type(0), RAJA::Index_type(length), [&](RAJA::Index_type i) {
       RAJA::forall<thread_exec>(range, [&](RAJA::Index_type i) {
           A[i] += B[i] + scalar * C[i];
       });
     }
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -177,10 +178,13 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
+      double avgtime = nstream_time.mean();
       double nbytes = 4.0 * length * sizeof(double);
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
@@ -103,6 +103,7 @@ int main(int argc, char * argv[])
   }
 
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Vector length        = " << length << std::endl;
   std::cout << "Offset               = " << offset << std::endl;
 
@@ -110,7 +111,9 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto nstream_time = 0.0;
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "rangefor", nstream_time);
+  record.param("length", length).param("offset", offset).param("alloc", prk::alloc::name());
 
   prk::vector<double> A(length,0.0);
   prk::vector<double> B(length,2.0);
@@ -121,21 +124,20 @@ int main(int argc, char * argv[])
   double scalar(3);
 
   {
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) nstream_time = prk::wtime();
-
+    while (nstream_time.next()) {
       for (auto i : range) {
           A[i] += B[i] + scalar * C[i];
       }
     }
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -159,10 +161,13 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
+      double avgtime = nstream_time.mean();
       double nbytes = 4.0 * length * sizeof(double);
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
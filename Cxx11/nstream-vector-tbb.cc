@@ -107,6 +107,7 @@ int main(int argc, char * argv[])
 
   std::cout << "Number of threads    = " << num_threads << std::endl;
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Vector length        = " << length << std::endl;
   std::cout << "Offset               = " << offset << std::endl;
   std::cout << "TBB partitioner: " << typeid(tbb_partitioner).name() << std::endl;
@@ -115,11 +116,13 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto nstream_time = 0.0;
+  prk::bench::timer nstream_time(iterations);
+  prk::bench::record record("nstream", "tbb", nstream_time);
+  record.param("length", length).param("offset", offset).threads(num_threads).param("alloc", prk::alloc::name());
 
-  prk::vector<double> A(length);
-  prk::vector<double> B(length);
-  prk::vector<double> C(length);
+  prk::vector<double> A(length, prk::uninitialized);
+  prk::vector<double> B(length, prk::uninitialized);
+  prk::vector<double> C(length, prk::uninitialized);
 
   double scalar(3);
 
@@ -142,10 +145,7 @@ int main(int argc, char * argv[])
                        }, tbb_partitioner);
 #endif
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) nstream_time = prk::wtime();
-
+    while (nstream_time.next()) {
 #if 0
       tbb::parallel_for( range, [&](decltype(range)& r) {
                          for (auto i=r.begin(); i!=r.end(); ++i ) {
@@ -158,13 +158,15 @@ int main(int argc, char * argv[])
                          }, tbb_partitioner);
 #endif
     }
-    nstream_time = prk::wtime() - nstream_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = nstream_time.applications() - 1;
+
   double ar(0);
   double br(2);
   double cr(2);
@@ -194,10 +196,13 @@ int main(int argc, char * argv[])
       return 1;
   } else {
       std::cout << "Solution validates" << std::endl;
-      double avgtime = nstream_time/iterations;
+      double avgtime = nstream_time.mean();
       double nbytes = 4.0 * length * sizeof(double);
       std::cout << "Rate (MB/s): " << 1.e-6*nbytes/avgtime
                 << " Avg time (s): " << avgtime << std::endl;
+      std::cout << nstream_time << std::endl;
+      prk::roofline::report(prk::roofline::nstream(length), avgtime);
+      record.validated("MB/s", 1.e-6*nbytes/avgtime);
   }
 
   return 0;
@@ -125,7 +125,9 @@ int main(int argc, char* argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto pipeline_time = 0.0; // silence compiler warning
+  prk::bench::timer pipeline_time(iterations);
+  prk::bench::record record("p2p", "hyperplane-openmp", pipeline_time);
+  record.param("n", n).param("nc", nc);
 
   double * RESTRICT grid = new double[n*n];
 
@@ -151,13 +153,12 @@ int main(int argc, char* argv[])
     }
     OMP_BARRIER
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) {
-          OMP_BARRIER
-          OMP_MASTER
-          pipeline_time = prk::wtime();
-      }
+    while (true) {
+      OMP_BARRIER
+      OMP_MASTER
+      pipeline_time.next();
+      OMP_BARRIER
+      if (!pipeline_time.running()) break;
 
       if (nc==1) {
         for (auto i=2; i<=2*n-2; i++) {
@@ -181,15 +182,15 @@ int main(int argc, char* argv[])
       OMP_MASTER
       grid[0*n+0] = -grid[(n-1)*n+(n-1)];
     }
-    OMP_BARRIER
-    OMP_MASTER
-    pipeline_time = prk::wtime() - pipeline_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = pipeline_time.applications() - 1;
+
   const double epsilon = 1.e-8;
   auto corner_val = ((iterations+1.)*(2.*n-2.));
   if ( (std::fabs(grid[(n-1)*n+(n-1)] - corner_val)/corner_val) > epsilon) {
@@ -203,10 +204,12 @@ int main(int argc, char* argv[])
 #else
   std::cout << "Solution validates" << std::endl;
 #endif
-  auto avgtime = pipeline_time/iterations;
+  auto avgtime = pipeline_time.mean();
   std::cout << "Rate (MFlops/s): "
             << 2.0e-6 * ( (n-1.)*(n-1.) )/avgtime
             << " Avg time (s): " << avgtime << std::endl;
+  std::cout << pipeline_time << std::endl;
+  record.validated("MFlops/s", 2.0e-6 * ( (n-1.)*(n-1.) )/avgtime);
 
   return 0;
 }
@@ -119,7 +119,9 @@ int main(int argc, char* argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  double pipeline_time(0);
+  prk::bench::timer pipeline_time(iterations);
+  prk::bench::record record("p2p", "hyperplane-pstl", pipeline_time);
+  record.param("n", n).param("nc", nc);
 
   std::vector<double> grid(n*n,0.0);
 
@@ -129,10 +131,7 @@ int main(int argc, char* argv[])
     grid[j*n+0] = static_cast<double>(j);
   }
 
-  for (int iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) pipeline_time = prk::wtime();
-
+  while (pipeline_time.next()) {
     if (nc==1) {
       for (auto i=2; i<=2*n-2; i++) {
         const auto begin = std::max(2,i-n+2);
@@ -173,12 +172,13 @@ int main(int argc, char* argv[])
     grid[0*n+0] = -grid[(n-1)*n+(n-1)];
   }
 
-  pipeline_time = prk::wtime() - pipeline_time;
-
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = pipeline_time.applications() - 1;
+
   const double epsilon = 1.e-8;
   auto corner_val = ((iterations+1.)*(2.*n-2.));
   if ( (std::fabs(grid[(n-1)*n+(n-1)] - corner_val)/corner_val) > epsilon) {
@@ -192,10 +192,12 @@ int main(int argc, char* argv[])
 #else
   std::cout << "Solution validates" << std::endl;
 #endif
-  auto avgtime = pipeline_time/iterations;
+  auto avgtime = pipeline_time.mean();
   std::cout << "Rate (MFlops/s): "
             << 2.0e-6 * ( (n-1.)*(n-1.) )/avgtime
             << " Avg time (s): " << avgtime << std::endl;
+  std::cout << pipeline_time << std::endl;
+  record.validated("MFlops/s", 2.0e-6 * ( (n-1.)*(n-1.) )/avgtime);
 
   return 0;
 }
@@ -113,6 +113,7 @@ int main(int argc, char* argv[])
 
   std::cout << "Number of threads    = " << num_threads << std::endl;
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Grid sizes           = " << n << ", " << n << std::endl;
   std::cout << "Grid chunk sizes     = " << nc << std::endl;
   std::cout << "TBB partitioner: " << typeid(tbb_partitioner).name() << std::endl;
@@ -121,7 +122,9 @@ int main(int argc, char* argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto pipeline_time = 0.0; // silence compiler warning
+  prk::bench::timer pipeline_time(iterations);
+  prk::bench::record record("p2p", "hyperplane-tbb", pipeline_time);
+  record.param("n", n).param("nc", nc).threads(num_threads).param("alloc", prk::alloc::name());
 
   prk::vector<double> grid(n*n,0.0);
 
@@ -131,10 +134,7 @@ int main(int argc, char* argv[])
     grid[j*n+0] = static_cast<double>(j);
   }
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) pipeline_time = prk::wtime();
-
+  while (pipeline_time.next()) {
     if (nc==1) {
       for (auto i=2; i<=2*n-2; i++) {
         //OMP_FOR_SIMD
@@ -159,12 +159,13 @@ int main(int argc, char* argv[])
     grid[0*n+0] = -grid[(n-1)*n+(n-1)];
   }
 
-  pipeline_time = prk::wtime() - pipeline_time;
-
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = pipeline_time.applications() - 1;
+
   const double epsilon = 1.e-8;
   auto corner_val = ((iterations+1.)*(2.*n-2.));
   if ( (std::fabs(grid[(n-1)*n+(n-1)] - corner_val)/corner_val) > epsilon) {
@@ -178,10 +179,12 @@ int main(int argc, char* argv[])
 #else
   std::cout << "Solution validates" << std::endl;
 #endif
-  auto avgtime = pipeline_time/iterations;
+  auto avgtime = pipeline_time.mean();
   std::cout << "Rate (MFlops/s): "
             << 2.0e-6 * ( (n-1.)*(n-1.) )/avgtime
             << " Avg time (s): " << avgtime << std::endl;
+  std::cout << pipeline_time << std::endl;
+  record.validated("MFlops/s", 2.0e-6 * ( (n-1.)*(n-1.) )/avgtime);
 
   return 0;
 }
@@ -116,7 +116,9 @@ int main(int argc, char* argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto pipeline_time = 0.0; // silence compiler warning
+  prk::bench::timer pipeline_time(iterations);
+  prk::bench::record record("p2p", "raja", pipeline_time);
+  record.param("m", m).param("n", n).param("mc", mc).param("nc", nc);
 
   double * RESTRICT Amem = new double[m*n];
   matrix grid(Amem, m, n);
@@ -138,10 +140,7 @@ int main(int argc, char* argv[])
     grid(i,0) = static_cast<double>(i);
   }
 
-  for (int iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) pipeline_time = prk::wtime();
-
+  while (pipeline_time.next()) {
     for (int j=1; j<n; j++) {
       RAJA::RangeSegment range(1, j+1);
       RAJA::forall<thread_exec>(range, [=](RAJA::Index_type i) {
@@ -161,12 +160,13 @@ int main(int argc, char* argv[])
     grid(0,0) = -grid(m-1,n-1);
   }
 
-  pipeline_time = prk::wtime() - pipeline_time;
-
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = pipeline_time.applications() - 1;
+
   const double epsilon = 1.e-8;
   auto corner_val = ((iterations+1.)*(n+m-2.));
   if ( (std::fabs(grid(m-1,n-1) - corner_val)/corner_val) > epsilon) {
@@ -180,10 +180,12 @@ int main(int argc, char* argv[])
 #else
   std::cout << "Solution validates" << std::endl;
 #endif
-  auto avgtime = pipeline_time/iterations;
+  auto avgtime = pipeline_time.mean();
   std::cout << "Rate (MFlops/s): "
             << 2.0e-6 * ( (m-1.)*(n-1.) )/avgtime
             << " Avg time (s): " << avgtime << std::endl;
+  std::cout << pipeline_time << std::endl;
+  record.validated("MFlops/s", 2.0e-6 * ( (m-1.)*(n-1.) )/avgtime);
 
   return 0;
 }
@@ -131,11 +131,14 @@ int main(int argc, char* argv[])
   int num_blocks_m = (m / mc);
   if(m%mc != 0) num_blocks_m++;
 
-  auto pipeline_time = 0.0; // silence compiler warning
+  prk::bench::timer pipeline_time(iterations);
+  prk::bench::record record("p2p", "tasks-tbb", pipeline_time);
+  record.param("m", m).param("n", n).param("mc", mc).param("nc", nc).threads(num_threads);
 
   double * grid = new double[m*n];
 
   typedef tbb::flow::continue_node< tbb::flow::continue_msg > block_node_t;
+  typedef tbb::flow::multifunction_node< tbb::flow::continue_msg, std::tuple<tbb::flow::continue_msg> > barrier_node_t;
 
   graph g;
   block_node_t *nodes[ num_blocks_n * num_blocks_m ];
@@ -146,11 +149,10 @@ int main(int argc, char* argv[])
   g.set_name("Pipeline");
 #endif
 
-  bool first_iter=true;
-  block_node_t b(g, [&](const tbb::flow::continue_msg &){
+  // the iteration barrier only releases the next sweep while the timer is running
+  barrier_node_t b(g, tbb::flow::serial, [&](const tbb::flow::continue_msg &, barrier_node_t::output_ports_type & ports){
     grid[0*n+0] = -grid[(m-1)*n+(n-1)];
-    if(first_iter) pipeline_time = prk::wtime();
-      first_iter = false;
+    if (pipeline_time.next()) std::get<0>(ports).try_put(tbb::flow::continue_msg());
   });
   for (int i=0; i<num_blocks_m; i+=1) {
     for (int j=0; j<num_blocks_n; j+=1) {
@@ -182,12 +184,12 @@ int main(int argc, char* argv[])
     return false;
   }, false);
   
-  limiter_node<continue_msg> l(g, iterations+1, 1);
+  limiter_node<continue_msg> l(g, pipeline_time.warmup()+iterations, 1);
 
   make_edge( s, l );
   make_edge( l, *nodes[0] );
   make_edge( *nodes[(num_blocks_n * num_blocks_m) - 1], b);
-  make_edge( b, l );
+  make_edge( tbb::flow::output_port<0>(b), l );
 
 #if TBB_PREVIEW_FLOW_GRAPH_TRACE
   s.set_name("Source");
@@ -216,10 +218,9 @@ int main(int argc, char* argv[])
       grid[i*n+0] = static_cast<double>(i);
     }
 
+    pipeline_time.next();
     s.activate();
     g.wait_for_all();
-    
-    pipeline_time = prk::wtime() - pipeline_time;
 
   }
 
@@ -237,6 +238,9 @@ int main(int argc, char* argv[])
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = pipeline_time.applications() - 1;
+
   const double epsilon = 1.e-8;
   auto corner_val = ((iterations+1.)*(n+m-2.));
   if ( (std::fabs(grid[(m-1)*n+(n-1)] - corner_val)/corner_val) > epsilon) {
@@ -250,10 +254,12 @@ int main(int argc, char* argv[])
 #else
   std::cout << "Solution validates" << std::endl;
 #endif
-  auto avgtime = pipeline_time/iterations;
+  auto avgtime = pipeline_time.mean();
   std::cout << "Rate (MFlops/s): "
             << 2.0e-6 * ( (m-1.)*(n-1.) )/avgtime
             << " Avg time (s): " << avgtime << std::endl;
+  std::cout << pipeline_time << std::endl;
+  record.validated("MFlops/s", 2.0e-6 * ( (m-1.)*(n-1.) )/avgtime);
 
   return 0;
 }
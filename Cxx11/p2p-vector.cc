@@ -116,7 +116,9 @@ int main(int argc, char* argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto pipeline_time = 0.0; // silence compiler warning
+  prk::bench::timer pipeline_time(iterations);
+  prk::bench::record record("p2p", "vector", pipeline_time);
+  record.param("m", m).param("n", n).param("mc", mc).param("nc", nc);
 
   std::vector<double> grid(m*n,0.0);;
 
@@ -129,10 +131,7 @@ int main(int argc, char* argv[])
       grid[i*n+0] = static_cast<double>(i);
     }
 
-    for (int iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) pipeline_time = prk::wtime();
-
+    while (pipeline_time.next()) {
       double * RESTRICT pgrid = grid.data();
 
       if (mc==m && nc==n) {
@@ -156,13 +155,15 @@ int main(int argc, char* argv[])
       }
       pgrid[0*n+0] = -pgrid[(m-1)*n+(n-1)];
     }
-    pipeline_time = prk::wtime() - pipeline_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = pipeline_time.applications() - 1;
+
   const double epsilon = 1.e-8;
   auto corner_val = ((iterations+1.)*(n+m-2.));
   if ( (std::fabs(grid[(m-1)*n+(n-1)] - corner_val)/corner_val) > epsilon) {
@@ -176,10 +177,12 @@ int main(int argc, char* argv[])
 #else
   std::cout << "Solution validates" << std::endl;
 #endif
-  auto avgtime = pipeline_time/iterations;
+  auto avgtime = pipeline_time.mean();
   std::cout << "Rate (MFlops/s): "
             << 2.0e-6 * ( (m-1.)*(n-1.) )/avgtime
             << " Avg time (s): " << avgtime << std::endl;
+  std::cout << pipeline_time << std::endl;
+  record.validated("MFlops/s", 2.0e-6 * ( (m-1.)*(n-1.) )/avgtime);
 
   return 0;
 }
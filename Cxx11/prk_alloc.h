@@ -0,0 +1,314 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_ALLOC_H
+#define PRK_ALLOC_H
+
+// This header is included by prk_util.h before prk::malloc is defined.
+
+#include <cstring> // memset, strtok
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#if defined(__linux__)
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# include <linux/mman.h>      // MAP_HUGE_2MB, MAP_HUGE_1GB
+# include <linux/mempolicy.h> // MPOL_INTERLEAVE
+#endif
+
+namespace prk {
+
+    /// Placement policies for prk::malloc, selected at runtime with
+    ///
+    ///   PRK_ALLOC=<policy>[,<policy>...]
+    ///
+    ///   default     posix_memalign with PRK_ALIGNMENT
+    ///   thp         2 MiB aligned anonymous mapping with madvise(MADV_HUGEPAGE)
+    ///   hugetlb2m   MAP_HUGETLB with 2 MiB pages (needs vm.nr_hugepages)
+    ///   hugetlb1g   MAP_HUGETLB with 1 GiB pages (needs boot-time reservation)
+    ///   interleave  mbind(MPOL_INTERLEAVE) over all online NUMA nodes
+    ///   firsttouch  zero the pages in parallel with OpenMP schedule(static),
+    ///               i.e. the partition the OpenMP drivers use for 1D loops
+    ///
+    /// Policies apply to allocations of at least PRK_ALLOC_THRESHOLD bytes
+    /// (default 64 KiB); smaller ones always use the default path.
+    /// If a policy cannot be honored, e.g. no huge pages are reserved, a
+    /// warning is printed once and the allocation falls back to the next
+    /// weaker policy.
+    namespace alloc {
+
+        enum policy : unsigned {
+            standard   = 0,
+            thp        = 1u<<0,
+            hugetlb2m  = 1u<<1,
+            hugetlb1g  = 1u<<2,
+            interleave = 1u<<3,
+            firsttouch = 1u<<4
+        };
+
+        static inline unsigned parse(const char * str)
+        {
+            unsigned p = standard;
+            if (str==nullptr) return p;
+            std::string s(str);
+            size_t begin = 0;
+            while (begin <= s.size()) {
+                size_t end = s.find(',', begin);
+                if (end == std::string::npos) end = s.size();
+                const std::string w = s.substr(begin, end-begin);
+                if      (w=="thp")        p |= thp;
+                else if (w=="hugetlb2m")  p |= hugetlb2m;
+                else if (w=="hugetlb1g")  p |= hugetlb1g;
+                else if (w=="interleave") p |= interleave;
+                else if (w=="firsttouch") p |= firsttouch;
+                else if (w!="default" && !w.empty()) {
+                    std::cerr << "PRK_ALLOC: ignoring unknown policy " << w << std::endl;
+                }
+                begin = end+1;
+            }
+            return p;
+        }
+
+        static inline unsigned get_policy(void)
+        {
+            static const unsigned p = parse(std::getenv("PRK_ALLOC"));
+            return p;
+        }
+
+        static inline size_t get_threshold(void)
+        {
+            static const size_t t = [] {
+                const char * temp = std::getenv("PRK_ALLOC_THRESHOLD");
+                return (temp!=nullptr) ? static_cast<size_t>(std::atol(temp)) : static_cast<size_t>(65536);
+            }();
+            return t;
+        }
+
+        static inline std::string name(unsigned p)
+        {
+            std::string s;
+            const char * names[] = { "thp", "hugetlb2m", "hugetlb1g", "interleave", "firsttouch" };
+            for (int i=0; i<5; ++i) {
+                if (p & (1u<<i)) s += (s.empty() ? "" : ",") + std::string(names[i]);
+            }
+            return s.empty() ? std::string("default") : s;
+        }
+
+        static inline std::string name(void)
+        {
+            return name(get_policy());
+        }
+
+        static inline void warn_once(unsigned which, const char * what)
+        {
+            static std::atomic<unsigned> warned(0);
+            if ((warned.fetch_or(which) & which) == 0) {
+                std::cerr << "PRK_ALLOC: " << what << std::endl;
+            }
+        }
+
+        // mappings created by map(), so that prk::free knows to munmap them
+        struct registry {
+            std::mutex lock;
+            std::map<void*,size_t> length;
+        };
+
+        static inline registry & mappings(void)
+        {
+            static registry r;
+            return r;
+        }
+
+#if defined(__linux__)
+
+        // sets the bits of the online NUMA nodes in mask[16] and returns
+        // one more than the highest, or 0 if sysfs cannot be read
+        static inline unsigned long online_nodes(unsigned long * mask)
+        {
+            // parse e.g. "0-1" or "0,2-3" from sysfs
+            unsigned long maxnode = 0;
+            std::ifstream f("/sys/devices/system/node/online");
+            std::string list;
+            if (!(f >> list)) return 0;
+            size_t begin = 0;
+            while (begin < list.size()) {
+                size_t end = list.find(',', begin);
+                if (end == std::string::npos) end = list.size();
+                const std::string range = list.substr(begin, end-begin);
+                const size_t dash = range.find('-');
+                unsigned long lo = std::stoul(range.substr(0,dash));
+                unsigned long hi = (dash == std::string::npos) ? lo : std::stoul(range.substr(dash+1));
+                for (unsigned long n=lo; n<=hi && n<16*8*sizeof(unsigned long); ++n) {
+                    mask[n/(8*sizeof(unsigned long))] |= 1ul << (n%(8*sizeof(unsigned long)));
+                    maxnode = std::max(maxnode, n+1);
+                }
+                begin = end+1;
+            }
+            return maxnode;
+        }
+
+        /// The number of online NUMA nodes, at least 1.
+        static inline int numa_nodes(void)
+        {
+            unsigned long mask[16] = {};
+            online_nodes(mask);
+            int n = 0;
+            for (auto m : mask) n += __builtin_popcountl(m);
+            return std::max(1,n);
+        }
+
+        static inline void interleave_nodes(void * ptr, size_t bytes)
+        {
+            unsigned long mask[16] = {};
+            const unsigned long maxnode = online_nodes(mask);
+            if (maxnode < 2) return; // nothing to interleave over
+            if (syscall(__NR_mbind, ptr, bytes, MPOL_INTERLEAVE, mask, maxnode+1, 0) != 0) {
+                warn_once(interleave, "mbind(MPOL_INTERLEAVE) failed, using the default NUMA policy");
+            }
+        }
+
+        // Returns nullptr if the mapping failed.
+        static inline void * map_policy(size_t bytes, unsigned p)
+        {
+            const size_t huge = 1ul<<21;
+            void * ptr = MAP_FAILED;
+            size_t length = 0;
+            if (p & hugetlb1g) {
+                length = (bytes + (1ul<<30) - 1) & ~((1ul<<30) - 1);
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+                if (ptr == MAP_FAILED) {
+                    warn_once(hugetlb1g, "1 GiB huge pages unavailable, trying 2 MiB pages");
+                    p |= hugetlb2m;
+                }
+            }
+            if (ptr == MAP_FAILED && (p & hugetlb2m)) {
+                length = (bytes + huge - 1) & ~(huge - 1);
+                ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+                if (ptr == MAP_FAILED) {
+                    warn_once(hugetlb2m, "2 MiB huge pages unavailable, using transparent huge pages");
+                    p |= thp;
+                }
+            }
+            if (ptr == MAP_FAILED) {
+                // over-allocate and trim so that the mapping is 2 MiB aligned
+                length = (bytes + huge - 1) & ~(huge - 1);
+                char * raw = static_cast<char*>(mmap(nullptr, length + huge, PROT_READ | PROT_WRITE,
+                                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+                if (raw == MAP_FAILED) return nullptr;
+                char * aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + huge - 1) & ~(huge - 1));
+                const size_t head = aligned - raw;
+                if (head > 0) munmap(raw, head);
+                munmap(aligned + length, huge - head);
+                ptr = aligned;
+                if ( (p & thp) && (madvise(ptr, length, MADV_HUGEPAGE) != 0) ) {
+                    warn_once(thp, "madvise(MADV_HUGEPAGE) failed, using base pages");
+                }
+            }
+            if (p & interleave) interleave_nodes(ptr, length);
+            auto & r = mappings();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.length[ptr] = length;
+            return ptr;
+        }
+
+        // Returns false if ptr was not created by map().
+        static inline bool unmap(void * ptr)
+        {
+            auto & r = mappings();
+            size_t length = 0;
+            {
+                std::lock_guard<std::mutex> guard(r.lock);
+                auto it = r.length.find(ptr);
+                if (it == r.length.end()) return false;
+                length = it->second;
+                r.length.erase(it);
+            }
+            munmap(ptr, length);
+            return true;
+        }
+
+#else
+
+        static inline int numa_nodes(void) { return 1; }
+        static inline void * map_policy(size_t, unsigned) { return nullptr; }
+        static inline bool unmap(void *) { return false; }
+
+#endif
+
+        /// Returns a mapping that honors the selected policy, or nullptr if
+        /// the policy is satisfied by an ordinary aligned allocation.
+        static inline void * map(size_t bytes)
+        {
+            const unsigned p = get_policy();
+            if ( (bytes < get_threshold()) || !(p & (thp | hugetlb2m | hugetlb1g | interleave)) ) return nullptr;
+            return map_policy(bytes, p);
+        }
+
+        static inline void touch(void * ptr, size_t bytes)
+        {
+            char * c = static_cast<char*>(ptr);
+#if defined(USE_OPENMP) && defined(_OPENMP)
+            // zero whole doubles so the split matches loops over double arrays
+            const size_t n = bytes / sizeof(double);
+            double * d = static_cast<double*>(ptr);
+            OMP_PARALLEL( )
+            {
+                OMP_FOR( schedule(static) )
+                for (size_t i=0; i<n; i++) {
+                    d[i] = 0.0;
+                }
+            }
+            std::memset(c + n*sizeof(double), 0, bytes - n*sizeof(double));
+#else
+            std::memset(c, 0, bytes);
+#endif
+        }
+
+        /// Zeros a new allocation in parallel if the firsttouch policy is set.
+        static inline void * first_touch(void * ptr, size_t bytes)
+        {
+            if ( (ptr!=nullptr) && (bytes >= get_threshold()) && (get_policy() & firsttouch) ) {
+                touch(ptr, bytes);
+            }
+            return ptr;
+        }
+
+    } // namespace alloc
+
+} // namespace prk
+
+#endif /* PRK_ALLOC_H */
@@ -0,0 +1,412 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PRK_BENCH_H
+#define PRK_BENCH_H
+
+// This header is included at the end of prk_util.h and relies on prk::wtime.
+
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace prk {
+
+    namespace bench {
+
+        // Two-sided 95% quantile of Student's t distribution.
+        static inline double student_t95(size_t dof)
+        {
+            static const double table[30] = { 12.706, 4.303, 3.182, 2.776, 2.571,
+                                               2.447, 2.365, 2.306, 2.262, 2.228,
+                                               2.201, 2.179, 2.160, 2.145, 2.131,
+                                               2.120, 2.110, 2.101, 2.093, 2.086,
+                                               2.080, 2.074, 2.069, 2.064, 2.060,
+                                               2.056, 2.052, 2.048, 2.045, 2.042 };
+            if (dof < 1)   return INFINITY;
+            if (dof <= 30) return table[dof-1];
+            if (dof <= 60) return 2.000;
+            return 1.960;
+        }
+
+        static inline int getenv_int(const char * name, int def)
+        {
+            const char * temp = std::getenv(name);
+            return (temp!=nullptr) ? std::atoi(temp) : def;
+        }
+
+        static inline double getenv_double(const char * name, double def)
+        {
+            const char * temp = std::getenv(name);
+            return (temp!=nullptr) ? std::atof(temp) : def;
+        }
+
+        /// Replaces the classic PRK timing loop
+        ///
+        ///   for (iter=0; iter<=iterations; iter++) {
+        ///     if (iter==1) t = prk::wtime();
+        ///     ...
+        ///   }
+        ///
+        /// with
+        ///
+        ///   prk::bench::timer t(iterations);
+        ///   while (t.next()) {
+        ///     ...
+        ///   }
+        ///
+        /// and records the time of every iteration after the warm-up.
+        ///
+        /// The following environment variables control the behavior:
+        ///
+        ///   PRK_BENCH_WARMUP          untimed iterations (default 1)
+        ///   PRK_BENCH_CI              stop once the 95% confidence interval of the
+        ///                             mean is within this fraction of the mean
+        ///                             (default 0 = always run all iterations)
+        ///   PRK_BENCH_MIN_ITERATIONS  timed iterations before early stopping is
+        ///                             considered (default 5)
+        ///
+        /// The number of timed iterations never exceeds the one requested,
+        /// so verification must use applications() rather than the input.
+        class timer {
+
+            private:
+                int warmup_;
+                int iterations_;
+                int min_iterations_;
+                double ci_;
+                int count_;
+                int block_;
+                bool running_;
+                double start_;
+                std::vector<double> times_;
+
+            public:
+
+                timer(int iterations) : count_(0), block_(0), running_(true), start_(0.0)
+                {
+                    iterations_     = iterations;
+                    warmup_         = std::max(0,prk::bench::getenv_int("PRK_BENCH_WARMUP",1));
+                    min_iterations_ = std::max(2,prk::bench::getenv_int("PRK_BENCH_MIN_ITERATIONS",5));
+                    ci_             = std::max(0.0,prk::bench::getenv_double("PRK_BENCH_CI",0.0));
+                    times_.reserve(iterations_);
+                }
+
+                // Call once before every iteration; returns false when done.
+                // With OpenMP, call from the master thread between barriers.
+                bool next(void)
+                {
+                    return (next_block(1) > 0);
+                }
+
+                // Like next(), for kernels that advance up to `steps` iterations
+                // at a time (e.g. temporal blocking).  Returns the number of
+                // iterations in the next block, or 0 when done.  The elapsed time
+                // of a block is split evenly among its iterations, and blocks never
+                // mix warm-up and timed iterations.  Early stopping (PRK_BENCH_CI)
+                // only applies to single-iteration blocks, because the per-iteration
+                // times within a block are not independent samples.
+                int next_block(int steps)
+                {
+                    if (!running_) return 0;
+                    const double now = prk::wtime();
+                    if (count_ > warmup_) {
+                        for (int k=0; k<block_; ++k) {
+                            times_.push_back((now - start_)/block_);
+                        }
+                    }
+                    if ( (static_cast<int>(times_.size()) >= iterations_) || (block_ <= 1 && converged()) ) {
+                        running_ = false;
+                        block_   = 0;
+                        return 0;
+                    }
+                    steps = std::max(steps,1);
+                    if (count_ < warmup_) {
+                        steps = std::min(steps, warmup_ - count_);
+                    } else {
+                        steps = std::min(steps, iterations_ - static_cast<int>(times_.size()));
+                    }
+                    count_ += steps;
+                    block_  = steps;
+                    start_  = now;
+                    return steps;
+                }
+
+                bool running(void) const {
+                    return running_;
+                }
+
+                // true while the current iteration is timed (i.e. not warm-up)
+                bool timed(void) const {
+                    return running_ && (count_ > warmup_);
+                }
+
+                bool converged(void) const {
+                    const size_t n = times_.size();
+                    if ( (ci_ <= 0.0) || (n < static_cast<size_t>(min_iterations_)) ) return false;
+                    return (ci95() <= ci_ * mean());
+                }
+
+                int warmup(void) const {
+                    return warmup_;
+                }
+
+                // timed iterations
+                size_t size(void) const {
+                    return times_.size();
+                }
+
+                // total number of times the kernel was applied (warm-up plus timed)
+                int applications(void) const {
+                    return warmup_ + static_cast<int>(times_.size());
+                }
+
+                const std::vector<double> & times(void) const {
+                    return times_;
+                }
+
+                double total(void) const {
+                    return std::accumulate(times_.begin(), times_.end(), 0.0);
+                }
+
+                double mean(void) const {
+                    return times_.empty() ? 0.0 : total() / times_.size();
+                }
+
+                double min(void) const {
+                    return times_.empty() ? 0.0 : *std::min_element(times_.begin(), times_.end());
+                }
+
+                double max(void) const {
+                    return times_.empty() ? 0.0 : *std::max_element(times_.begin(), times_.end());
+                }
+
+                // nearest-rank percentile, p in [0,100]
+                double percentile(double p) const {
+                    if (times_.empty()) return 0.0;
+                    std::vector<double> sorted(times_);
+                    std::sort(sorted.begin(), sorted.end());
+                    size_t rank = static_cast<size_t>(std::ceil(p/100.0 * sorted.size()));
+                    rank = std::min(std::max(rank,static_cast<size_t>(1)),sorted.size());
+                    return sorted[rank-1];
+                }
+
+                double median(void) const {
+                    if (times_.empty()) return 0.0;
+                    std::vector<double> sorted(times_);
+                    std::sort(sorted.begin(), sorted.end());
+                    const size_t n = sorted.size();
+                    return (n%2) ? sorted[n/2] : 0.5*(sorted[n/2-1]+sorted[n/2]);
+                }
+
+                // sample standard deviation
+                double stddev(void) const {
+                    const size_t n = times_.size();
+                    if (n < 2) return 0.0;
+                    const double m = mean();
+                    double s = 0.0;
+                    for (auto t : times_) s += (t-m)*(t-m);
+                    return std::sqrt(s/(n-1));
+                }
+
+                // half-width of the 95% confidence interval of the mean
+                double ci95(void) const {
+                    const size_t n = times_.size();
+                    if (n < 2) return INFINITY;
+                    return prk::bench::student_t95(n-1) * stddev() / std::sqrt(static_cast<double>(n));
+                }
+        };
+
+        static inline std::ostream & operator<<(std::ostream & os, const timer & t)
+        {
+            os << "Time (s): min " << t.min()
+               << " median " << t.median()
+               << " p95 " << t.percentile(95)
+               << " stddev " << t.stddev()
+               << " (" << t.size() << " timed, " << t.warmup() << " warm-up)";
+            return os;
+        }
+
+        /// One machine-readable result record per run, enabled by
+        ///
+        ///   PRK_OUTPUT=json  one JSON object per line
+        ///   PRK_OUTPUT=csv   one CSV row (with a header if the output is empty)
+        ///
+        /// Records go to stdout or, if PRK_OUTPUT_FILE is set, are appended to
+        /// that file.  The record is written when it goes out of scope, so runs
+        /// that fail verification and return early are reported as well.
+        class record {
+
+            private:
+                std::string kernel_;
+                std::string backend_;
+                std::vector<std::pair<std::string,std::string>> params_;
+                int threads_;
+                int ranks_;
+                const timer & timer_;
+                std::string unit_;
+                double rate_;
+                bool valid_;
+
+                static std::string escape(const std::string & in) {
+                    std::string out;
+                    for (auto c : in) {
+                        if (c=='"' || c=='\\') out += '\\';
+                        out += c;
+                    }
+                    return out;
+                }
+
+                static bool is_number(const std::string & str) {
+                    if (str.empty()) return false;
+                    char * end = nullptr;
+                    std::strtod(str.c_str(), &end);
+                    return (*end == '\0');
+                }
+
+                void json(std::ostream & os) const {
+                    os << std::setprecision(9)
+                       << "{\"version\":\"" << PRKVERSION << "\""
+                       << ",\"kernel\":\"" << escape(kernel_) << "\""
+                       << ",\"backend\":\"" << escape(backend_) << "\""
+                       << ",\"params\":{";
+                    for (size_t i=0; i<params_.size(); ++i) {
+                        os << (i ? "," : "") << "\"" << escape(params_[i].first) << "\":";
+                        if (is_number(params_[i].second)) {
+                            os << params_[i].second;
+                        } else {
+                            os << "\"" << escape(params_[i].second) << "\"";
+                        }
+                    }
+                    os << "},\"threads\":" << threads_
+                       << ",\"ranks\":" << ranks_
+                       << ",\"warmup\":" << timer_.warmup()
+                       << ",\"iterations\":" << timer_.size()
+                       << ",\"times\":[";
+                    for (size_t i=0; i<timer_.size(); ++i) {
+                        os << (i ? "," : "") << timer_.times()[i];
+                    }
+                    os << "],\"avg_time\":" << timer_.mean()
+                       << ",\"rate\":" << rate_
+                       << ",\"rate_unit\":\"" << escape(unit_) << "\""
+                       << ",\"valid\":" << (valid_ ? "true" : "false")
+                       << "}" << std::endl;
+                }
+
+                static void csv_header(std::ostream & os) {
+                    os << "version,kernel,backend,params,threads,ranks,warmup,iterations,times,"
+                       << "avg_time,rate,rate_unit,valid" << std::endl;
+                }
+
+                void csv(std::ostream & os) const {
+                    os << std::setprecision(9)
+                       << PRKVERSION << "," << kernel_ << "," << backend_ << ",";
+                    for (size_t i=0; i<params_.size(); ++i) {
+                        os << (i ? ";" : "") << params_[i].first << "=" << params_[i].second;
+                    }
+                    os << "," << threads_ << "," << ranks_ << "," << timer_.warmup() << "," << timer_.size() << ",";
+                    for (size_t i=0; i<timer_.size(); ++i) {
+                        os << (i ? ";" : "") << timer_.times()[i];
+                    }
+                    os << "," << timer_.mean()
+                       << "," << rate_
+                       << "," << unit_
+                       << "," << (valid_ ? 1 : 0) << std::endl;
+                }
+
+            public:
+
+                record(const std::string & kernel, const std::string & backend, const timer & t)
+                    : kernel_(kernel), backend_(backend), threads_(1), ranks_(1),
+                      timer_(t), rate_(0.0), valid_(false)
+                {
+#if defined(USE_OPENMP) && defined(_OPENMP)
+                    threads_ = omp_get_max_threads();
+#endif
+                }
+
+                ~record() {
+                    const char * format = std::getenv("PRK_OUTPUT");
+                    if (format==nullptr) return;
+                    const std::string f(format);
+                    if (f!="json" && f!="csv") return;
+                    const char * filename = std::getenv("PRK_OUTPUT_FILE");
+                    std::ofstream file;
+                    bool empty = true;
+                    if (filename!=nullptr) {
+                        file.open(filename, std::ios::out | std::ios::app);
+                        if (!file.is_open()) {
+                            std::cerr << "PRK_OUTPUT_FILE " << filename << " cannot be opened" << std::endl;
+                            return;
+                        }
+                        file.seekp(0, std::ios::end);
+                        empty = (file.tellp() == 0);
+                    }
+                    std::ostream & os = (filename!=nullptr) ? file : std::cout;
+                    if (f=="json") {
+                        json(os);
+                    } else {
+                        if (empty) csv_header(os);
+                        csv(os);
+                    }
+                }
+
+                template <typename T>
+                record & param(const std::string & key, const T & value) {
+                    std::ostringstream v;
+                    v << value;
+                    params_.push_back(std::make_pair(key, v.str()));
+                    return *this;
+                }
+
+                record & threads(int n) {
+                    threads_ = n;
+                    return *this;
+                }
+
+                record & ranks(int n) {
+                    ranks_ = n;
+                    return *this;
+                }
+
+                // call once the solution validates
+                void validated(const std::string & unit, double rate) {
+                    unit_  = unit;
+                    rate_  = rate;
+                    valid_ = true;
+                }
+        };
+
+    } // namespace bench
+
+} // namespace prk
+
+#endif /* PRK_BENCH_H */
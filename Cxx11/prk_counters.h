@@ -0,0 +1,320 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_COUNTERS_H
+#define PRK_COUNTERS_H
+
+// This header is included at the end of prk_util.h and relies on prk::wtime.
+
+#include <cstring> // memset
+
+#if defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace prk {
+
+    namespace counters {
+
+        enum event { cycles = 0, instructions, llc_misses, dtlb_misses, branch_misses, num_events };
+
+        static inline const char * event_name(int e)
+        {
+            static const char * names[num_events] = { "cycles", "instructions", "LLC misses",
+                                                      "dTLB misses", "branch misses" };
+            return names[e];
+        }
+
+        /// One set of hardware counters for the calling thread.
+        /// Cycles lead the group so the other events are scheduled together
+        /// with it; events the PMU does not support are skipped individually.
+        class group {
+
+            private:
+                int fd_[num_events];
+
+#if defined(__linux__)
+                static int open(uint32_t type, uint64_t config, int leader)
+                {
+                    struct perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof(attr));
+                    attr.size           = sizeof(attr);
+                    attr.type           = type;
+                    attr.config         = config;
+                    attr.disabled       = (leader == -1);
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv     = 1;
+                    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    // pid=0, cpu=-1: the calling thread, on whichever CPU it runs
+                    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+                }
+
+                static uint64_t cache(uint64_t id)
+                {
+                    return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                }
+#endif
+
+            public:
+
+                group(void)
+                {
+                    for (int e=0; e<num_events; ++e) fd_[e] = -1;
+#if defined(__linux__)
+                    fd_[cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+                    if (fd_[cycles] < 0) return;
+                    fd_[instructions]  = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fd_[cycles]);
+                    fd_[llc_misses]    = open(PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL), fd_[cycles]);
+                    fd_[dtlb_misses]   = open(PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB), fd_[cycles]);
+                    fd_[branch_misses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, fd_[cycles]);
+#endif
+                }
+
+                ~group(void)
+                {
+#if defined(__linux__)
+                    for (int e=0; e<num_events; ++e) {
+                        if (fd_[e] >= 0) close(fd_[e]);
+                    }
+#endif
+                }
+
+                group(const group &) = delete;
+                group & operator=(const group &) = delete;
+
+                bool available(void) const {
+                    return (fd_[cycles] >= 0);
+                }
+
+                bool available(int e) const {
+                    return (fd_[e] >= 0);
+                }
+
+                void start(void)
+                {
+#if defined(__linux__)
+                    if (!available()) return;
+                    ioctl(fd_[cycles], PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+                    ioctl(fd_[cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+                }
+
+                // Stops counting and adds the counts since start() to sum,
+                // scaled up if the kernel had to multiplex the PMU.
+                void stop(double sum[num_events])
+                {
+#if defined(__linux__)
+                    if (!available()) return;
+                    ioctl(fd_[cycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+                    for (int e=0; e<num_events; ++e) {
+                        uint64_t v[3]; // value, time enabled, time running
+                        if (fd_[e] < 0) continue;
+                        if (read(fd_[e], v, sizeof(v)) != sizeof(v)) continue;
+                        double scale = (v[2] > 0) ? static_cast<double>(v[1])/static_cast<double>(v[2]) : 0.0;
+                        sum[e] += scale * static_cast<double>(v[0]);
+                    }
+#endif
+                }
+        };
+
+        /// A named timed region with per-thread hardware counters.
+        ///
+        ///   prk::counters::region r("stencil");
+        ///   ...
+        ///   r.start();      // from every thread that executes the region
+        ///   kernel();
+        ///   r.stop();
+        ///   ...
+        ///   std::cout << r;
+        ///
+        /// Threads are identified by their OpenMP thread number.  Each thread
+        /// opens its own counters the first time it starts the region.  If
+        /// perf_event_open is unavailable (not Linux, no PMU, or restricted by
+        /// perf_event_paranoid) or PRK_COUNTERS=0, only time is recorded and
+        /// nothing is printed.
+        class region {
+
+            private:
+                struct slot {
+                    group * counters = nullptr;
+                    bool active      = false;
+                    double begin     = 0.0;
+                    double time      = 0.0;
+                    double sum[num_events] = {};
+                };
+
+                std::string name_;
+                bool enabled_;
+                std::vector<slot> slots_;
+
+                slot & me(void) {
+#if defined(USE_OPENMP) && defined(_OPENMP)
+                    return slots_[omp_get_thread_num()];
+#else
+                    return slots_[0];
+#endif
+                }
+
+            public:
+
+                region(const std::string & name) : name_(name)
+                {
+                    const char * temp = std::getenv("PRK_COUNTERS");
+                    enabled_ = (temp==nullptr) || (std::atoi(temp) != 0);
+#if defined(USE_OPENMP) && defined(_OPENMP)
+                    slots_.resize(omp_get_max_threads());
+#else
+                    slots_.resize(1);
+#endif
+                }
+
+                ~region(void)
+                {
+                    for (auto & s : slots_) delete s.counters;
+                }
+
+                region(const region &) = delete;
+                region & operator=(const region &) = delete;
+
+                void start(void)
+                {
+                    auto & s = me();
+                    if (enabled_ && s.counters==nullptr) s.counters = new group();
+                    s.active = true;
+                    s.begin  = prk::wtime();
+                    if (s.counters) s.counters->start();
+                }
+
+                void stop(void)
+                {
+                    auto & s = me();
+                    if (!s.active) return;
+                    if (s.counters) s.counters->stop(s.sum);
+                    s.time  += prk::wtime() - s.begin;
+                    s.active = false;
+                }
+
+                const std::string & name(void) const {
+                    return name_;
+                }
+
+                // true if at least one thread has counter values
+                bool available(void) const {
+                    for (auto & s : slots_) {
+                        if (s.counters && s.counters->available()) return true;
+                    }
+                    return false;
+                }
+
+                bool available(int e) const {
+                    for (auto & s : slots_) {
+                        if (s.counters && s.counters->available(e)) return true;
+                    }
+                    return false;
+                }
+
+                int threads(void) const {
+                    int n = 0;
+                    for (auto & s : slots_) n += (s.time > 0.0);
+                    return n;
+                }
+
+                double count(int e, int thread) const {
+                    return slots_[thread].sum[e];
+                }
+
+                double count(int e) const {
+                    double c = 0.0;
+                    for (auto & s : slots_) c += s.sum[e];
+                    return c;
+                }
+
+                double time(int thread) const {
+                    return slots_[thread].time;
+                }
+
+                double time(void) const {
+                    double t = 0.0;
+                    for (auto & s : slots_) t = std::max(t, s.time);
+                    return t;
+                }
+
+                double ipc(void) const {
+                    return (count(cycles) > 0.0) ? count(instructions)/count(cycles) : 0.0;
+                }
+
+                // misses per thousand instructions
+                double mpki(int e) const {
+                    return (count(instructions) > 0.0) ? 1000.0*count(e)/count(instructions) : 0.0;
+                }
+
+                friend std::ostream & operator<<(std::ostream & os, const region & r);
+        };
+
+        static inline void print_rates(std::ostream & os, const region & r, double cyc, double ins, const double * c)
+        {
+            os << "IPC " << ((cyc > 0.0) ? ins/cyc : 0.0);
+            for (int e=llc_misses; e<num_events; ++e) {
+                if (!r.available(e)) continue;
+                os << " " << event_name(e) << "/kinst " << ((ins > 0.0) ? 1000.0*c[e]/ins : 0.0);
+            }
+        }
+
+        /// Prints one summary line and, with more than one thread, one line per
+        /// thread.  Prints nothing when no counters could be opened.
+        inline std::ostream & operator<<(std::ostream & os, const region & r)
+        {
+            if (!r.available()) return os;
+            double total[num_events];
+            for (int e=0; e<num_events; ++e) total[e] = r.count(e);
+            os << "Counters (" << r.name() << "): ";
+            print_rates(os, r, total[cycles], total[instructions], total);
+            os << std::endl;
+            if (r.threads() > 1) {
+                for (size_t t=0; t<r.slots_.size(); ++t) {
+                    if (r.slots_[t].time <= 0.0) continue;
+                    os << "  thread " << t << ": time " << r.slots_[t].time << " ";
+                    print_rates(os, r, r.slots_[t].sum[cycles], r.slots_[t].sum[instructions], r.slots_[t].sum);
+                    os << std::endl;
+                }
+            }
+            return os;
+        }
+
+    } // namespace counters
+
+} // namespace prk
+
+#endif /* PRK_COUNTERS_H */
@@ -0,0 +1,487 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_DGEMM_H
+#define PRK_DGEMM_H
+
+/// Packed DGEMM: C += A * B for row-major matrices, after Goto and BLIS.
+///
+/// The three outer loops block n by NC, k by KC and m by MC.  Each KC x NC
+/// panel of B is copied into micro-panels of NR columns and each MC x KC
+/// block of A into micro-panels of MR rows, both zero-padded to whole
+/// micro-panels, so the micro-kernel reads contiguous, aligned memory with
+/// unit stride and needs no edge cases.  The micro-kernel keeps an MR x NR
+/// block of C in registers for the whole of KC: every step loads NR/W
+/// vectors of B, broadcasts MR elements of A and issues MR*NR/W FMAs.
+///
+/// The B micro-panel (KC x NR) stays in L1, the block of A in L2 and the
+/// panel of B in L3, which is what the default block sizes are chosen for.
+/// PRK_DGEMM_MC, PRK_DGEMM_KC and PRK_DGEMM_NC override them.
+///
+/// prk::dgemm_isa() picks the widest micro-kernel the CPU supports,
+/// limited by PRK_DGEMM_ISA=none|avx2|avx512.
+///
+/// Batched small DGEMM: C[b] += A[b] * B[b] for many order x order
+/// matrices.  The batch is stored interleaved, element (i,j) of the
+/// dgemm_batch_lanes matrices of a group next to each other, so a SIMD
+/// lane of every instruction works on a different matrix and tiny orders
+/// need neither packing nor edge cases.  The kernels are specialized for
+/// orders 4, 8, 16 and 32, where the loops unroll completely.
+
+#include "prk_util.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# define PRK_DGEMM_SIMD 1
+#endif
+
+#define PRK_DGEMM_INLINE inline __attribute__((always_inline))
+
+namespace prk {
+
+    /// C(0:m,0:n) += Ap * Bp for packed micro-panels of depth kc
+    using dgemm_micro_fn = void (*)(const int kc, const double * RESTRICT Ap, const double * RESTRICT Bp,
+                                    double * RESTRICT C, const int ldc, const int m, const int n);
+
+    /// matrices per group of an interleaved batch, one per SIMD lane of 64 bytes
+    constexpr int dgemm_batch_lanes = 8;
+
+    /// C += A * B for the dgemm_batch_lanes interleaved matrices of one group
+    using dgemm_batch_fn = void (*)(const int order, const double * RESTRICT A,
+                                    const double * RESTRICT B, double * RESTRICT C);
+
+    /// the offset of element (i,j) of matrix b in an interleaved batch
+    static inline size_t dgemm_batch_index(const int order, const size_t b, const int i, const int j)
+    {
+        const size_t L = dgemm_batch_lanes;
+        return ((b/L)*order*order + static_cast<size_t>(i)*order + j)*L + b%L;
+    }
+
+    namespace dgemm_detail {
+
+        // V holds W doubles; MR x NV*W is the register block of C
+        template <typename V, int W, int MR, int NV>
+        static PRK_DGEMM_INLINE void micro(const int kc, const double * RESTRICT Ap, const double * RESTRICT Bp,
+                                           double * RESTRICT C, const int ldc, const int m, const int n)
+        {
+            constexpr int NR = NV*W;
+            V c[MR][NV] = {};
+            for (auto p=0; p<kc; ++p) {
+                V b[NV];
+                for (auto v=0; v<NV; ++v) {
+                    __builtin_memcpy(&b[v], &Bp[p*NR+v*W], sizeof(V));
+                }
+                for (auto r=0; r<MR; ++r) {
+                    const double a = Ap[p*MR+r];
+                    for (auto v=0; v<NV; ++v) {
+                        c[r][v] += a * b[v];
+                    }
+                }
+            }
+            if (m==MR && n==NR) {
+                for (auto r=0; r<MR; ++r) {
+                    for (auto v=0; v<NV; ++v) {
+                        V t;
+                        __builtin_memcpy(&t, &C[r*ldc+v*W], sizeof(V));
+                        t += c[r][v];
+                        __builtin_memcpy(&C[r*ldc+v*W], &t, sizeof(V));
+                    }
+                }
+            } else {
+                // the padding of the micro-panels computed zeros outside m x n
+                double t[MR*NR];
+                __builtin_memcpy(t, c, sizeof(t));
+                for (auto i=0; i<m; ++i) {
+                    for (auto j=0; j<n; ++j) {
+                        C[i*ldc+j] += t[i*NR+j];
+                    }
+                }
+            }
+        }
+
+        struct config {
+            dgemm_micro_fn micro;
+            int mr, nr;  // register block
+            int mc, kc, nc;  // cache blocks
+        };
+
+        constexpr int scalar_mr = 4, scalar_nr = 4;
+
+        static void micro_scalar(const int kc, const double * RESTRICT Ap, const double * RESTRICT Bp,
+                                 double * RESTRICT C, const int ldc, const int m, const int n)
+        {
+            micro<double,1,scalar_mr,scalar_nr>(kc, Ap, Bp, C, ldc, m, n);
+        }
+
+#ifdef PRK_DGEMM_SIMD
+
+        typedef double v4d __attribute__((vector_size(32)));
+        typedef double v8d __attribute__((vector_size(64)));
+
+        // 6 x 8: 12 accumulators, 2 vectors of B and a broadcast of the 16 ymm
+        constexpr int avx2_mr = 6, avx2_nv = 2;
+
+        __attribute__((target("avx2,fma")))
+        static void micro_avx2(const int kc, const double * RESTRICT Ap, const double * RESTRICT Bp,
+                               double * RESTRICT C, const int ldc, const int m, const int n)
+        {
+            micro<v4d,4,avx2_mr,avx2_nv>(kc, Ap, Bp, C, ldc, m, n);
+        }
+
+        // 8 x 24: 24 accumulators, 3 vectors of B and a broadcast of the 32 zmm
+        constexpr int avx512_mr = 8, avx512_nv = 3;
+
+        __attribute__((target("avx512f")))
+        static void micro_avx512(const int kc, const double * RESTRICT Ap, const double * RESTRICT Bp,
+                                 double * RESTRICT C, const int ldc, const int m, const int n)
+        {
+            micro<v8d,8,avx512_mr,avx512_nv>(kc, Ap, Bp, C, ldc, m, n);
+        }
+
+#endif /* PRK_DGEMM_SIMD */
+
+        static inline config get(const std::string & isa)
+        {
+#ifdef PRK_DGEMM_SIMD
+            if (isa == "avx512") return { micro_avx512, avx512_mr, 8*avx512_nv, 112, 384, 4080 };
+            if (isa == "avx2")   return { micro_avx2,   avx2_mr,   4*avx2_nv,   144, 256, 4080 };
+#else
+            (void)isa;
+#endif
+            return { micro_scalar, scalar_mr, scalar_nr, 64, 256, 4080 };
+        }
+
+        // rows [i0,i0+mc) x columns [p0,p0+kc) of A as micro-panels of mr rows
+        static inline void pack_a(const int mc, const int kc, const int mr,
+                                  const double * RESTRICT A, const int lda, double * RESTRICT Ap)
+        {
+            for (auto ir=0; ir<mc; ir+=mr) {
+                const auto m = std::min(mr,mc-ir);
+                for (auto p=0; p<kc; ++p) {
+                    for (auto r=0; r<m; ++r) {
+                        Ap[p*mr+r] = A[(ir+r)*lda+p];
+                    }
+                    for (auto r=m; r<mr; ++r) {
+                        Ap[p*mr+r] = 0.0;
+                    }
+                }
+                Ap += mr*kc;
+            }
+        }
+
+        // kc rows and n <= nr columns of B as one micro-panel of nr columns
+        static inline void pack_b(const int kc, const int n, const int nr,
+                                  const double * RESTRICT B, const int ldb, double * RESTRICT Bp)
+        {
+            for (auto p=0; p<kc; ++p) {
+                for (auto j=0; j<n; ++j) {
+                    Bp[p*nr+j] = B[p*ldb+j];
+                }
+                for (auto j=n; j<nr; ++j) {
+                    Bp[p*nr+j] = 0.0;
+                }
+            }
+        }
+
+        // C(i:i+IB,j:j+JB) += A(i:i+IB,:) * B(:,j:j+JB) for one group of lanes,
+        // an element being NV vectors of VB bytes
+        template <int VB, int IB, int JB>
+        static PRK_DGEMM_INLINE void batch_block(const int n, const int i, const int j, const double * RESTRICT A,
+                                                 const double * RESTRICT B, double * RESTRICT C)
+        {
+            constexpr int L = dgemm_batch_lanes;
+            constexpr int W = VB/sizeof(double);
+            constexpr int NV = L/W;
+            typedef double V __attribute__((vector_size(VB)));
+            V c[IB][JB][NV];
+            for (auto r=0; r<IB; ++r) {
+                for (auto s=0; s<JB; ++s) {
+                    for (auto v=0; v<NV; ++v) {
+                        __builtin_memcpy(&c[r][s][v], &C[((i+r)*n+j+s)*L+v*W], sizeof(V));
+                    }
+                }
+            }
+            for (auto k=0; k<n; ++k) {
+                // whole cache lines of A and B per step
+                for (auto v=0; v<NV; ++v) {
+                    V a[IB], b[JB];
+                    for (auto r=0; r<IB; ++r) {
+                        __builtin_memcpy(&a[r], &A[((i+r)*n+k)*L+v*W], sizeof(V));
+                    }
+                    for (auto s=0; s<JB; ++s) {
+                        __builtin_memcpy(&b[s], &B[(k*n+j+s)*L+v*W], sizeof(V));
+                    }
+                    for (auto r=0; r<IB; ++r) {
+                        for (auto s=0; s<JB; ++s) {
+                            c[r][s][v] += a[r] * b[s];
+                        }
+                    }
+                }
+            }
+            for (auto r=0; r<IB; ++r) {
+                for (auto s=0; s<JB; ++s) {
+                    for (auto v=0; v<NV; ++v) {
+                        __builtin_memcpy(&C[((i+r)*n+j+s)*L+v*W], &c[r][s][v], sizeof(V));
+                    }
+                }
+            }
+        }
+
+        // IB x JB register blocks, the remainders of a runtime order with narrower ones
+        template <int N, int VB, int IB, int JB>
+        static PRK_DGEMM_INLINE void batch(const int order, const double * RESTRICT A,
+                                           const double * RESTRICT B, double * RESTRICT C)
+        {
+            const int n = (N>0) ? N : order;
+            // the remainders are empty for the specialized orders
+            constexpr bool irem = (N==0 || N%IB!=0);
+            constexpr bool jrem = (N==0 || N%JB!=0);
+            // a block column of B stays in L1 while A streams
+            auto j = 0;
+            for (; j+JB<=n; j+=JB) {
+                auto i = 0;
+                for (; i+IB<=n; i+=IB) batch_block<VB,IB,JB>(n, i, j, A, B, C);
+                if (irem) {
+                    for (; i<n; ++i)   batch_block<VB,1,JB>(n, i, j, A, B, C);
+                }
+            }
+            if (jrem) {
+                for (; j<n; ++j) {
+                    auto i = 0;
+                    for (; i+IB<=n; i+=IB) batch_block<VB,IB,1>(n, i, j, A, B, C);
+                    for (; i<n; ++i)        batch_block<VB,1,1>(n, i, j, A, B, C);
+                }
+            }
+        }
+
+        // the accumulators of a block fill about half the vector registers of the ISA
+        template <int N>
+        static void batch_generic(const int order, const double * RESTRICT A,
+                                  const double * RESTRICT B, double * RESTRICT C)
+        {
+            batch<N,16,1,2>(order, A, B, C);
+        }
+
+#ifdef PRK_DGEMM_SIMD
+        template <int N>
+        __attribute__((target("avx2,fma")))
+        static void batch_avx2(const int order, const double * RESTRICT A,
+                               const double * RESTRICT B, double * RESTRICT C)
+        {
+            batch<N,32,2,2>(order, A, B, C);
+        }
+
+        template <int N>
+        __attribute__((target("avx512f")))
+        static void batch_avx512(const int order, const double * RESTRICT A,
+                                 const double * RESTRICT B, double * RESTRICT C)
+        {
+            batch<N,64,4,4>(order, A, B, C);
+        }
+#endif /* PRK_DGEMM_SIMD */
+
+        template <int N>
+        static inline dgemm_batch_fn batch_get(const std::string & isa)
+        {
+#ifdef PRK_DGEMM_SIMD
+            if (isa == "avx512") return batch_avx512<N>;
+            if (isa == "avx2")   return batch_avx2<N>;
+#else
+            (void)isa;
+#endif
+            return batch_generic<N>;
+        }
+
+    } // namespace dgemm_detail
+
+    /// The widest micro-kernel the CPU supports, capped by PRK_DGEMM_ISA.
+    static inline std::string dgemm_isa(void)
+    {
+        const char * env = std::getenv("PRK_DGEMM_ISA");
+        const std::string limit = (env != nullptr) ? std::string(env) : std::string("avx512");
+#ifdef PRK_DGEMM_SIMD
+        if ( (limit=="avx512") && __builtin_cpu_supports("avx512f") ) return "avx512";
+        if ( (limit=="avx512" || limit=="avx2") && __builtin_cpu_supports("avx2")
+                                                && __builtin_cpu_supports("fma") ) return "avx2";
+#endif
+        return "none";
+    }
+
+    /// The batched kernel for the order, specialized if the order is 4, 8, 16 or 32.
+    static inline dgemm_batch_fn make_dgemm_batch(const int order, const std::string & isa)
+    {
+        switch (order) {
+            case 4:  return dgemm_detail::batch_get<4>(isa);
+            case 8:  return dgemm_detail::batch_get<8>(isa);
+            case 16: return dgemm_detail::batch_get<16>(isa);
+            case 32: return dgemm_detail::batch_get<32>(isa);
+            default: return dgemm_detail::batch_get<0>(isa);
+        }
+    }
+
+    /// Whether make_dgemm_batch has a specialization for the order.
+    static inline bool dgemm_batch_specialized(const int order)
+    {
+        return (order==4 || order==8 || order==16 || order==32);
+    }
+
+    /// C += A * B with packing buffers that are reused across calls.
+    ///
+    /// The engine runs as nranks ranks split into groups of consecutive
+    /// ranks, one per NUMA node by default.  The columns of C are cut into
+    /// one strip per group, and each group packs the KC x NC panels of B of
+    /// its strip into a buffer of its own, every rank of the group a share
+    /// of the micro-panels.  The ranks of a group then take MC-row blocks
+    /// of C in the strip, each packing its block of A into a private
+    /// buffer; when there are fewer row blocks than ranks, the strip is
+    /// also cut into columns.  A buffer is first written by the ranks that
+    /// use it, so it lands on their node when the ranks are pinned.
+    ///
+    /// operator() takes a for_all(f) that calls f(rank) for every rank and
+    /// returns when all have finished, e.g. an OpenMP loop with
+    /// schedule(static,1) in a parallel region or a thread_pool parallel_for.
+    class dgemm_packed {
+
+        private:
+            dgemm_detail::config cfg_;
+            int nranks_;
+            int groups_;
+            std::vector<prk::vector<double>> Ap_;  // per rank
+            std::vector<prk::vector<double>> Bp_;  // per group
+
+            // ranks [first(g),first(g+1)) form group g
+            int first(const int g) const { return (g*nranks_)/groups_; }
+
+            int group(const int rank) const {
+                int g = 0;
+                while (rank >= first(g+1)) ++g;
+                return g;
+            }
+
+        public:
+            explicit dgemm_packed(const std::string & isa = prk::dgemm_isa(),
+                                  const int nranks = 1, const int groups = 1)
+                : cfg_(dgemm_detail::get(isa)),
+                  nranks_(std::max(1,nranks)),
+                  groups_(std::min(std::max(1,groups),std::max(1,nranks)))
+            {
+                // the cache blocks are whole register blocks
+                const auto mc = prk::bench::getenv_int("PRK_DGEMM_MC", cfg_.mc);
+                const auto nc = prk::bench::getenv_int("PRK_DGEMM_NC", cfg_.nc);
+                cfg_.kc = std::max(1, prk::bench::getenv_int("PRK_DGEMM_KC", cfg_.kc));
+                cfg_.mc = std::max(1, mc/cfg_.mr) * cfg_.mr;
+                cfg_.nc = std::max(1, nc/cfg_.nr) * cfg_.nr;
+                for (auto r=0; r<nranks_; ++r) {
+                    Ap_.emplace_back(static_cast<size_t>(cfg_.mc)*cfg_.kc, prk::uninitialized);
+                }
+                for (auto g=0; g<groups_; ++g) {
+                    Bp_.emplace_back(static_cast<size_t>(cfg_.kc)*cfg_.nc, prk::uninitialized);
+                }
+            }
+
+            int mr(void) const { return cfg_.mr; }
+            int nr(void) const { return cfg_.nr; }
+            int mc(void) const { return cfg_.mc; }
+            int kc(void) const { return cfg_.kc; }
+            int nc(void) const { return cfg_.nc; }
+            int ranks(void) const { return nranks_; }
+            int groups(void) const { return groups_; }
+
+            /// C(m x n, ldc) += A(m x k, lda) * B(k x n, ldb) on one rank
+            void operator()(const int m, const int n, const int k,
+                            const double * RESTRICT A, const int lda,
+                            const double * RESTRICT B, const int ldb,
+                                  double * RESTRICT C, const int ldc)
+            {
+                (*this)([](const auto & f) { f(0); }, m, n, k, A, lda, B, ldb, C, ldc);
+            }
+
+            /// C(m x n, ldc) += A(m x k, lda) * B(k x n, ldb) on all ranks
+            template <typename ForAll>
+            void operator()(const ForAll & for_all,
+                            const int m, const int n, const int k,
+                            const double * RESTRICT A, const int lda,
+                            const double * RESTRICT B, const int ldb,
+                                  double * RESTRICT C, const int ldc)
+            {
+                const auto MR = cfg_.mr, NR = cfg_.nr;
+                // the strips have the same width, so all groups take the same steps
+                const auto strip = prk::divceil(prk::divceil(n, groups_), NR) * NR;
+                for (auto jc=0; jc<strip; jc+=cfg_.nc) {
+                    for (auto pc=0; pc<k; pc+=cfg_.kc) {
+                        const auto kc = std::min(cfg_.kc, k-pc);
+
+                        for_all([&](const int rank) {
+                            const auto g = group(rank);
+                            const auto j0 = g*strip+jc;
+                            const auto nc = std::max(0, std::min({cfg_.nc, strip-jc, n-j0}));
+                            const auto q = rank-first(g), nq = first(g+1)-first(g);
+                            // micro-panels q, q+nq, ... of the panel
+                            double * RESTRICT Bp = Bp_[g].data();
+                            for (auto jr=q*NR; jr<nc; jr+=nq*NR) {
+                                dgemm_detail::pack_b(kc, std::min(NR,nc-jr), NR, &B[pc*ldb+j0+jr], ldb, &Bp[jr*kc]);
+                            }
+                        });
+
+                        for_all([&](const int rank) {
+                            const auto g = group(rank);
+                            const auto j0 = g*strip+jc;
+                            const auto nc = std::max(0, std::min({cfg_.nc, strip-jc, n-j0}));
+                            const auto q = rank-first(g), nq = first(g+1)-first(g);
+                            // row blocks no taller than needed to give every rank one
+                            const auto mb = std::min(cfg_.mc, prk::divceil(prk::divceil(m, nq), MR) * MR);
+                            const auto mblocks = prk::divceil(m, mb);
+                            const auto nblocks = prk::divceil(nq, mblocks);
+                            const auto nb = prk::divceil(prk::divceil(nc, nblocks), NR) * NR;
+                            const double * RESTRICT Bp = Bp_[g].data();
+                            double * RESTRICT Ap = Ap_[rank].data();
+                            for (auto b=q; b<mblocks*nblocks; b+=nq) {
+                                const auto ic = (b/nblocks)*mb, mc = std::min(mb, m-ic);
+                                const auto j1 = (b%nblocks)*nb, j2 = std::min(nc, j1+nb);
+                                if (j1 >= j2) continue;
+                                dgemm_detail::pack_a(mc, kc, MR, &A[ic*lda+pc], lda, Ap);
+                                // a micro-panel of B stays in L1 while those of A stream from L2
+                                for (auto jr=j1; jr<j2; jr+=NR) {
+                                    for (auto ir=0; ir<mc; ir+=MR) {
+                                        cfg_.micro(kc, &Ap[ir*kc], &Bp[jr*kc], &C[(ic+ir)*ldc+j0+jr], ldc,
+                                                   std::min(MR,mc-ir), std::min(NR,nc-jr));
+                                    }
+                                }
+                            }
+                        });
+                    }
+                }
+            }
+    };
+
+} // namespace prk
+
+#endif /* PRK_DGEMM_H */
@@ -0,0 +1,85 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_PRECISION_H
+#define PRK_PRECISION_H
+
+// This header is included at the end of prk_util.h.
+
+namespace prk {
+
+    /// Storage and compute precision of the kernels, selected at runtime with
+    ///
+    ///   PRK_PRECISION=double  store and compute in double (default)
+    ///   PRK_PRECISION=float   store and compute in float
+    ///   PRK_PRECISION=mixed   store the inputs in float and accumulate the
+    ///                         result in double
+    ///
+    /// The drivers template their body on the input type TI and the result
+    /// type TO, i.e. run<double,double>, run<float,float> or run<float,double>.
+    namespace precision {
+
+        enum class kind { fp64, fp32, mixed };
+
+        // throws if PRK_PRECISION is set to something else
+        static inline kind get(void)
+        {
+            const char * temp = std::getenv("PRK_PRECISION");
+            if (temp==nullptr) return kind::fp64;
+            const std::string p(temp);
+            if (p=="double") return kind::fp64;
+            if (p=="float")  return kind::fp32;
+            if (p=="mixed")  return kind::mixed;
+            throw "ERROR: PRK_PRECISION must be double, float or mixed";
+        }
+
+        template <typename TI, typename TO>
+        const char * name(void)
+        {
+            return std::is_same<TI,double>::value ? "double" : std::is_same<TO,double>::value ? "mixed" : "float";
+        }
+
+        /// Verification tolerance for a result accumulated in TO from values
+        /// of magnitude up to scale: the double tolerance eps of the kernel,
+        /// which is far above the rounding error in double, or 16 roundings
+        /// of scale in float.
+        template <typename TO>
+        double epsilon(double eps, double scale)
+        {
+            return std::is_same<TO,float>::value ? 16.0*std::numeric_limits<float>::epsilon()*scale : eps;
+        }
+
+    } // namespace precision
+
+} // namespace prk
+
+#endif /* PRK_PRECISION_H */
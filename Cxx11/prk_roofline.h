@@ -0,0 +1,266 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_ROOFLINE_H
+#define PRK_ROOFLINE_H
+
+// This header is included at the end of prk_util.h and relies on prk::wtime.
+
+#if defined(USE_OPENMP) && defined(_OPENMP)
+# define PRK_ROOFLINE_OMP(x) PRAGMA(omp x)
+#else
+# define PRK_ROOFLINE_OMP(x)
+#endif
+
+namespace prk {
+
+    /// Roofline report mode, enabled with PRK_ROOFLINE=1.
+    ///
+    /// The first report calibrates the host with the same number of threads
+    /// the kernel uses (all OpenMP threads, otherwise one):
+    ///
+    ///   DRAM bandwidth   nstream triad on arrays much larger than the LLC
+    ///                    (PRK_ROOFLINE_DRAM_MB in total, default 384)
+    ///   cache bandwidth  the same triad on arrays that fit in L2
+    ///   peak flop rate   a register-resident multiply-add loop
+    ///
+    /// Calibration can be skipped by setting PRK_ROOFLINE_DRAM_BW,
+    /// PRK_ROOFLINE_CACHE_BW (GB/s) and PRK_ROOFLINE_FLOPS (GFlop/s),
+    /// e.g. to the vendor peaks or to numbers measured with other tools.
+    ///
+    /// Each kernel describes one iteration with a prk::roofline::work, i.e.
+    /// its flops and its compulsory memory traffic, and reports
+    ///
+    ///   prk::roofline::report(prk::roofline::nstream(length), avgtime);
+    namespace roofline {
+
+        static inline bool enabled(void)
+        {
+            const char * temp = std::getenv("PRK_ROOFLINE");
+            return (temp!=nullptr) && (std::atoi(temp) != 0);
+        }
+
+        struct peaks {
+            double dram;  // bytes/s
+            double cache; // bytes/s
+            double flops; // flop/s
+            int threads;
+        };
+
+        static inline int threads(void)
+        {
+#if defined(USE_OPENMP) && defined(_OPENMP)
+            return omp_get_max_threads();
+#else
+            return 1;
+#endif
+        }
+
+        // best-of-trials bandwidth of sweeps over a += b + s*c, counting 4 words per element
+        static inline double triad(size_t length, int sweeps, int trials)
+        {
+            std::vector<double> a(length), b(length), c(length);
+            PRK_ROOFLINE_OMP(parallel for simd)
+            for (size_t i=0; i<length; i++) {
+                a[i] = 0.0;
+                b[i] = 2.0;
+                c[i] = 2.0;
+            }
+            const double scalar = 3.0;
+            double best = 0.0;
+            for (int r=0; r<trials; ++r) {
+                const double t0 = prk::wtime();
+                PRK_ROOFLINE_OMP(parallel)
+                for (int k=0; k<sweeps; ++k) {
+                    PRK_ROOFLINE_OMP(for simd)
+                    for (size_t i=0; i<length; i++) {
+                        a[i] += b[i] + scalar * c[i];
+                    }
+                }
+                const double t = prk::wtime() - t0;
+                if (t > 0.0) best = std::max(best, 4.0*sizeof(double)*length*sweeps/t);
+            }
+            volatile double sink = a[length/2];
+            (void)sink;
+            return best;
+        }
+
+        // flop rate of many independent multiply-adds that stay in registers
+        static inline double fma(void)
+        {
+            constexpr int rows = 16;
+            constexpr int width = 8;
+            const int reps = 1<<20;
+            double best = 0.0;
+            for (int trial=0; trial<3; ++trial) {
+                const double t0 = prk::wtime();
+                double sum = 0.0;
+                PRK_ROOFLINE_OMP(parallel reduction(+:sum))
+                {
+                    double x[rows][width];
+                    for (int k=0; k<rows; ++k) {
+                        for (int j=0; j<width; ++j) {
+                            x[k][j] = 1.0 + 0.001*(k*width+j);
+                        }
+                    }
+                    const double a = 0.999999, b = 1.0e-6;
+                    for (int r=0; r<reps; ++r) {
+                        for (int k=0; k<rows; ++k) {
+                            PRAGMA_SIMD
+                            for (int j=0; j<width; ++j) {
+                                x[k][j] = x[k][j] * a + b;
+                            }
+                        }
+                    }
+                    for (int k=0; k<rows; ++k) {
+                        for (int j=0; j<width; ++j) {
+                            sum += x[k][j];
+                        }
+                    }
+                }
+                const double t = prk::wtime() - t0;
+                volatile double sink = sum;
+                (void)sink;
+                if (t > 0.0) best = std::max(best, 2.0*rows*width*reps*threads()/t);
+            }
+            return best;
+        }
+
+        static inline const peaks & host(void)
+        {
+            static peaks p = [] {
+                peaks q;
+                q.threads = threads();
+                const double dram_bw  = prk::bench::getenv_double("PRK_ROOFLINE_DRAM_BW",0.0);
+                const double cache_bw = prk::bench::getenv_double("PRK_ROOFLINE_CACHE_BW",0.0);
+                const double flops    = prk::bench::getenv_double("PRK_ROOFLINE_FLOPS",0.0);
+                const size_t dram_mb  = std::max(1,prk::bench::getenv_int("PRK_ROOFLINE_DRAM_MB",384));
+                // three arrays; the cache-resident ones are 32 KiB each per thread
+                const size_t dram_length  = (dram_mb << 20) / (3*sizeof(double));
+                const size_t cache_length = 4096 * q.threads;
+                q.dram  = (dram_bw  > 0.0) ? 1.e9*dram_bw  : triad(dram_length, 1, 5);
+                q.cache = (cache_bw > 0.0) ? 1.e9*cache_bw : triad(cache_length, 1000, 10);
+                q.flops = (flops    > 0.0) ? 1.e9*flops    : fma();
+                std::cout << "Roofline peaks: DRAM " << 1.e-9*q.dram << " GB/s, cache "
+                          << 1.e-9*q.cache << " GB/s, compute " << 1.e-9*q.flops
+                          << " GFlop/s (" << q.threads << " threads)" << std::endl;
+                return q;
+            }();
+            return p;
+        }
+
+        /// Flops and compulsory memory traffic of one iteration of a kernel.
+        /// word is the mean size in bytes of the words moved, which is not
+        /// an integer in mixed precision.
+        struct work {
+            double flops;
+            double bytes;
+        };
+
+        // A += B + s*C
+        static inline work nstream(size_t length, double word = sizeof(double))
+        {
+            return { 3.0*length, 4.0*word*length };
+        }
+
+        // B += A^T; A += 1, both arrays are read and written
+        static inline work transpose(size_t order, double word = sizeof(double))
+        {
+            const double n2 = static_cast<double>(order)*static_cast<double>(order);
+            return { 2.0*n2, 4.0*word*n2 };
+        }
+
+        // A = A^T + 1 in place
+        static inline work transpose_inplace(size_t order, double word = sizeof(double))
+        {
+            const double n2 = static_cast<double>(order)*static_cast<double>(order);
+            return { n2, 2.0*word*n2 };
+        }
+
+        // out += S(in) over the interior, then in += 1 everywhere
+        static inline work stencil(size_t n, size_t active_points, int stencil_size, double word = sizeof(double))
+        {
+            const double n2 = static_cast<double>(n)*static_cast<double>(n);
+            return { (2.0*stencil_size+1.0)*active_points, 5.0*word*n2 };
+        }
+
+        // the same in one sweep, with in updated while it is in cache
+        static inline work stencil_fused(size_t n, size_t active_points, int stencil_size, double word = sizeof(double))
+        {
+            const double n2 = static_cast<double>(n)*static_cast<double>(n);
+            return { (2.0*stencil_size+1.0)*active_points, 4.0*word*n2 };
+        }
+
+        // the 3D stencil, with every plane read once per sweep (2.5D blocking)
+        static inline work stencil3d(size_t n, size_t active_points, int stencil_size, double word = sizeof(double))
+        {
+            const double n3 = static_cast<double>(n)*static_cast<double>(n)*static_cast<double>(n);
+            return { (2.0*stencil_size+1.0)*active_points, 5.0*word*n3 };
+        }
+
+        // C += A * B
+        static inline work dgemm(size_t order, double word = sizeof(double))
+        {
+            const double n2 = static_cast<double>(order)*static_cast<double>(order);
+            return { 2.0*n2*order, 4.0*word*n2 };
+        }
+
+        // result += A * vector in CSR, with index_word bytes per column index
+        // (on average, for compressed indices)
+        static inline work sparse(size_t nent, size_t rows, double index_word, double word = sizeof(double))
+        {
+            return { 2.0*nent, static_cast<double>(nent)*(word+index_word) + 3.0*word*rows };
+        }
+
+        /// Prints arithmetic intensity and the fraction of the DRAM and cache
+        /// rooflines achieved, or nothing unless PRK_ROOFLINE is set.
+        static inline void report(const work & w, double avgtime)
+        {
+            if (!enabled() || avgtime <= 0.0 || w.bytes <= 0.0) return;
+            const peaks & p = host();
+            const double ai       = w.flops / w.bytes;
+            const double achieved = w.flops / avgtime;
+            const double dram     = std::min(p.flops, ai * p.dram);
+            const double cache    = std::min(p.flops, ai * p.cache);
+            std::cout << "Roofline: arithmetic intensity " << ai << " flops/byte, "
+                      << 1.e-9*achieved << " GFlop/s achieved" << std::endl;
+            std::cout << "Roofline: " << 100.*achieved/dram << "% of DRAM roof ("
+                      << 1.e-9*dram << " GFlop/s), " << 100.*achieved/cache << "% of cache roof ("
+                      << 1.e-9*cache << " GFlop/s), "
+                      << ((ai * p.dram < p.flops) ? "memory" : "compute") << "-bound" << std::endl;
+        }
+
+    } // namespace roofline
+
+} // namespace prk
+
+#endif /* PRK_ROOFLINE_H */
@@ -0,0 +1,871 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_SPARSE_H
+#define PRK_SPARSE_H
+
+/// The PRK sparse matrix and the row partition of the parallel drivers.
+///
+/// Row r of the matrix belongs to point (r%size, r/size) of a periodic
+/// 2^lsize x 2^lsize grid and has the 4*radius+1 entries of the star
+/// stencil around it, with sorted column indices c and values 1/(c+1).
+/// With scrambling, the point indices are bit-reversed, which spreads the
+/// columns of a row over the whole vector.
+///
+/// The parallel drivers cut the rows into one contiguous range per
+/// thread and use the same ranges to assemble the matrix, to update the
+/// vector and to multiply, so the rows of the matrix, and the parts of
+/// the vectors with the same index, are first touched by the thread, and
+/// hence the NUMA node, that computes on them.
+///
+/// Besides the row-major (CSR) loop, the drivers can multiply in the
+/// SELL-C-sigma format (Kreutzer et al., SISC 2014): the rows are cut into
+/// chunks of C rows, C the number of doubles in a SIMD register, and the
+/// entries of a chunk are stored column by column, padded to the longest
+/// row of the chunk, so every step of the kernel is one vector load of
+/// the values, one vector load of the column indices, one gather of the
+/// vector and one FMA, and a chunk's C results are one vector add.  The
+/// rows are first sorted by length inside windows of sigma rows to keep
+/// the padding small (PRK_SPARSE_SIGMA, default 1, i.e. unsorted).
+/// Blocked ELLPACK is the same layout with every chunk padded to the
+/// longest row of the matrix, which needs no chunk offsets.
+///
+/// prk::sparse::simd_isa() picks the widest kernel the CPU supports,
+/// limited by PRK_SPARSE_ISA=none|avx2|avx512.
+///
+/// Reordering renumbers the rows and the columns to shorten the distance
+/// between the columns of a row, so the gathers of the vector hit cache
+/// lines the row before already loaded.  rcm() is reverse Cuthill-McKee
+/// (George and Liu, 1981) and sfc() sorts along a Morton or Hilbert curve
+/// through the points the rows and columns belong to.
+
+#include "prk_util.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# define PRK_SPARSE_SIMD 1
+# include <immintrin.h>
+#endif
+
+#define PRK_SPARSE_INLINE inline __attribute__((always_inline))
+
+namespace prk {
+
+    namespace sparse {
+
+#if SCRAMBLE
+        constexpr bool scrambled = true;
+#else
+        constexpr bool scrambled = false;
+#endif
+
+        static inline size_t offset(size_t i, size_t j, size_t lsize)
+        {
+            return (i+(j<<lsize));
+        }
+
+        // Reverses the bits of x with respect to the largest integer of
+        // shift_in_bits bits, so the result is a permutation of [0,2^shift_in_bits).
+        // E.g. for 8 bits, 6 = 0...0110 reverses to 3*2^61 and is shifted
+        // right by 64-8 bits to 96 = 0...01100000.
+        static inline uint64_t reverse(uint64_t x, int shift_in_bits)
+        {
+            x = ((x >> 1)  & 0x5555555555555555) | ((x << 1)  & 0xaaaaaaaaaaaaaaaa);
+            x = ((x >> 2)  & 0x3333333333333333) | ((x << 2)  & 0xcccccccccccccccc);
+            x = ((x >> 4)  & 0x0f0f0f0f0f0f0f0f) | ((x << 4)  & 0xf0f0f0f0f0f0f0f0);
+            x = ((x >> 8)  & 0x00ff00ff00ff00ff) | ((x << 8)  & 0xff00ff00ff00ff00);
+            x = ((x >> 16) & 0x0000ffff0000ffff) | ((x << 16) & 0xffff0000ffff0000);
+            x = ((x >> 32) & 0x00000000ffffffff) | ((x << 32) & 0xffffffff00000000);
+            return ( x >> (8*sizeof(uint64_t)-shift_in_bits) );
+        }
+
+        /// The 4*radius+1 sorted column indices and the values of a row.
+        template <typename I>
+        static inline void build_row(const size_t row, const int lsize, const unsigned radius, const bool scramble,
+                                     I * RESTRICT colIndex, double * RESTRICT matrix)
+        {
+            const size_t size = 1L<<lsize;
+            const size_t i = row % size;
+            const size_t j = row / size;
+            auto index = [=](size_t x) { return static_cast<I>(scramble ? reverse(x,2*lsize) : x); };
+            size_t elm = 0;
+            colIndex[elm] = index(offset(i,j,lsize));
+            for (size_t r=1; r<=radius; r++, elm+=4) {
+                colIndex[elm+1] = index(offset((i+r)%size,j,lsize));
+                colIndex[elm+2] = index(offset((i-r+size)%size,j,lsize));
+                colIndex[elm+3] = index(offset(i,(j+r)%size,lsize));
+                colIndex[elm+4] = index(offset(i,(j-r+size)%size,lsize));
+            }
+            const size_t stencil_size = 4*radius+1;
+            std::sort(colIndex, colIndex+stencil_size);
+            for (size_t e=0; e<stencil_size; e++) {
+                matrix[e] = 1.0/(colIndex[e]+1.);
+            }
+        }
+
+        /// The first row of part p of nparts contiguous ranges of rows;
+        /// part p has the rows [first_row(rows,p,nparts),first_row(rows,p+1,nparts)).
+        static inline size_t first_row(const size_t rows, const int p, const int nparts)
+        {
+            return (rows/nparts)*p + std::min(rows%nparts, static_cast<size_t>(p));
+        }
+
+        /// The arrays of a SELL-C-sigma matrix: the entries of chunk c are
+        /// [ptr[c],ptr[c+1]), entry j of slot l at ptr[c]+j*C+l, and slot
+        /// c*C+l holds row perm[c*C+l], or row c*C+l if perm is null.
+        template <typename I>
+        struct sell_arrays {
+            size_t nrows;
+            const size_t * ptr;
+            const I * col;
+            const double * val;
+            const size_t * perm;
+        };
+
+        /// y += A x for the rows of the chunks [c0,c1)
+        template <typename I>
+        using sell_fn = void (*)(const sell_arrays<I> & a, size_t c0, size_t c1,
+                                 const double * RESTRICT x, double * RESTRICT y);
+
+        namespace detail {
+
+            template <typename V, int C>
+            struct gather_generic {
+                template <typename I>
+                static PRK_SPARSE_INLINE void get(V & g, const double * RESTRICT x, const I * RESTRICT col) {
+                    for (int l=0; l<C; ++l) g[l] = x[col[l]];
+                }
+            };
+
+            template <typename V, int C, typename G, typename I>
+            static PRK_SPARSE_INLINE void sell_chunks(const sell_arrays<I> & a, size_t c0, size_t c1,
+                                                      const double * RESTRICT x, double * RESTRICT y)
+            {
+                for (size_t c=c0; c<c1; ++c) {
+                    V acc = {};
+                    for (size_t e=a.ptr[c]; e<a.ptr[c+1]; e+=C) {
+                        V v, g;
+                        __builtin_memcpy(&v, &a.val[e], sizeof(V));
+                        G::get(g, x, &a.col[e]);
+                        acc += v * g;
+                    }
+                    const size_t r0 = c*C;
+                    if (a.perm == nullptr && r0+C <= a.nrows) {
+                        V b;
+                        __builtin_memcpy(&b, &y[r0], sizeof(V));
+                        b += acc;
+                        __builtin_memcpy(&y[r0], &b, sizeof(V));
+                    } else {
+                        // the sorted rows, or the last chunk, which may be partial
+                        for (int l=0; l<C; ++l) {
+                            if (r0+l < a.nrows) y[a.perm ? a.perm[r0+l] : r0+l] += acc[l];
+                        }
+                    }
+                }
+            }
+
+            typedef double v4d __attribute__((vector_size(32)));
+            typedef double v8d __attribute__((vector_size(64)));
+
+            template <typename I>
+            static void sell_generic(const sell_arrays<I> & a, size_t c0, size_t c1,
+                                     const double * RESTRICT x, double * RESTRICT y)
+            {
+                sell_chunks<v4d,4,gather_generic<v4d,4>>(a, c0, c1, x, y);
+            }
+
+#ifdef PRK_SPARSE_SIMD
+
+            // not always_inline: the gathers are inlined once sell_chunks is
+            // inlined into the kernel with the matching target
+            struct gather_avx2 {
+                __attribute__((target("avx2")))
+                static inline void get(v4d & g, const double * RESTRICT x, const size_t * RESTRICT col) {
+                    const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col));
+                    g = _mm256_i64gather_pd(x, i, sizeof(double));
+                }
+                __attribute__((target("avx2")))
+                static inline void get(v4d & g, const double * RESTRICT x, const uint32_t * RESTRICT col) {
+                    const __m128i i = _mm_loadu_si128(reinterpret_cast<const __m128i*>(col));
+                    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+                    g = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, i, all, sizeof(double));
+                }
+            };
+
+            struct gather_avx512 {
+                __attribute__((target("avx512f")))
+                static inline void get(v8d & g, const double * RESTRICT x, const size_t * RESTRICT col) {
+                    const __m512i i = _mm512_loadu_si512(col);
+                    g = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, i, x, sizeof(double));
+                }
+                __attribute__((target("avx512f")))
+                static inline void get(v8d & g, const double * RESTRICT x, const uint32_t * RESTRICT col) {
+                    const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col));
+                    g = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, i, x, sizeof(double));
+                }
+            };
+
+            template <typename I>
+            __attribute__((target("avx2,fma")))
+            static void sell_avx2(const sell_arrays<I> & a, size_t c0, size_t c1,
+                                  const double * RESTRICT x, double * RESTRICT y)
+            {
+                sell_chunks<v4d,4,gather_avx2>(a, c0, c1, x, y);
+            }
+
+            template <typename I>
+            __attribute__((target("avx512f")))
+            static void sell_avx512(const sell_arrays<I> & a, size_t c0, size_t c1,
+                                    const double * RESTRICT x, double * RESTRICT y)
+            {
+                sell_chunks<v8d,8,gather_avx512>(a, c0, c1, x, y);
+            }
+
+#endif /* PRK_SPARSE_SIMD */
+
+            /// the kernel and its chunk height C
+            template <typename I>
+            static inline std::pair<sell_fn<I>,int> sell_get(const std::string & isa)
+            {
+#ifdef PRK_SPARSE_SIMD
+                if (isa == "avx512") return { sell_avx512<I>, 8 };
+                if (isa == "avx2")   return { sell_avx2<I>,   4 };
+#else
+                (void)isa;
+#endif
+                return { sell_generic<I>, 4 };
+            }
+
+        } // namespace detail
+
+        /// The widest SpMV kernel the CPU supports, capped by PRK_SPARSE_ISA.
+        static inline std::string simd_isa(void)
+        {
+            const char * env = std::getenv("PRK_SPARSE_ISA");
+            const std::string limit = (env != nullptr) ? std::string(env) : std::string("avx512");
+#ifdef PRK_SPARSE_SIMD
+            if ( (limit=="avx512") && __builtin_cpu_supports("avx512f") ) return "avx512";
+            if ( (limit=="avx512" || limit=="avx2") && __builtin_cpu_supports("avx2")
+                                                    && __builtin_cpu_supports("fma") ) return "avx2";
+#endif
+            return "none";
+        }
+
+        /// A CSR matrix converted to SELL-C-sigma, or to blocked ELLPACK if
+        /// uniform, with column indices of type I (size_t or uint32_t).
+        /// rowptr(r) is the first entry of row r in the CSR arrays.
+        /// The constructor only lays out the chunks, assign() copies the
+        /// entries, so the parallel drivers can copy, and first touch, the
+        /// chunks with the same schedule that multiplies them.
+        template <typename I = size_t>
+        class sell {
+
+            private:
+                sell_fn<I> kernel_;
+                int C_;
+                size_t nrows_;
+                size_t nchunks_;
+                std::vector<size_t> ptr_;
+                std::vector<size_t> perm_;
+                prk::vector<I> col_;
+                prk::vector<double> val_;
+
+                sell_arrays<I> arrays(void) const {
+                    return { nrows_, ptr_.data(), col_.data(), val_.data(), perm_.empty() ? nullptr : perm_.data() };
+                }
+
+                size_t row(size_t slot) const {
+                    return perm_.empty() ? slot : perm_[slot];
+                }
+
+            public:
+                template <typename RowPtr>
+                sell(const std::string & isa, const size_t nrows, RowPtr rowptr, const int sigma, const bool uniform)
+                  : kernel_(detail::sell_get<I>(isa).first), C_(detail::sell_get<I>(isa).second), nrows_(nrows)
+                {
+                    nchunks_ = prk::divceil(nrows, static_cast<size_t>(C_));
+                    auto length = [&](size_t r) { return static_cast<size_t>(rowptr(r+1) - rowptr(r)); };
+
+                    if (sigma > 1) {
+                        perm_.resize(nrows);
+                        std::iota(perm_.begin(), perm_.end(), size_t(0));
+                        for (size_t w=0; w<nrows; w+=sigma) {
+                            std::stable_sort(perm_.begin()+w, perm_.begin()+std::min(w+sigma,nrows),
+                                             [&](size_t i, size_t j) { return length(i) > length(j); });
+                        }
+                    }
+
+                    std::vector<size_t> width(nchunks_, 0);
+                    for (size_t s=0; s<nrows; ++s) {
+                        width[s/C_] = std::max(width[s/C_], length(row(s)));
+                    }
+                    if (uniform) {
+                        const size_t w = nrows ? *std::max_element(width.begin(), width.end()) : 0;
+                        std::fill(width.begin(), width.end(), w);
+                    }
+
+                    ptr_.resize(nchunks_+1);
+                    ptr_[0] = 0;
+                    for (size_t c=0; c<nchunks_; ++c) {
+                        ptr_[c+1] = ptr_[c] + C_*width[c];
+                    }
+                    col_ = prk::vector<I>(ptr_[nchunks_], prk::uninitialized);
+                    val_ = prk::vector<double>(ptr_[nchunks_], prk::uninitialized);
+                }
+
+                /// copies the entries of the chunks [c0,c1) from the CSR arrays;
+                /// the padding repeats the last column of its row with value 0
+                template <typename RowPtr>
+                void assign(const size_t c0, const size_t c1, RowPtr rowptr,
+                            const size_t * RESTRICT colIndex, const double * RESTRICT matrix)
+                {
+                    for (size_t c=c0; c<c1; ++c) {
+                        const size_t w = (ptr_[c+1]-ptr_[c])/C_;
+                        for (int l=0; l<C_; ++l) {
+                            const size_t s = c*C_+l;
+                            size_t b = 0, n = 0;
+                            if (s < nrows_) {
+                                b = rowptr(row(s));
+                                n = rowptr(row(s)+1) - b;
+                            }
+                            for (size_t j=0; j<w; ++j) {
+                                const size_t e = ptr_[c]+j*C_+l;
+                                col_[e] = static_cast<I>((j<n) ? colIndex[b+j] : (n ? colIndex[b+n-1] : 0));
+                                val_[e] = (j<n) ? matrix[b+j] : 0.0;
+                            }
+                        }
+                    }
+                }
+
+                /// y += A x for the rows of the chunks [c0,c1)
+                void multiply(const size_t c0, const size_t c1, const double * RESTRICT x, double * RESTRICT y) const
+                {
+                    kernel_(arrays(), c0, c1, x, y);
+                }
+
+                int chunk_height(void) const { return C_; }
+                size_t chunks(void) const { return nchunks_; }
+                /// the stored entries, padding included
+                size_t stored(void) const { return ptr_[nchunks_]; }
+                size_t index_bytes(void) const { return stored()*sizeof(I); }
+        };
+
+        /// The column indices of a CSR matrix with sorted rows, as deltas
+        /// bit-packed per row.  Row r starts at byte meta[r]>>8 of the stream
+        /// with its first column in hbits bits, followed by the differences of
+        /// its successive columns in meta[r]&255 bits each, the fewest that
+        /// hold the largest difference of the row.  The kernel decodes an
+        /// index with one unaligned 64-bit load, a shift and a mask, so a
+        /// field has at most 57 bits.  Rows start on byte boundaries, so
+        /// assign() can fill ranges of rows in parallel.
+        class delta_csr {
+
+            private:
+                size_t nrows_;
+                int hbits_;
+                prk::vector<uint64_t> meta_;
+                prk::vector<uint8_t> stream_;
+
+                static int bits(uint64_t v) {
+                    int b = 0;
+                    for (; v; v >>= 1) ++b;
+                    return b;
+                }
+
+                static PRK_SPARSE_INLINE uint64_t read(const uint8_t * RESTRICT p, const size_t bit, const uint64_t mask) {
+                    uint64_t w;
+                    __builtin_memcpy(&w, &p[bit>>3], sizeof(w));
+                    return (w >> (bit&7)) & mask;
+                }
+
+            public:
+                template <typename RowPtr>
+                delta_csr(const size_t nrows, const size_t ncols, RowPtr rowptr, const size_t * RESTRICT colIndex)
+                  : nrows_(nrows), hbits_(std::max(1,bits(ncols-1))), meta_(nrows, prk::uninitialized)
+                {
+                    size_t bytes = 0;
+                    for (size_t r=0; r<nrows; ++r) {
+                        const size_t b = rowptr(r), n = rowptr(r+1) - b;
+                        int w = 0;
+                        for (size_t k=1; k<n; ++k) {
+                            w = std::max(w, bits(colIndex[b+k] - colIndex[b+k-1]));
+                        }
+                        meta_[r] = (bytes << 8) | w;
+                        bytes += n ? prk::divceil(hbits_ + (n-1)*w, size_t(8)) : 0;
+                    }
+                    // the loads of the last fields read up to 7 bytes past the stream
+                    stream_ = prk::vector<uint8_t>(bytes+8, prk::uninitialized);
+                    std::fill(&stream_[bytes], &stream_[bytes+8], uint8_t(0));
+                }
+
+                /// encodes the rows [r0,r1)
+                template <typename RowPtr>
+                void assign(const size_t r0, const size_t r1, RowPtr rowptr, const size_t * RESTRICT colIndex)
+                {
+                    for (size_t r=r0; r<r1; ++r) {
+                        const size_t b = rowptr(r), n = rowptr(r+1) - b;
+                        if (n == 0) continue;
+                        uint8_t * p = &stream_[meta_[r] >> 8];
+                        const int w = meta_[r] & 255;
+                        // at most 7 pending bits plus a field of at most 57
+                        uint64_t acc = colIndex[b];
+                        int pending = hbits_;
+                        for (size_t k=1; k<=n; ++k) {
+                            while (pending >= 8) {
+                                *p++ = static_cast<uint8_t>(acc);
+                                acc >>= 8;
+                                pending -= 8;
+                            }
+                            if (k == n) break;
+                            acc |= (colIndex[b+k] - colIndex[b+k-1]) << pending;
+                            pending += w;
+                        }
+                        if (pending > 0) *p = static_cast<uint8_t>(acc);
+                    }
+                }
+
+                /// y += A x for the rows [r0,r1), the values in the CSR array matrix
+                template <typename RowPtr>
+                void multiply(const size_t r0, const size_t r1, RowPtr rowptr, const double * RESTRICT matrix,
+                              const double * RESTRICT x, double * RESTRICT y) const
+                {
+                    const uint64_t hmask = (uint64_t(1) << hbits_) - 1;
+                    for (size_t r=r0; r<r1; ++r) {
+                        const size_t b = rowptr(r), n = rowptr(r+1) - b;
+                        if (n == 0) continue;
+                        const uint8_t * RESTRICT p = &stream_[meta_[r] >> 8];
+                        const int w = meta_[r] & 255;
+                        const uint64_t mask = (uint64_t(1) << w) - 1;
+                        size_t col = read(p, 0, hmask);
+                        double temp = matrix[b]*x[col];
+                        size_t bit = hbits_;
+                        for (size_t k=1; k<n; ++k, bit+=w) {
+                            col += read(p, bit, mask);
+                            temp += matrix[b+k]*x[col];
+                        }
+                        y[r] += temp;
+                    }
+                }
+
+                /// the stream and the row offsets
+                size_t index_bytes(void) const { return stream_.size() + nrows_*sizeof(uint64_t); }
+        };
+
+        namespace detail {
+
+            template <typename I>
+            static inline void csr_rows(const size_t r0, const size_t r1, const size_t * RESTRICT rowptr,
+                                        const I * RESTRICT col, const double * RESTRICT val,
+                                        const double * RESTRICT x, double * RESTRICT y)
+            {
+                for (size_t r=r0; r<r1; ++r) {
+                    double temp(0);
+                    for (size_t e=rowptr[r]; e<rowptr[r+1]; ++e) {
+                        temp += val[e]*x[col[e]];
+                    }
+                    y[r] += temp;
+                }
+            }
+
+        } // namespace detail
+
+        /// The matrix of the timed loop, stored in format csr, sell or ell
+        /// with index 64 (size_t), 32 (uint32_t) or delta (csr only), and
+        /// built from CSR arrays, which 64-bit csr uses in place and which
+        /// must outlive the object.  The work is cut into units, rows for
+        /// csr and chunks of chunk_height() rows otherwise; assign() copies
+        /// and multiply() multiplies ranges of units, so a parallel driver
+        /// can give both the same schedule.
+        class stored_matrix {
+
+            private:
+                std::string format_, index_;
+                size_t nrows_, nent_;
+                const size_t * rowptr_;
+                const size_t * colIndex_;
+                const double * values_;
+                prk::vector<uint32_t> col32_;
+                std::unique_ptr<delta_csr> delta_;
+                std::unique_ptr<sell<size_t>> sell64_;
+                std::unique_ptr<sell<uint32_t>> sell32_;
+
+                bool csr(void) const { return format_ == "csr"; }
+
+            public:
+                /// the error of a combination that does not exist, or an empty string
+                static std::string check(const std::string & format, const std::string & index, const size_t ncols)
+                {
+                    if (format != "csr" && format != "sell" && format != "ell") return "format must be csr, sell or ell";
+                    if (index != "64" && index != "32" && index != "delta") return "index must be 64, 32 or delta";
+                    if (index == "32" && ncols > (size_t(1) << 32)) return "32-bit indices need fewer than 2^32 columns";
+                    if (index == "delta" && format != "csr") return "delta indices need the csr format";
+                    return "";
+                }
+
+                /// lays out the format; delta also reads the column indices
+                stored_matrix(const std::string & format, const std::string & index, const std::string & isa, const int sigma,
+                              const size_t nrows, const size_t ncols,
+                              const size_t * rowptr, const size_t * colIndex, const double * values)
+                  : format_(format), index_(index), nrows_(nrows), nent_(rowptr[nrows]),
+                    rowptr_(rowptr), colIndex_(colIndex), values_(values)
+                {
+                    auto rp = [rowptr](size_t r) { return rowptr[r]; };
+                    if (csr() && index == "32") {
+                        col32_ = prk::vector<uint32_t>(nent_, prk::uninitialized);
+                    } else if (csr() && index == "delta") {
+                        delta_.reset(new delta_csr(nrows, ncols, rp, colIndex));
+                    } else if (!csr() && index == "32") {
+                        sell32_.reset(new sell<uint32_t>(isa, nrows, rp, sigma, format == "ell"));
+                    } else if (!csr()) {
+                        sell64_.reset(new sell<size_t>(isa, nrows, rp, sigma, format == "ell"));
+                    }
+                }
+
+                size_t units(void) const {
+                    return sell32_ ? sell32_->chunks() : (sell64_ ? sell64_->chunks() : nrows_);
+                }
+
+                /// the rows of a unit, 1 for csr
+                int chunk_height(void) const {
+                    return sell32_ ? sell32_->chunk_height() : (sell64_ ? sell64_->chunk_height() : 1);
+                }
+
+                /// copies the units [u0,u1) from the CSR arrays
+                void assign(const size_t u0, const size_t u1)
+                {
+                    auto rp = [this](size_t r) { return rowptr_[r]; };
+                    if (col32_.size() > 0) {
+                        for (size_t e=rowptr_[u0]; e<rowptr_[u1]; ++e) col32_[e] = static_cast<uint32_t>(colIndex_[e]);
+                    } else if (delta_) {
+                        delta_->assign(u0, u1, rp, colIndex_);
+                    } else if (sell32_) {
+                        sell32_->assign(u0, u1, rp, colIndex_, values_);
+                    } else if (sell64_) {
+                        sell64_->assign(u0, u1, rp, colIndex_, values_);
+                    }
+                }
+
+                /// y += A x for the units [u0,u1)
+                void multiply(const size_t u0, const size_t u1, const double * RESTRICT x, double * RESTRICT y) const
+                {
+                    if (sell64_) {
+                        sell64_->multiply(u0, u1, x, y);
+                    } else if (sell32_) {
+                        sell32_->multiply(u0, u1, x, y);
+                    } else if (delta_) {
+                        delta_->multiply(u0, u1, [this](size_t r) { return rowptr_[r]; }, values_, x, y);
+                    } else if (index_ == "32") {
+                        detail::csr_rows(u0, u1, rowptr_, col32_.data(), values_, x, y);
+                    } else {
+                        detail::csr_rows(u0, u1, rowptr_, colIndex_, values_, x, y);
+                    }
+                }
+
+                /// the stored entries, padding included
+                size_t stored(void) const {
+                    return sell32_ ? sell32_->stored() : (sell64_ ? sell64_->stored() : nent_);
+                }
+
+                /// the column indices, and for csr the row offsets
+                size_t index_bytes(void) const {
+                    if (sell32_) return sell32_->index_bytes();
+                    if (sell64_) return sell64_->index_bytes();
+                    const size_t offsets = (nrows_+1)*sizeof(size_t);
+                    if (delta_) return delta_->index_bytes() + offsets;
+                    return nent_*(index_ == "32" ? sizeof(uint32_t) : sizeof(size_t)) + offsets;
+                }
+
+                size_t footprint(void) const { return stored()*sizeof(double) + index_bytes(); }
+        };
+
+        /// Row k of the reordered matrix is row rows[k] of the original and
+        /// column k of the reordered matrix is column cols[k] of the original.
+        struct ordering {
+            std::vector<size_t> rows;
+            std::vector<size_t> cols;
+        };
+
+        namespace detail {
+
+            // the columns in the order the rows of o.rows first reference them,
+            // then the columns that no row references
+            static inline void first_reference(ordering & o, const size_t ncols,
+                                               const size_t * rowptr, const size_t * colIndex)
+            {
+                std::vector<char> seen(ncols, 0);
+                o.cols.clear();
+                o.cols.reserve(ncols);
+                for (auto r : o.rows) {
+                    for (size_t e=rowptr[r]; e<rowptr[r+1]; ++e) {
+                        if (!seen[colIndex[e]]) {
+                            seen[colIndex[e]] = 1;
+                            o.cols.push_back(colIndex[e]);
+                        }
+                    }
+                }
+                for (size_t c=0; c<ncols; ++c) {
+                    if (!seen[c]) o.cols.push_back(c);
+                }
+            }
+
+            // breadth-first search of the graph in which two rows are adjacent if
+            // they share a column; every column is expanded once per search
+            // (colmark[c] == id), which is 2*nnz work rather than nnz*nnz/rows
+            class row_graph {
+                private:
+                    const size_t * rowptr_;
+                    const size_t * colIndex_;
+                    std::vector<size_t> colptr_;
+                    std::vector<size_t> colrows_;
+                public:
+                    row_graph(const size_t nrows, const size_t ncols, const size_t * rowptr, const size_t * colIndex)
+                      : rowptr_(rowptr), colIndex_(colIndex), colptr_(ncols+1, 0), colrows_(rowptr[nrows])
+                    {
+                        for (size_t e=0; e<rowptr[nrows]; ++e) colptr_[colIndex[e]+1]++;
+                        std::partial_sum(colptr_.begin(), colptr_.end(), colptr_.begin());
+                        std::vector<size_t> next(colptr_.begin(), colptr_.end()-1);
+                        for (size_t r=0; r<nrows; ++r) {
+                            for (size_t e=rowptr[r]; e<rowptr[r+1]; ++e) colrows_[next[colIndex[e]]++] = r;
+                        }
+                    }
+                    template <typename F>
+                    void neighbors(const size_t r, std::vector<unsigned> & colmark, const unsigned id, F visit) const {
+                        for (size_t e=rowptr_[r]; e<rowptr_[r+1]; ++e) {
+                            const size_t c = colIndex_[e];
+                            if (colmark[c] == id) continue;
+                            colmark[c] = id;
+                            for (size_t k=colptr_[c]; k<colptr_[c+1]; ++k) visit(colrows_[k]);
+                        }
+                    }
+                    size_t degree(const size_t r) const { return rowptr_[r+1] - rowptr_[r]; }
+            };
+
+            // the rows of the component of r level by level; returns the last level
+            static inline std::vector<size_t> levels(const row_graph & g, const size_t r, std::vector<unsigned> & stamp,
+                                                     std::vector<unsigned> & colmark, const unsigned id, size_t & depth)
+            {
+                std::vector<size_t> level(1, r), next;
+                stamp[r] = id;
+                depth = 0;
+                while (true) {
+                    next.clear();
+                    for (auto q : level) {
+                        g.neighbors(q, colmark, id, [&](size_t q2) {
+                            if (stamp[q2] != id) { stamp[q2] = id; next.push_back(q2); }
+                        });
+                    }
+                    if (next.empty()) return level;
+                    level.swap(next);
+                    ++depth;
+                }
+            }
+
+            // 2D Morton (Z-order) key: the bits of x and y interleaved
+            static inline uint64_t morton(uint64_t x, uint64_t y)
+            {
+                auto spread = [](uint64_t v) {
+                    v &= 0xffffffff;
+                    v = (v | (v << 16)) & 0x0000ffff0000ffff;
+                    v = (v | (v << 8))  & 0x00ff00ff00ff00ff;
+                    v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0f;
+                    v = (v | (v << 2))  & 0x3333333333333333;
+                    v = (v | (v << 1))  & 0x5555555555555555;
+                    return v;
+                };
+                return spread(x) | (spread(y) << 1);
+            }
+
+            // the distance of (x,y) along the Hilbert curve through a 2^bits x 2^bits grid
+            static inline uint64_t hilbert(uint64_t x, uint64_t y, const int bits)
+            {
+                uint64_t d = 0;
+                for (uint64_t s = uint64_t(1) << (bits-1); s > 0; s >>= 1) {
+                    const uint64_t rx = (x & s) ? 1 : 0;
+                    const uint64_t ry = (y & s) ? 1 : 0;
+                    d += s * s * ((3 * rx) ^ ry);
+                    // rotate the quadrant so the curve is continuous
+                    if (ry == 0) {
+                        if (rx == 1) {
+                            x = s-1 - (x & (s-1));
+                            y = s-1 - (y & (s-1));
+                        }
+                        std::swap(x, y);
+                    }
+                    x &= s-1;
+                    y &= s-1;
+                }
+                return d;
+            }
+
+            template <typename Point>
+            static inline std::vector<size_t> sfc_sort(const std::string & curve, const int bits, const size_t n, Point point)
+            {
+                std::vector<std::pair<uint64_t,size_t>> key(n);
+                for (size_t i=0; i<n; ++i) {
+                    const auto p = point(i);
+                    key[i] = { curve == "hilbert" ? hilbert(p.first, p.second, bits) : morton(p.first, p.second), i };
+                }
+                std::sort(key.begin(), key.end());
+                std::vector<size_t> order(n);
+                for (size_t i=0; i<n; ++i) order[i] = key[i].second;
+                return order;
+            }
+
+        } // namespace detail
+
+        /// Reverse Cuthill-McKee of the rows, on the graph in which two rows
+        /// are adjacent if they share a column (the pattern of A A^T), which
+        /// also covers nonsymmetric matrices such as the scrambled one, with
+        /// the number of entries of a row as its degree.  Every component
+        /// starts from a pseudo-peripheral row (George and Liu).  The columns
+        /// follow in the order the reordered rows first reference them.
+        static inline ordering rcm(const size_t nrows, const size_t ncols, const size_t * rowptr, const size_t * colIndex)
+        {
+            const detail::row_graph g(nrows, ncols, rowptr, colIndex);
+            std::vector<unsigned> stamp(nrows, 0), colmark(ncols, 0);
+            unsigned id = 0;
+            std::vector<char> done(nrows, 0);
+            ordering o;
+            o.rows.reserve(nrows);
+            std::vector<size_t> next;
+            for (size_t root=0; root<nrows; ++root) {
+                if (done[root]) continue;
+                // a few sweeps towards a row of maximal eccentricity
+                size_t start = root, depth = 0;
+                for (int sweep=0; sweep<4; ++sweep) {
+                    size_t d;
+                    const auto last = detail::levels(g, start, stamp, colmark, ++id, d);
+                    if (sweep > 0 && d <= depth) break;
+                    depth = d;
+                    start = *std::min_element(last.begin(), last.end(),
+                                              [&](size_t a, size_t b) { return g.degree(a) < g.degree(b); });
+                }
+                // Cuthill-McKee: breadth first, the neighbors by increasing degree
+                const unsigned cm = ++id;
+                const size_t first = o.rows.size();
+                o.rows.push_back(start);
+                done[start] = 1;
+                for (size_t k=first; k<o.rows.size(); ++k) {
+                    next.clear();
+                    g.neighbors(o.rows[k], colmark, cm, [&](size_t r2) {
+                        if (!done[r2]) { done[r2] = 1; next.push_back(r2); }
+                    });
+                    std::stable_sort(next.begin(), next.end(), [&](size_t a, size_t b) { return g.degree(a) < g.degree(b); });
+                    o.rows.insert(o.rows.end(), next.begin(), next.end());
+                }
+            }
+            std::reverse(o.rows.begin(), o.rows.end());
+            detail::first_reference(o, ncols, rowptr, colIndex);
+            return o;
+        }
+
+        /// The rows and the columns sorted along a Morton or Hilbert curve
+        /// through a 2^bits x 2^bits grid, rowpoint(r) and colpoint(c) the
+        /// points (x,y) of row r and column c.
+        template <typename RowPoint, typename ColPoint>
+        static inline ordering sfc(const std::string & curve, const int bits, const size_t nrows, const size_t ncols,
+                                   RowPoint rowpoint, ColPoint colpoint)
+        {
+            ordering o;
+            o.rows = detail::sfc_sort(curve, bits, nrows, rowpoint);
+            o.cols = detail::sfc_sort(curve, bits, ncols, colpoint);
+            return o;
+        }
+
+        /// The ordering named none|rcm|morton|hilbert of the matrix of the
+        /// sparse kernel; row r is grid point (r%size,r/size) and column c is
+        /// grid point c, or reverse(c) when the indexing is scrambled.
+        static inline std::string check_order(const std::string & name)
+        {
+            if (name != "none" && name != "rcm" && name != "morton" && name != "hilbert") {
+                return "unknown ordering " + name + " (none|rcm|morton|hilbert)";
+            }
+            return std::string();
+        }
+
+        static inline ordering grid_order(const std::string & name, const int lsize, const bool scramble,
+                                          const size_t * rowptr, const size_t * colIndex)
+        {
+            const size_t size = 1L<<lsize;
+            const size_t size2 = size*size;
+            if (name == "rcm") return rcm(size2, size2, rowptr, colIndex);
+            auto rowpoint = [=](size_t r) { return std::make_pair(uint64_t(r % size), uint64_t(r / size)); };
+            auto colpoint = [=](size_t c) {
+                const size_t p = scramble ? reverse(c, 2*lsize) : c;
+                return std::make_pair(uint64_t(p % size), uint64_t(p / size));
+            };
+            return sfc(name, lsize, size2, size2, rowpoint, colpoint);
+        }
+
+        /// The CSR arrays of the reordered matrix: the row offsets from
+        /// permuted_rowptr(), then permute_rows() for ranges of rows, which
+        /// renumbers the columns and sorts them again.  newcol[c] is the new
+        /// number of column c, from renumbering().
+        static inline void permuted_rowptr(const ordering & o, const size_t * rowptr, size_t * newptr)
+        {
+            const size_t nrows = o.rows.size();
+            newptr[0] = 0;
+            for (size_t k=0; k<nrows; ++k) {
+                newptr[k+1] = newptr[k] + (rowptr[o.rows[k]+1] - rowptr[o.rows[k]]);
+            }
+        }
+
+        static inline std::vector<size_t> renumbering(const ordering & o)
+        {
+            std::vector<size_t> newcol(o.cols.size());
+            for (size_t k=0; k<o.cols.size(); ++k) newcol[o.cols[k]] = k;
+            return newcol;
+        }
+
+        static inline void permute_rows(const size_t k0, const size_t k1, const ordering & o, const std::vector<size_t> & newcol,
+                                        const size_t * rowptr, const size_t * colIndex, const double * values,
+                                        const size_t * newptr, size_t * newIndex, double * newValues)
+        {
+            std::vector<std::pair<size_t,double>> row;
+            for (size_t k=k0; k<k1; ++k) {
+                const size_t r = o.rows[k];
+                row.clear();
+                for (size_t e=rowptr[r]; e<rowptr[r+1]; ++e) {
+                    row.push_back({ newcol[colIndex[e]], values[e] });
+                }
+                std::sort(row.begin(), row.end());
+                for (size_t j=0; j<row.size(); ++j) {
+                    newIndex[newptr[k]+j]  = row[j].first;
+                    newValues[newptr[k]+j] = row[j].second;
+                }
+            }
+        }
+
+    } // namespace sparse
+
+} // namespace prk
+
+#endif /* PRK_SPARSE_H */
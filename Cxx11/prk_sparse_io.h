@@ -0,0 +1,394 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_SPARSE_IO_H
+#define PRK_SPARSE_IO_H
+
+/// Sparse matrices from files, for the sparse kernel to run matrices it
+/// does not generate.
+///
+/// prk::sparse::load() reads a Matrix Market coordinate file (.mtx) or
+/// the binary CSR format of write_binary() (.csr), both memory-mapped.
+/// The entries of a Matrix Market file are parsed in parallel, one part
+/// of the lines per part of for_each(nparts, f), which calls f(p) for
+/// every part p; the rows of the result are sorted by column.  Symmetric
+/// and skew-symmetric files are expanded to both triangles.
+///
+/// The binary format is little-endian, every field 8 bytes:
+///
+///   "PRKCSR1\n" nrows ncols nnz rowptr[nrows+1] colIndex[nnz] values[nnz]
+///
+/// so it maps straight into the arrays of the kernel, and loading it is a
+/// parallel copy that touches the rows where the drivers will use them.
+///
+/// A file has no analytic reference, so the drivers verify against
+/// reference_multiply(), a serial CSR multiplication of the file.
+
+#include "prk_util.h"
+#include "prk_sparse.h"
+
+#include <charconv>   // from_chars
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace prk {
+
+    namespace sparse {
+
+        /// A matrix in CSR form with sorted column indices.
+        struct csr {
+            size_t nrows = 0;
+            size_t ncols = 0;
+            prk::vector<size_t> rowptr;
+            prk::vector<size_t> colIndex;
+            prk::vector<double> values;
+            size_t nnz() const { return colIndex.size(); }
+        };
+
+        /// A read-only view of a whole file: a private mapping on Linux,
+        /// a copy elsewhere.
+        class mapped_file {
+            private:
+                const char * data_ = nullptr;
+                size_t size_ = 0;
+                std::vector<char> copy_;
+                bool mapped_ = false;
+            public:
+                explicit mapped_file(const std::string & path) {
+#if defined(__linux__)
+                    const int fd = open(path.c_str(), O_RDONLY);
+                    if (fd < 0) return;
+                    struct stat st;
+                    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                        void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (p != MAP_FAILED) {
+                            madvise(p, st.st_size, MADV_WILLNEED);
+                            data_ = static_cast<const char*>(p);
+                            size_ = st.st_size;
+                            mapped_ = true;
+                        }
+                    }
+                    close(fd);
+#else
+                    std::ifstream in(path, std::ios::binary);
+                    if (!in) return;
+                    copy_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                    data_ = copy_.data();
+                    size_ = copy_.size();
+#endif
+                }
+                ~mapped_file() {
+#if defined(__linux__)
+                    if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+                }
+                mapped_file(const mapped_file &) = delete;
+                mapped_file & operator=(const mapped_file &) = delete;
+                const char * data() const { return data_; }
+                size_t size() const { return size_; }
+                bool ok() const { return data_ != nullptr; }
+        };
+
+        namespace detail {
+
+            struct triplet {
+                size_t row;
+                size_t col;
+                double value;
+            };
+
+            static inline const char * skip_blanks(const char * p, const char * end)
+            {
+                while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+                return p;
+            }
+
+            static inline const char * next_line(const char * p, const char * end)
+            {
+                while (p < end && *p != '\n') ++p;
+                return (p < end) ? p+1 : end;
+            }
+
+            static inline std::string lower(std::string s)
+            {
+                for (auto & c : s) c = std::tolower(static_cast<unsigned char>(c));
+                return s;
+            }
+
+            // the entries of the lines that start in [begin,end); false at the
+            // first line that is not "row col [value]" with 1-based indices
+            static inline bool parse_entries(const char * begin, const char * end, const char * eof,
+                                             const bool pattern, std::vector<triplet> & entries)
+            {
+                const char * p = begin;
+                while (p < end) {
+                    p = skip_blanks(p, eof);
+                    if (p == eof) break;
+                    if (*p == '\n' || *p == '%') {
+                        p = next_line(p, eof);
+                        continue;
+                    }
+                    triplet t{0, 0, 1.0};
+                    auto r = std::from_chars(p, eof, t.row);
+                    if (r.ec != std::errc() || t.row == 0) return false;
+                    p = skip_blanks(r.ptr, eof);
+                    r = std::from_chars(p, eof, t.col);
+                    if (r.ec != std::errc() || t.col == 0) return false;
+                    p = r.ptr;
+                    if (!pattern) {
+                        p = skip_blanks(p, eof);
+                        auto v = std::from_chars(p, eof, t.value);
+                        if (v.ec != std::errc()) return false;
+                        p = v.ptr;
+                    }
+                    t.row--;
+                    t.col--;
+                    entries.push_back(t);
+                    p = next_line(p, eof);
+                }
+                return true;
+            }
+
+            // sorts the columns of the rows [r0,r1) together with their values
+            static inline void sort_rows(const size_t r0, const size_t r1, csr & A)
+            {
+                std::vector<std::pair<size_t,double>> row;
+                for (size_t r=r0; r<r1; ++r) {
+                    const size_t e0 = A.rowptr[r], e1 = A.rowptr[r+1];
+                    row.clear();
+                    for (size_t e=e0; e<e1; ++e) row.push_back({ A.colIndex[e], A.values[e] });
+                    std::sort(row.begin(), row.end());
+                    for (size_t e=e0; e<e1; ++e) {
+                        A.colIndex[e] = row[e-e0].first;
+                        A.values[e]   = row[e-e0].second;
+                    }
+                }
+            }
+
+        } // namespace detail
+
+        /// Reads a Matrix Market coordinate file of real, integer or pattern
+        /// entries; returns an error message, empty on success.
+        template <typename ForEach>
+        static inline std::string read_matrix_market(const std::string & path, csr & A, const int nparts, ForEach for_each)
+        {
+            const mapped_file file(path);
+            if (!file.ok()) return "cannot read " + path;
+            const char * p = file.data();
+            const char * eof = p + file.size();
+
+            // %%MatrixMarket matrix coordinate <field> <symmetry>
+            const char * eol = detail::next_line(p, eof);
+            std::istringstream banner(std::string(p, eol));
+            std::string tag, object, layout, field, symmetry;
+            banner >> tag >> object >> layout >> field >> symmetry;
+            object = detail::lower(object); layout = detail::lower(layout);
+            field = detail::lower(field); symmetry = detail::lower(symmetry);
+            if (tag != "%%MatrixMarket" || object != "matrix") return path + " is not a Matrix Market file";
+            if (layout != "coordinate") return "only coordinate Matrix Market files are supported";
+            if (field != "real" && field != "double" && field != "integer" && field != "pattern") {
+                return "unsupported Matrix Market field " + field;
+            }
+            if (symmetry != "general" && symmetry != "symmetric" && symmetry != "skew-symmetric") {
+                return "unsupported Matrix Market symmetry " + symmetry;
+            }
+            const bool pattern = (field == "pattern");
+            const bool mirror  = (symmetry != "general");
+            const double sign  = (symmetry == "skew-symmetric") ? -1.0 : 1.0;
+
+            // comments, then the size line: rows columns entries
+            p = eol;
+            while (p < eof && (*detail::skip_blanks(p, eof) == '%' || *detail::skip_blanks(p, eof) == '\n')) {
+                p = detail::next_line(p, eof);
+            }
+            eol = detail::next_line(p, eof);
+            std::istringstream sizes(std::string(p, eol));
+            size_t lines = 0;
+            if (!(sizes >> A.nrows >> A.ncols >> lines)) return "missing size line in " + path;
+            if (mirror && A.nrows != A.ncols) return "symmetric file " + path + " is not square";
+            p = eol;
+
+            // part k parses the lines that start in its bytes
+            std::vector<const char *> starts(nparts+1);
+            for (int k=0; k<=nparts; ++k) {
+                const char * s = p + ((eof-p) / nparts) * k + std::min<size_t>((eof-p) % nparts, k);
+                starts[k] = (k == 0 || k == nparts) ? s : detail::next_line(s-1, eof);
+            }
+            std::vector<std::vector<detail::triplet>> parts(nparts);
+            std::vector<char> bad(nparts, 0);
+            for_each(nparts, [&](int k) {
+                parts[k].reserve(lines / nparts + 1);
+                bad[k] = !detail::parse_entries(starts[k], starts[k+1], eof, pattern, parts[k]);
+            });
+
+            size_t found = 0;
+            for (int k=0; k<nparts; ++k) {
+                if (bad[k]) return "malformed entry in " + path;
+                found += parts[k].size();
+            }
+            if (found != lines) {
+                return path + " has " + std::to_string(found) + " entries, not " + std::to_string(lines);
+            }
+
+            // counting sort by row, with the mirrored entries of symmetric files
+            A.rowptr = prk::vector<size_t>(A.nrows+1, size_t(0));
+            for (const auto & part : parts) {
+                for (const auto & t : part) {
+                    if (t.row >= A.nrows || t.col >= A.ncols) return "entry out of range in " + path;
+                    A.rowptr[t.row+1]++;
+                    if (mirror && t.row != t.col) A.rowptr[t.col+1]++;
+                }
+            }
+            std::partial_sum(A.rowptr.begin(), A.rowptr.end(), A.rowptr.begin());
+            const size_t nnz = A.rowptr[A.nrows];
+            A.colIndex = prk::vector<size_t>(nnz, prk::uninitialized);
+            A.values   = prk::vector<double>(nnz, prk::uninitialized);
+            std::vector<size_t> next(A.rowptr.begin(), A.rowptr.end()-1);
+            for (auto & part : parts) {
+                for (const auto & t : part) {
+                    size_t e = next[t.row]++;
+                    A.colIndex[e] = t.col;
+                    A.values[e]   = t.value;
+                    if (mirror && t.row != t.col) {
+                        e = next[t.col]++;
+                        A.colIndex[e] = t.row;
+                        A.values[e]   = sign * t.value;
+                    }
+                }
+                std::vector<detail::triplet>().swap(part);
+            }
+
+            for_each(nparts, [&](int k) {
+                detail::sort_rows(first_row(A.nrows, k, nparts), first_row(A.nrows, k+1, nparts), A);
+            });
+            return std::string();
+        }
+
+        static constexpr char binary_magic[9] = "PRKCSR1\n";
+
+        /// Reads the binary CSR format; part k of for_each copies the rows
+        /// [first_row(nrows,k,nparts),first_row(nrows,k+1,nparts)).
+        template <typename ForEach>
+        static inline std::string read_binary(const std::string & path, csr & A, const int nparts, ForEach for_each)
+        {
+            const mapped_file file(path);
+            if (!file.ok()) return "cannot read " + path;
+            if (file.size() < 32 || std::memcmp(file.data(), binary_magic, 8) != 0) {
+                return path + " is not a binary CSR file";
+            }
+            uint64_t head[3];
+            std::memcpy(head, file.data()+8, sizeof(head));
+            const size_t nrows = head[0], ncols = head[1], nnz = head[2];
+            if (file.size() != 32 + 8*(nrows+1) + 16*nnz) return path + " is truncated";
+            // the mapping is page aligned and every array starts on a multiple of 8 bytes
+            const uint64_t * rowptr   = reinterpret_cast<const uint64_t*>(file.data()+32);
+            const uint64_t * colIndex = rowptr + (nrows+1);
+            const double   * values   = reinterpret_cast<const double*>(colIndex + nnz);
+            if (rowptr[0] != 0 || rowptr[nrows] != nnz) return "bad row offsets in " + path;
+
+            A.nrows = nrows;
+            A.ncols = ncols;
+            A.rowptr   = prk::vector<size_t>(nrows+1, prk::uninitialized);
+            A.colIndex = prk::vector<size_t>(nnz, prk::uninitialized);
+            A.values   = prk::vector<double>(nnz, prk::uninitialized);
+            std::vector<char> bad(nparts, 0);
+            for_each(nparts, [&](int k) {
+                const size_t r0 = first_row(nrows, k, nparts), r1 = first_row(nrows, k+1, nparts);
+                for (size_t r=r0; r<r1; ++r) {
+                    A.rowptr[r+1] = rowptr[r+1];
+                    if (rowptr[r+1] < rowptr[r] || rowptr[r+1] > nnz) { bad[k] = 1; return; }
+                }
+                for (size_t e=rowptr[r0]; e<rowptr[r1]; ++e) {
+                    A.colIndex[e] = colIndex[e];
+                    A.values[e]   = values[e];
+                    if (colIndex[e] >= ncols) bad[k] = 1;
+                }
+            });
+            A.rowptr[0] = 0;
+            for (int k=0; k<nparts; ++k) {
+                if (bad[k]) return "bad row offsets or column indices in " + path;
+            }
+            return std::string();
+        }
+
+        /// Writes A in the binary CSR format.
+        static inline std::string write_binary(const std::string & path, const csr & A)
+        {
+            std::ofstream out(path, std::ios::binary);
+            const uint64_t head[3] = { A.nrows, A.ncols, A.nnz() };
+            out.write(binary_magic, 8);
+            out.write(reinterpret_cast<const char*>(head), sizeof(head));
+            out.write(reinterpret_cast<const char*>(A.rowptr.data()), 8*(A.nrows+1));
+            out.write(reinterpret_cast<const char*>(A.colIndex.data()), 8*A.nnz());
+            out.write(reinterpret_cast<const char*>(A.values.data()), 8*A.nnz());
+            return out ? std::string() : "cannot write " + path;
+        }
+
+        /// A .csr file is read in the binary format, anything else as Matrix Market.
+        static inline bool is_binary(const std::string & path)
+        {
+            return path.size() > 4 && path.compare(path.size()-4, 4, ".csr") == 0;
+        }
+
+        template <typename ForEach>
+        static inline std::string load(const std::string & path, csr & A, const int nparts, ForEach for_each)
+        {
+            return is_binary(path) ? read_binary(path, A, nparts, for_each) : read_matrix_market(path, A, nparts, for_each);
+        }
+
+        /// y = A x, and in bound the sums of |a_ij x_j| that bound the
+        /// rounding error of any order of summation.
+        static inline void reference_multiply(const csr & A, const double * x, double * y, double * bound)
+        {
+            for (size_t r=0; r<A.nrows; ++r) {
+                double sum(0), abs(0);
+                for (size_t e=A.rowptr[r]; e<A.rowptr[r+1]; ++e) {
+                    sum += A.values[e] * x[A.colIndex[e]];
+                    abs += std::fabs(A.values[e] * x[A.colIndex[e]]);
+                }
+                y[r] = sum;
+                bound[r] = abs;
+            }
+        }
+
+    } // namespace sparse
+
+} // namespace prk
+
+#endif /* PRK_SPARSE_IO_H */
@@ -0,0 +1,827 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_STENCIL_H
+#define PRK_STENCIL_H
+
+/// Compile-time stencil engine for the 2D stencil kernels.
+///
+/// prk::stencil<Shape, Radius, Backend>::apply is the replacement for the
+/// star1..star5 and grid1..grid5 functions that generate-cxx-stencil.py
+/// writes into stencil_*.hpp.  The weights are constexpr, the taps are
+/// unrolled by template recursion in the same order as the generator, and
+/// zero taps (the grid anti-diagonals) are dropped before code generation,
+/// so every instantiation compiles to the same loop nest as the generated
+/// code.  The drivers select an instantiation at runtime with
+/// prk::make_stencil<Backend>(star, radius, fallback), which covers radii
+/// 1..PRK_STENCIL_MAX_RADIUS.
+///
+/// The backend headers must be included before this one: prk_util.h for
+/// seq, prk_openmp.h (USE_OPENMP) for openmp and taskloop, prk_tbb.h
+/// (USE_TBB) for tbb, prk_pstl.h for pstl and prk_ranges.h (USE_RANGES)
+/// for rangefor.
+
+#ifndef PRK_STENCIL_MAX_RADIUS
+#define PRK_STENCIL_MAX_RADIUS 8
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+# define PRK_STENCIL_INLINE inline __attribute__((always_inline))
+#else
+# define PRK_STENCIL_INLINE inline
+#endif
+
+namespace prk {
+
+    enum class stencil_shape { star, grid };
+
+    namespace stencil_backend {
+        struct seq {};
+        struct openmp {};
+        struct taskloop {};
+        struct tbb {};
+        struct pstl {};
+        struct rangefor {};
+    }
+
+    namespace stencil_detail {
+
+        constexpr int sign(int x) { return (x>0) - (x<0); }
+        constexpr int abs(int x) { return (x<0) ? -x : x; }
+        constexpr int max(int x, int y) { return (x>y) ? x : y; }
+
+        // star: +/- 1/(2kr) at distance k along each axis
+        constexpr double star(int r, int di, int dj) {
+            return (di==0 && dj!=0) ? sign(dj) / (2.0*abs(dj)*r)
+                 : (dj==0 && di!=0) ? sign(di) / (2.0*abs(di)*r)
+                 : 0.0;
+        }
+
+        // grid: on ring m, +/- 1/(4mr) on the diagonal, zero on the
+        // anti-diagonal and +/- 1/(4m(2m-1)r) elsewhere, with the sign of
+        // the dominant offset
+        constexpr double grid(int r, int m, int di, int dj) {
+            return (m==0 || di==-dj) ? 0.0
+                 : (di==dj)          ? sign(di) / (4.0*m*r)
+                 : (abs(di)>abs(dj)) ? sign(di) / (4.0*m*(2*m-1)*r)
+                 :                     sign(dj) / (4.0*m*(2*m-1)*r);
+        }
+
+    } // namespace stencil_detail
+
+    /// Weight applied to in(i+di,j+dj), as in generate-cxx-stencil.py.
+    constexpr double stencil_weight(stencil_shape s, int r, int di, int dj) {
+        return (s==stencil_shape::star) ? stencil_detail::star(r, di, dj)
+               : stencil_detail::grid(r, stencil_detail::max(stencil_detail::abs(di),stencil_detail::abs(dj)), di, dj);
+    }
+
+    namespace stencil_detail {
+
+        template <stencil_shape S, int R, int DI, int DJ,
+                  bool Zero = (stencil_weight(S,R,DI,DJ) == 0.0)>
+        struct tap {
+            template <typename T, typename C>
+            static PRK_STENCIL_INLINE C add(const T * RESTRICT in, int n, int i, int j, C acc) {
+                return acc + static_cast<C>(in[(i+DI)*n+(j+DJ)]) * static_cast<C>(stencil_weight(S,R,DI,DJ));
+            }
+        };
+
+        template <stencil_shape S, int R, int DI, int DJ>
+        struct tap<S,R,DI,DJ,true> {
+            template <typename T, typename C>
+            static PRK_STENCIL_INLINE C add(const T * RESTRICT, int, int, int, C acc) {
+                return acc;
+            }
+        };
+
+        // Sums the taps left to right with dj in the outer and di in the
+        // inner position, which is the order the generator writes them.
+        // The sum is computed in the type of acc, whatever the type of in.
+        template <stencil_shape S, int R, int DI = -R, int DJ = -R,
+                  bool Last = (DI==R && DJ==R)>
+        struct taps {
+            template <typename T, typename C>
+            static PRK_STENCIL_INLINE C sum(const T * RESTRICT in, int n, int i, int j, C acc) {
+                return taps<S, R, (DI==R ? -R : DI+1), (DI==R ? DJ+1 : DJ)>::sum(in, n, i, j,
+                                                                                 tap<S,R,DI,DJ>::add(in, n, i, j, acc));
+            }
+        };
+
+        template <stencil_shape S, int R, int DI, int DJ>
+        struct taps<S,R,DI,DJ,true> {
+            template <typename T, typename C>
+            static PRK_STENCIL_INLINE C sum(const T * RESTRICT in, int n, int i, int j, C acc) {
+                return tap<S,R,DI,DJ>::add(in, n, i, j, acc);
+            }
+        };
+
+    } // namespace stencil_detail
+
+    /// out(i,j) += sum of w(di,dj) * in(i+di,j+dj) over the interior.
+    template <stencil_shape Shape, int Radius, typename Backend>
+    struct stencil;
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::seq> {
+        static_assert(Radius>0, "stencil radius must be positive");
+        typedef stencil_detail::taps<Shape, Radius> taps;
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            typedef typename VO::value_type C;
+            const typename VI::value_type * RESTRICT pin  = in.data();
+                                        C * RESTRICT pout = out.data();
+            for (auto it=Radius; it<n-Radius; it+=t) {
+              for (auto jt=Radius; jt<n-Radius; jt+=t) {
+                for (auto i=it; i<std::min(n-Radius,it+t); ++i) {
+                  const auto jmax = std::min(n-Radius,jt+t);
+                  PRAGMA_SIMD
+                  for (auto j=jt; j<jmax; ++j) {
+                    pout[i*n+j] += taps::sum(pin, n, i, j, C(0));
+                  }
+                }
+              }
+            }
+        }
+    };
+
+#ifdef USE_OPENMP
+    // called from inside a parallel region
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::openmp> {
+        static_assert(Radius>0, "stencil radius must be positive");
+        typedef stencil_detail::taps<Shape, Radius> taps;
+
+        template <typename T, typename C>
+        static void apply(const int n, const int t, const T * RESTRICT in, C * RESTRICT out) {
+            OMP_FOR( collapse(2) )
+            for (auto it=Radius; it<n-Radius; it+=t) {
+              for (auto jt=Radius; jt<n-Radius; jt+=t) {
+                for (auto i=it; i<std::min(n-Radius,it+t); ++i) {
+                  const auto jmax = std::min(n-Radius,jt+t);
+                  OMP_SIMD
+                  for (auto j=jt; j<jmax; ++j) {
+                    out[i*n+j] += taps::sum(in, n, i, j, C(0));
+                  }
+                }
+              }
+            }
+        }
+    };
+
+    // called from a single thread inside a parallel region
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::taskloop> {
+        static_assert(Radius>0, "stencil radius must be positive");
+        typedef stencil_detail::taps<Shape, Radius> taps;
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out, const int gs) {
+            typedef typename VO::value_type C;
+            const typename VI::value_type * RESTRICT pin  = in.data();
+                                        C * RESTRICT pout = out.data();
+            OMP_TASKLOOP_COLLAPSE(2, firstprivate(n,t,pin,pout) grainsize(gs) )
+            for (auto it=Radius; it<n-Radius; it+=t) {
+              for (auto jt=Radius; jt<n-Radius; jt+=t) {
+                for (auto i=it; i<std::min(n-Radius,it+t); ++i) {
+                  const auto jmax = std::min(n-Radius,jt+t);
+                  OMP_SIMD
+                  for (auto j=jt; j<jmax; ++j) {
+                    pout[i*n+j] += taps::sum(pin, n, i, j, C(0));
+                  }
+                }
+              }
+            }
+        }
+    };
+#endif
+
+#ifdef USE_TBB
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::tbb> {
+        static_assert(Radius>0, "stencil radius must be positive");
+        typedef stencil_detail::taps<Shape, Radius> taps;
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            typedef typename VO::value_type C;
+            const typename VI::value_type * RESTRICT pin  = in.data();
+                                        C * RESTRICT pout = out.data();
+            tbb::blocked_range2d<int> range(Radius, n-Radius, t, Radius, n-Radius, t);
+            tbb::parallel_for( range, [=](const tbb::blocked_range2d<int> & r) {
+                const int j0 = r.cols().begin();
+                const int j1 = r.cols().end();
+                for (auto i=r.rows().begin(); i!=r.rows().end(); ++i ) {
+                    PRAGMA_SIMD
+                    for (auto j=j0; j<j1; ++j ) {
+                        pout[i*n+j] += taps::sum(pin, n, i, j, C(0));
+                    }
+                }
+            }, tbb_partitioner);
+        }
+    };
+#endif
+
+#ifdef USE_RANGES
+    // rows in parallel with the PSTL, columns vectorized; falls back to
+    // the serial algorithms where no parallel STL is available
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::pstl> {
+        static_assert(Radius>0, "stencil radius must be positive");
+        typedef stencil_detail::taps<Shape, Radius> taps;
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int, VI & in, VO & out) {
+            typedef typename VO::value_type C;
+            const typename VI::value_type * RESTRICT pin  = in.data();
+                                        C * RESTRICT pout = out.data();
+            auto inside = prk::range(Radius,n-Radius);
+#if defined(USE_PSTL) && ( defined(USE_INTEL_PSTL) || ( defined(__GNUC__) && (__GNUC__ >= 9) ) )
+            std::for_each( exec::par, std::begin(inside), std::end(inside), [=] (int i) {
+              std::for_each( exec::unseq, std::begin(inside), std::end(inside), [=] (int j) {
+#elif defined(USE_PSTL) && defined(__GNUC__) && defined(__GNUC_MINOR__) \
+                        && ( (__GNUC__ == 8) || (__GNUC__ == 7) && (__GNUC_MINOR__ >= 2) )
+            __gnu_parallel::for_each( std::begin(inside), std::end(inside), [=] (int i) {
+              std::for_each( std::begin(inside), std::end(inside), [=] (int j) {
+#else
+            std::for_each( std::begin(inside), std::end(inside), [=] (int i) {
+              std::for_each( std::begin(inside), std::end(inside), [=] (int j) {
+#endif
+                  pout[i*n+j] += taps::sum(pin, n, i, j, C(0));
+              });
+            });
+        }
+    };
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::rangefor> {
+        static_assert(Radius>0, "stencil radius must be positive");
+        typedef stencil_detail::taps<Shape, Radius> taps;
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            typedef typename VO::value_type C;
+            const typename VI::value_type * RESTRICT pin  = in.data();
+                                        C * RESTRICT pout = out.data();
+            for (auto it : prk::range(Radius,n-Radius,t)) {
+              for (auto jt : prk::range(Radius,n-Radius,t)) {
+                for (auto i : prk::range(it,std::min(n-Radius,it+t))) {
+                  for (auto j : prk::range(jt,std::min(n-Radius,jt+t))) {
+                    pout[i*n+j] += taps::sum(pin, n, i, j, C(0));
+                  }
+                }
+              }
+            }
+        }
+    };
+#endif
+
+    /// Temporal blocking: advances `steps` iterations of
+    ///
+    ///   out += stencil(in); in += 1.0
+    ///
+    /// per tile while the tile is cache resident, instead of making two full
+    /// passes over the grid per iteration.  Because the update of `in` is
+    /// pointwise, a tile only needs a copy of `in` with a halo of width R:
+    /// the halo is advanced redundantly in the copy (one add per point and
+    /// step), so the trapezoids of the classical scheme collapse to
+    /// overlapping tiles and every iteration reads exactly the values the
+    /// untiled code reads.  Tiles read `in` and write the advanced values
+    /// to `in_next`, so the caller swaps the two after each call.  Results
+    /// are bitwise identical to `steps` iterations of stencil<>::apply plus
+    /// the update pass.
+    template <stencil_shape Shape, int Radius, typename Backend>
+    struct stencil_steps;
+
+    namespace stencil_detail {
+
+        // One tile [i0,i1)x[j0,j1) of the grid; buf holds (t+2R)^2 elements.
+        template <stencil_shape S, int R, typename T, typename C>
+        void tile_steps(const int n, const int i0, const int i1, const int j0, const int j1, const int steps,
+                        const T * RESTRICT in, T * RESTRICT in_next, C * RESTRICT out,
+                        T * RESTRICT buf)
+        {
+            // the tile plus its halo, clipped to the grid
+            const int bi0 = std::max(i0-R,0);
+            const int bi1 = std::min(i1+R,n);
+            const int bj0 = std::max(j0-R,0);
+            const int bj1 = std::min(j1+R,n);
+            const int bw  = bj1-bj0;
+            const int bsize = (bi1-bi0)*bw;
+            // the part of the tile where the stencil is applied
+            const int oi0 = std::max(i0,R);
+            const int oi1 = std::min(i1,n-R);
+            const int oj0 = std::max(j0,R);
+            const int oj1 = std::min(j1,n-R);
+
+            for (auto i=bi0; i<bi1; ++i) {
+              PRAGMA_SIMD
+              for (auto j=bj0; j<bj1; ++j) {
+                buf[(i-bi0)*bw+(j-bj0)] = in[i*n+j];
+              }
+            }
+            for (auto s=0; s<steps; ++s) {
+              for (auto i=oi0; i<oi1; ++i) {
+                PRAGMA_SIMD
+                for (auto j=oj0; j<oj1; ++j) {
+                  out[i*n+j] += taps<S,R>::sum(buf, bw, i-bi0, j-bj0, C(0));
+                }
+              }
+              PRAGMA_SIMD
+              for (auto k=0; k<bsize; ++k) {
+                buf[k] += 1.0;
+              }
+            }
+            for (auto i=i0; i<i1; ++i) {
+              PRAGMA_SIMD
+              for (auto j=j0; j<j1; ++j) {
+                in_next[i*n+j] = buf[(i-bi0)*bw+(j-bj0)];
+              }
+            }
+        }
+
+    } // namespace stencil_detail
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil_steps<Shape, Radius, stencil_backend::seq> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, const int steps, const VI & in, VI & in_next, VO & out) {
+            std::vector<typename VI::value_type> buf((t+2*Radius)*(t+2*Radius));
+            for (auto it=0; it<n; it+=t) {
+              for (auto jt=0; jt<n; jt+=t) {
+                stencil_detail::tile_steps<Shape,Radius>(n, it, std::min(n,it+t), jt, std::min(n,jt+t), steps,
+                                                         in.data(), in_next.data(), out.data(), buf.data());
+              }
+            }
+        }
+    };
+
+#ifdef USE_OPENMP
+    // called from inside a parallel region; each thread has its own tile buffer
+    template <stencil_shape Shape, int Radius>
+    struct stencil_steps<Shape, Radius, stencil_backend::openmp> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename T, typename C>
+        static void apply(const int n, const int t, const int steps,
+                          const T * RESTRICT in, T * RESTRICT in_next, C * RESTRICT out) {
+            std::vector<T> buf((t+2*Radius)*(t+2*Radius));
+            OMP_FOR( collapse(2) schedule(static) )
+            for (auto it=0; it<n; it+=t) {
+              for (auto jt=0; jt<n; jt+=t) {
+                stencil_detail::tile_steps<Shape,Radius>(n, it, std::min(n,it+t), jt, std::min(n,jt+t), steps,
+                                                         in, in_next, out, buf.data());
+              }
+            }
+        }
+    };
+#endif
+
+    /// Fused stencil-plus-update: one sweep does
+    ///
+    ///   out += stencil(in); in += 1.0
+    ///
+    /// so `in` is updated while its rows are still in cache instead of in a
+    /// second pass over the grid.  The grid is split into bands of rows.  A
+    /// band applies the stencil row by row and adds 1.0 to a row of `in` as
+    /// soon as the last stencil row that reads it is done.  The R rows on
+    /// either side of a band boundary are also read by the neighbouring
+    /// band, so they are updated after all bands have finished.  Enabled in
+    /// the drivers by PRK_STENCIL_FUSED=1.
+    template <stencil_shape Shape, int Radius, typename Backend>
+    struct stencil_fused;
+
+    static inline bool stencil_fused_enabled(void)
+    {
+        return (prk::bench::getenv_int("PRK_STENCIL_FUSED",0) != 0);
+    }
+
+    namespace stencil_detail {
+
+        // in += 1.0 on rows [lo,hi)
+        template <typename T>
+        static inline void update_rows(const int n, const int lo, const int hi, T * RESTRICT in)
+        {
+            const size_t k1 = static_cast<size_t>(hi)*n;
+            PRAGMA_SIMD
+            for (auto k=static_cast<size_t>(lo)*n; k<k1; ++k) {
+                in[k] += 1.0;
+            }
+        }
+
+        // rows [p0,p1) of band [r0,r1) are not read by any other band
+        static inline void band_private(const int n, const int r, const int r0, const int r1, int & p0, int & p1)
+        {
+            p0 = std::min( (r0==0) ? 0 : r0+r, r1);
+            p1 = std::max( (r1==n) ? n : r1-r, p0);
+        }
+
+        template <stencil_shape S, int R, typename T, typename C>
+        void band_fused(const int n, const int r0, const int r1, T * RESTRICT in, C * RESTRICT out)
+        {
+            int p0, p1;
+            band_private(n, R, r0, r1, p0, p1);
+            int next = p0;
+            const int i0 = std::max(r0,R);
+            const int i1 = std::min(r1,n-R);
+            for (auto i=i0; i<i1; ++i) {
+                PRAGMA_SIMD
+                for (auto j=R; j<n-R; ++j) {
+                    out[i*n+j] += taps<S,R>::sum(in, n, i, j, C(0));
+                }
+                // rows up to i-R have no stencil rows left that read them
+                const int done = std::min(i-R+1,p1);
+                if (next < done) {
+                    update_rows(n, next, done, in);
+                    next = done;
+                }
+            }
+            update_rows(n, next, p1, in);
+        }
+
+        // call after every band_fused of the sweep has completed
+        template <typename T>
+        static inline void band_shared(const int n, const int r, const int r0, const int r1, T * RESTRICT in)
+        {
+            int p0, p1;
+            band_private(n, r, r0, r1, p0, p1);
+            update_rows(n, r0, p0, in);
+            update_rows(n, p1, r1, in);
+        }
+
+        // rows per band for the task-parallel backends
+        static inline int band_height(const int t, const int r)
+        {
+            return std::max(t, 4*r);
+        }
+
+    } // namespace stencil_detail
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil_fused<Shape, Radius, stencil_backend::seq> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int, VI & in, VO & out) {
+            stencil_detail::band_fused<Shape,Radius>(n, 0, n, in.data(), out.data());
+        }
+    };
+
+#ifdef USE_OPENMP
+    // called from inside a parallel region; one band per thread
+    template <stencil_shape Shape, int Radius>
+    struct stencil_fused<Shape, Radius, stencil_backend::openmp> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename T, typename C>
+        static void apply(const int n, const int, T * RESTRICT in, C * RESTRICT out) {
+            int nb = 1;
+#ifdef _OPENMP
+            nb = omp_get_num_threads();
+#endif
+            OMP_FOR( schedule(static) )
+            for (auto b=0; b<nb; ++b) {
+                stencil_detail::band_fused<Shape,Radius>(n, b*n/nb, (b+1)*n/nb, in, out);
+            }
+            OMP_FOR( schedule(static) )
+            for (auto b=0; b<nb; ++b) {
+                stencil_detail::band_shared(n, Radius, b*n/nb, (b+1)*n/nb, in);
+            }
+        }
+    };
+
+    // called from a single thread inside a parallel region
+    template <stencil_shape Shape, int Radius>
+    struct stencil_fused<Shape, Radius, stencil_backend::taskloop> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out, const int gs) {
+            typename VI::value_type * RESTRICT pin  = in.data();
+            typename VO::value_type * RESTRICT pout = out.data();
+            const int h  = stencil_detail::band_height(t, Radius);
+            const int nb = prk::divceil(n, h);
+            // gs counts t*t tiles; a band is h*n points
+            const int bgs = std::max(1, static_cast<int>( (static_cast<long>(gs)*t*t) / (static_cast<long>(h)*n) ));
+            OMP_TASKLOOP( firstprivate(n,h,pin,pout) grainsize(bgs) )
+            for (auto b=0; b<nb; ++b) {
+                stencil_detail::band_fused<Shape,Radius>(n, b*h, std::min(n,(b+1)*h), pin, pout);
+            }
+            OMP_TASKLOOP( firstprivate(n,h,pin) grainsize(bgs) )
+            for (auto b=0; b<nb; ++b) {
+                stencil_detail::band_shared(n, Radius, b*h, std::min(n,(b+1)*h), pin);
+            }
+        }
+    };
+#endif
+
+#ifdef USE_TBB
+    template <stencil_shape Shape, int Radius>
+    struct stencil_fused<Shape, Radius, stencil_backend::tbb> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            typename VI::value_type * RESTRICT pin  = in.data();
+            typename VO::value_type * RESTRICT pout = out.data();
+            const int h  = stencil_detail::band_height(t, Radius);
+            const int nb = prk::divceil(n, h);
+            tbb::parallel_for( tbb::blocked_range<int>(0, nb), [=](const tbb::blocked_range<int> & r) {
+                for (auto b=r.begin(); b!=r.end(); ++b) {
+                    stencil_detail::band_fused<Shape,Radius>(n, b*h, std::min(n,(b+1)*h), pin, pout);
+                }
+            }, tbb_partitioner);
+            tbb::parallel_for( tbb::blocked_range<int>(0, nb), [=](const tbb::blocked_range<int> & r) {
+                for (auto b=r.begin(); b!=r.end(); ++b) {
+                    stencil_detail::band_shared(n, Radius, b*h, std::min(n,(b+1)*h), pin);
+                }
+            }, tbb_partitioner);
+        }
+    };
+#endif
+
+#ifdef USE_RANGES
+    template <stencil_shape Shape, int Radius>
+    struct stencil_fused<Shape, Radius, stencil_backend::pstl> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            typename VI::value_type * RESTRICT pin  = in.data();
+            typename VO::value_type * RESTRICT pout = out.data();
+            const int h  = stencil_detail::band_height(t, Radius);
+            auto bands = prk::range(0, prk::divceil(n, h));
+            auto fused = [=] (int b) {
+                stencil_detail::band_fused<Shape,Radius>(n, b*h, std::min(n,(b+1)*h), pin, pout);
+            };
+            auto shared = [=] (int b) {
+                stencil_detail::band_shared(n, Radius, b*h, std::min(n,(b+1)*h), pin);
+            };
+#if defined(USE_PSTL) && ( defined(USE_INTEL_PSTL) || ( defined(__GNUC__) && (__GNUC__ >= 9) ) )
+            std::for_each( exec::par, std::begin(bands), std::end(bands), fused);
+            std::for_each( exec::par, std::begin(bands), std::end(bands), shared);
+#elif defined(USE_PSTL) && defined(__GNUC__) && defined(__GNUC_MINOR__) \
+                        && ( (__GNUC__ == 8) || (__GNUC__ == 7) && (__GNUC_MINOR__ >= 2) )
+            __gnu_parallel::for_each( std::begin(bands), std::end(bands), fused);
+            __gnu_parallel::for_each( std::begin(bands), std::end(bands), shared);
+#else
+            std::for_each( std::begin(bands), std::end(bands), fused);
+            std::for_each( std::begin(bands), std::end(bands), shared);
+#endif
+        }
+    };
+
+    // serial, so a single band covers the grid
+    template <stencil_shape Shape, int Radius>
+    struct stencil_fused<Shape, Radius, stencil_backend::rangefor> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int, VI & in, VO & out) {
+            stencil_detail::band_fused<Shape,Radius>(n, 0, n, in.data(), out.data());
+        }
+    };
+#endif
+
+    /// Cache-oblivious temporal blocking: advances `steps` iterations of
+    ///
+    ///   out += stencil(in); in += 1.0
+    ///
+    /// by the Frigo-Strumpen trapezoidal decomposition of the (t,i,j)
+    /// iteration space instead of fixed tiles.  A trapezoid is cut in space
+    /// while it is at least 4*R*dt wide, into two outer pieces whose inner
+    /// edges lean inwards with slope R and an inverted middle piece that
+    /// depends on both, and otherwise halved in time.  The outer pieces are
+    /// independent and run in parallel in the task backends.  The recursion
+    /// adapts to every level of the cache hierarchy, so there is no tile
+    /// size to tune; the only constants are the base-case sizes below, which
+    /// keep the inner loop long enough to vectorize.
+    ///
+    /// Step s reads in (s even) or in_next (s odd) and writes the other, so
+    /// after the call the result is in in_next if steps is odd and the
+    /// caller swaps the two.  Results are bitwise identical to `steps`
+    /// iterations of stencil<>::apply plus the update pass.  Enabled in the
+    /// drivers by PRK_STENCIL_OBLIVIOUS=1.
+    template <stencil_shape Shape, int Radius, typename Backend>
+    struct stencil_oblivious;
+
+    static inline bool stencil_oblivious_enabled(void)
+    {
+        return (prk::bench::getenv_int("PRK_STENCIL_OBLIVIOUS",0) != 0);
+    }
+
+    namespace stencil_detail {
+
+        // rows and columns below which a trapezoid is not cut in space
+        constexpr int oblivious_min_rows = 8;
+        constexpr int oblivious_min_cols = 256;
+
+        // space-time region t0 <= t < t1 whose extent in dimension d at
+        // time t is [x0[d]+dx0[d]*(t-t0), x1[d]+dx1[d]*(t-t0))
+        struct trapezoid {
+            int t0, t1;
+            int x0[2], dx0[2];
+            int x1[2], dx1[2];
+        };
+
+        template <stencil_shape S, int R, typename T, typename C>
+        void trapezoid_base(const int n, const trapezoid & z,
+                            T * RESTRICT in, T * RESTRICT in_next, C * RESTRICT out)
+        {
+            for (auto t=z.t0; t<z.t1; ++t) {
+                const int s = t-z.t0;
+                const T * RESTRICT src = (t%2==0) ? in : in_next;
+                      T * RESTRICT dst = (t%2==0) ? in_next : in;
+                const int i0 = z.x0[0]+z.dx0[0]*s;
+                const int i1 = z.x1[0]+z.dx1[0]*s;
+                const int j0 = z.x0[1]+z.dx0[1]*s;
+                const int j1 = z.x1[1]+z.dx1[1]*s;
+                const int oj0 = std::max(j0,R);
+                const int oj1 = std::min(j1,n-R);
+                for (auto i=i0; i<i1; ++i) {
+                    if (i>=R && i<n-R) {
+                        PRAGMA_SIMD
+                        for (auto j=oj0; j<oj1; ++j) {
+                            out[i*n+j] += taps<S,R>::sum(src, n, i, j, C(0));
+                        }
+                    }
+                    PRAGMA_SIMD
+                    for (auto j=j0; j<j1; ++j) {
+                        dst[i*n+j] = src[i*n+j] + 1.0;
+                    }
+                }
+            }
+        }
+
+        // Fork is one of prk::fork_seq, fork_task or fork_tbb.
+        template <stencil_shape S, int R, typename Fork, typename T, typename C>
+        void trapezoid_walk(const int n, const trapezoid & z,
+                            T * RESTRICT in, T * RESTRICT in_next, C * RESTRICT out)
+        {
+            const int dt = z.t1-z.t0;
+            for (auto d=0; d<2; ++d) {
+                const int bottom = z.x1[d]-z.x0[d];
+                const int top    = bottom + (z.dx1[d]-z.dx0[d])*dt;
+                const int min_width = (d==0) ? oblivious_min_rows : oblivious_min_cols;
+                if ( (top >= 4*R*dt) && (bottom+top >= 4*min_width) ) {
+                    // both outer pieces are (top-2*R*dt)/2 wide at the top
+                    const int xm = (z.x0[d]+z.x1[d]+(z.dx0[d]+z.dx1[d])*dt)/2;
+                    trapezoid l = z, m = z, r = z;
+                    l.x1[d] = xm; l.dx1[d] = -R;
+                    r.x0[d] = xm; r.dx0[d] =  R;
+                    m.x0[d] = xm; m.dx0[d] = -R;
+                    m.x1[d] = xm; m.dx1[d] =  R;
+                    Fork::run([=] { trapezoid_walk<S,R,Fork>(n, l, in, in_next, out); },
+                              [=] { trapezoid_walk<S,R,Fork>(n, r, in, in_next, out); });
+                    trapezoid_walk<S,R,Fork>(n, m, in, in_next, out);
+                    return;
+                }
+            }
+            if (dt > 1) {
+                const int h = dt/2;
+                trapezoid lo = z, hi = z;
+                lo.t1 = z.t0+h;
+                hi.t0 = z.t0+h;
+                for (auto d=0; d<2; ++d) {
+                    hi.x0[d] += z.dx0[d]*h;
+                    hi.x1[d] += z.dx1[d]*h;
+                }
+                trapezoid_walk<S,R,Fork>(n, lo, in, in_next, out);
+                trapezoid_walk<S,R,Fork>(n, hi, in, in_next, out);
+                return;
+            }
+            trapezoid_base<S,R>(n, z, in, in_next, out);
+        }
+
+        template <stencil_shape S, int R, typename Fork, typename T, typename C>
+        void oblivious(const int n, const int steps, T * RESTRICT in, T * RESTRICT in_next, C * RESTRICT out)
+        {
+            trapezoid z = { 0, steps, {0,0}, {0,0}, {n,n}, {0,0} };
+            trapezoid_walk<S,R,Fork>(n, z, in, in_next, out);
+        }
+
+    } // namespace stencil_detail
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil_oblivious<Shape, Radius, stencil_backend::seq> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int steps, VI & in, VI & in_next, VO & out) {
+            stencil_detail::oblivious<Shape,Radius,prk::fork_seq>(n, steps, in.data(), in_next.data(), out.data());
+        }
+    };
+
+#ifdef USE_OPENMP
+    // called from a single thread inside a parallel region
+    template <stencil_shape Shape, int Radius>
+    struct stencil_oblivious<Shape, Radius, stencil_backend::taskloop> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int steps, VI & in, VI & in_next, VO & out) {
+            stencil_detail::oblivious<Shape,Radius,prk::fork_task>(n, steps, in.data(), in_next.data(), out.data());
+        }
+    };
+#endif
+
+#ifdef USE_TBB
+    template <stencil_shape Shape, int Radius>
+    struct stencil_oblivious<Shape, Radius, stencil_backend::tbb> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename VI, typename VO>
+        static void apply(const int n, const int steps, VI & in, VI & in_next, VO & out) {
+            stencil_detail::oblivious<Shape,Radius,prk::fork_tbb>(n, steps, in.data(), in_next.data(), out.data());
+        }
+    };
+#endif
+
+    namespace stencil_detail {
+
+        template <template <stencil_shape, int, typename> class Op, typename Backend, typename F,
+                  int R = PRK_STENCIL_MAX_RADIUS>
+        struct table {
+            static F get(bool star, int radius) {
+                if (radius == R) {
+                    return star ? static_cast<F>(&Op<stencil_shape::star, R, Backend>::apply)
+                                : static_cast<F>(&Op<stencil_shape::grid, R, Backend>::apply);
+                }
+                return table<Op, Backend, F, R-1>::get(star, radius);
+            }
+        };
+
+        template <template <stencil_shape, int, typename> class Op, typename Backend, typename F>
+        struct table<Op, Backend, F, 0> {
+            static F get(bool, int) { return nullptr; }
+        };
+
+    } // namespace stencil_detail
+
+    /// Returns the instantiation for (star, radius) with the signature of
+    /// fallback, or fallback itself if radius > PRK_STENCIL_MAX_RADIUS.
+    template <typename Backend, typename F>
+    F make_stencil(bool star, int radius, F fallback)
+    {
+        F f = stencil_detail::table<prk::stencil, Backend, F>::get(star, radius);
+        return (f != nullptr) ? f : fallback;
+    }
+
+    /// As make_stencil, for the temporally blocked stencil_steps<>::apply.
+    template <typename Backend, typename F>
+    F make_stencil_steps(bool star, int radius, F fallback)
+    {
+        F f = stencil_detail::table<prk::stencil_steps, Backend, F>::get(star, radius);
+        return (f != nullptr) ? f : fallback;
+    }
+
+    /// As make_stencil, for the fused stencil_fused<>::apply.
+    template <typename Backend, typename F>
+    F make_stencil_fused(bool star, int radius, F fallback)
+    {
+        F f = stencil_detail::table<prk::stencil_fused, Backend, F>::get(star, radius);
+        return (f != nullptr) ? f : fallback;
+    }
+
+    /// As make_stencil, for the cache-oblivious stencil_oblivious<>::apply.
+    template <typename Backend, typename F>
+    F make_stencil_oblivious(bool star, int radius, F fallback)
+    {
+        F f = stencil_detail::table<prk::stencil_oblivious, Backend, F>::get(star, radius);
+        return (f != nullptr) ? f : fallback;
+    }
+
+} // namespace prk
+
+#endif /* PRK_STENCIL_H */
@@ -0,0 +1,258 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_STENCIL3D_H
+#define PRK_STENCIL3D_H
+
+/// Compile-time stencil engine for the 3D stencil kernels.
+///
+/// prk::stencil3d<Shape, Radius, Backend>::apply computes
+/// out(i,j,k) += sum of w(di,dj,dk) * in(i+di,j+dj,k+dk) on an n^3 grid
+/// stored as in[(i*n+j)*n+k].  The star stencil has 6r+1 points (7 for
+/// r=1, 13 for r=2) and the grid stencil (2r+1)^3 (27 for r=1).  Both
+/// differentiate each axis exactly, so for in = i+j+k every application
+/// adds 3 to the interior of out, which is what the drivers verify.
+///
+/// All backends use 2.5D blocking: the (j,k) plane is cut into tiles of
+/// t rows of j (k is never cut, so the inner loop stays long and
+/// prefetch-friendly) and each tile is streamed along i, so only the 2r+1
+/// planes of the tile under the stencil are live in cache at any time and
+/// every input element is read from memory once per sweep instead of once
+/// per plane of the stencil.  The parallel backends give each worker a
+/// slab of planes (openmp, thread) or an (i,j) block (tbb) to stream.
+///
+/// Radii above PRK_STENCIL3D_MAX_RADIUS (default 4, since the number of
+/// grid taps grows as (2r+1)^3) use the fallback passed to make_stencil3d.
+
+#include "prk_stencil.h"
+
+#ifndef PRK_STENCIL3D_MAX_RADIUS
+#define PRK_STENCIL3D_MAX_RADIUS 4
+#endif
+
+#if !defined(__NVCC__) && !defined(_CRAYC)
+#include "prk_thread.h"
+#endif
+
+namespace prk {
+
+    namespace stencil_backend {
+        struct thread {};
+    }
+
+    namespace stencil_detail {
+
+        // star: +/- 1/(2kr) at distance k along each axis
+        constexpr double star3(int r, int di, int dj, int dk) {
+            return (dj==0 && dk==0) ? ( (di==0) ? 0.0 : sign(di) / (2.0*abs(di)*r) )
+                 : (di==0 && dk==0) ? sign(dj) / (2.0*abs(dj)*r)
+                 : (di==0 && dj==0) ? sign(dk) / (2.0*abs(dk)*r)
+                 : 0.0;
+        }
+
+        // grid: (di+dj+dk) / sum of d^2 over the cube, zero on the plane di+dj+dk=0
+        constexpr double grid3(int r, int di, int dj, int dk) {
+            return (di+dj+dk) * 3.0 / (static_cast<double>(r)*(r+1)*(2*r+1)*(2*r+1)*(2*r+1));
+        }
+
+    } // namespace stencil_detail
+
+    /// Weight applied to in(i+di,j+dj,k+dk).
+    constexpr double stencil3d_weight(stencil_shape s, int r, int di, int dj, int dk) {
+        return (s==stencil_shape::star) ? stencil_detail::star3(r, di, dj, dk)
+                                        : stencil_detail::grid3(r, di, dj, dk);
+    }
+
+    namespace stencil_detail {
+
+        template <stencil_shape S, int R, int DI, int DJ, int DK,
+                  bool Zero = (stencil3d_weight(S,R,DI,DJ,DK) == 0.0)>
+        struct tap3 {
+            static PRK_STENCIL_INLINE double add(const double * RESTRICT in, int n, int i, int j, int k, double acc) {
+                return acc + in[((i+DI)*n+(j+DJ))*n+(k+DK)] * stencil3d_weight(S,R,DI,DJ,DK);
+            }
+        };
+
+        template <stencil_shape S, int R, int DI, int DJ, int DK>
+        struct tap3<S,R,DI,DJ,DK,true> {
+            static PRK_STENCIL_INLINE double add(const double * RESTRICT, int, int, int, int, double acc) {
+                return acc;
+            }
+        };
+
+        // the taps of plane DI, with dk varying fastest
+        template <stencil_shape S, int R, int DI, int DJ = -R, int DK = -R,
+                  bool Last = (DJ==R && DK==R)>
+        struct plane3 {
+            static PRK_STENCIL_INLINE double sum(const double * RESTRICT in, int n, int i, int j, int k, double acc) {
+                return plane3<S, R, DI, (DK==R ? DJ+1 : DJ), (DK==R ? -R : DK+1)>::sum(in, n, i, j, k,
+                                                                                     tap3<S,R,DI,DJ,DK>::add(in, n, i, j, k, acc));
+            }
+        };
+
+        template <stencil_shape S, int R, int DI, int DJ, int DK>
+        struct plane3<S,R,DI,DJ,DK,true> {
+            static PRK_STENCIL_INLINE double sum(const double * RESTRICT in, int n, int i, int j, int k, double acc) {
+                return tap3<S,R,DI,DJ,DK>::add(in, n, i, j, k, acc);
+            }
+        };
+
+        // Recursing over planes and then within a plane keeps the
+        // instantiation depth at O(r^2) rather than O(r^3).
+        template <stencil_shape S, int R, int DI = -R, bool Last = (DI==R)>
+        struct taps3 {
+            static PRK_STENCIL_INLINE double sum(const double * RESTRICT in, int n, int i, int j, int k, double acc) {
+                return taps3<S, R, DI+1>::sum(in, n, i, j, k, plane3<S,R,DI>::sum(in, n, i, j, k, acc));
+            }
+        };
+
+        template <stencil_shape S, int R, int DI>
+        struct taps3<S,R,DI,true> {
+            static PRK_STENCIL_INLINE double sum(const double * RESTRICT in, int n, int i, int j, int k, double acc) {
+                return plane3<S,R,DI>::sum(in, n, i, j, k, acc);
+            }
+        };
+
+        // planes [i0,i1) of the rows [j0,j1), streamed along i
+        template <stencil_shape S, int R>
+        PRK_STENCIL_INLINE void column3(const int n, const int i0, const int i1, const int j0, const int j1,
+                                        const double * RESTRICT in, double * RESTRICT out)
+        {
+            for (auto i=i0; i<i1; ++i) {
+              for (auto j=j0; j<j1; ++j) {
+                PRAGMA_SIMD
+                for (auto k=R; k<n-R; ++k) {
+                  out[(i*n+j)*n+k] += taps3<S,R>::sum(in, n, i, j, k, 0.0);
+                }
+              }
+            }
+        }
+
+        // planes [i0,i1) of all tiles of t rows
+        template <stencil_shape S, int R>
+        void slab3(const int n, const int t, const int i0, const int i1,
+                   const double * RESTRICT in, double * RESTRICT out)
+        {
+            for (auto jt=R; jt<n-R; jt+=t) {
+                column3<S,R>(n, i0, i1, jt, std::min(n-R,jt+t), in, out);
+            }
+        }
+
+        // first interior plane of slab b out of nb
+        template <int R>
+        constexpr int slab3_begin(int n, int b, int nb) {
+            return R + static_cast<int>((static_cast<long>(n-2*R)*b)/nb);
+        }
+
+    } // namespace stencil_detail
+
+    /// out(i,j,k) += sum of w(di,dj,dk) * in(i+di,j+dj,k+dk) over the interior.
+    template <stencil_shape Shape, int Radius, typename Backend>
+    struct stencil3d;
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil3d<Shape, Radius, stencil_backend::seq> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename V>
+        static void apply(const int n, const int t, V & in, V & out) {
+            stencil_detail::slab3<Shape,Radius>(n, t, Radius, n-Radius, in.data(), out.data());
+        }
+    };
+
+#ifdef USE_OPENMP
+    // called from inside a parallel region
+    template <stencil_shape Shape, int Radius>
+    struct stencil3d<Shape, Radius, stencil_backend::openmp> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        static void apply(const int n, const int t, const double * RESTRICT in, double * RESTRICT out) {
+            // one slab of planes per thread, each streamed tile by tile
+            const int nb = omp_get_num_threads();
+            OMP_FOR( schedule(static) )
+            for (auto b=0; b<nb; ++b) {
+                stencil_detail::slab3<Shape,Radius>(n, t, stencil_detail::slab3_begin<Radius>(n,b,nb),
+                                                    stencil_detail::slab3_begin<Radius>(n,b+1,nb), in, out);
+            }
+        }
+    };
+#endif
+
+#ifdef USE_TBB
+    template <stencil_shape Shape, int Radius>
+    struct stencil3d<Shape, Radius, stencil_backend::tbb> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename V>
+        static void apply(const int n, const int t, V & in, V & out) {
+            const double * RESTRICT pin  = in.data();
+                  double * RESTRICT pout = out.data();
+            tbb::blocked_range2d<int> range(Radius, n-Radius, t, Radius, n-Radius, t);
+            tbb::parallel_for( range, [=](const tbb::blocked_range2d<int> & r) {
+                stencil_detail::column3<Shape,Radius>(n, r.rows().begin(), r.rows().end(),
+                                                      r.cols().begin(), r.cols().end(), pin, pout);
+            }, tbb_partitioner);
+        }
+    };
+#endif
+
+#if !defined(__NVCC__) && !defined(_CRAYC)
+    // one slab of planes per worker of the thread pool
+    template <stencil_shape Shape, int Radius>
+    struct stencil3d<Shape, Radius, stencil_backend::thread> {
+        static_assert(Radius>0, "stencil radius must be positive");
+
+        template <typename V>
+        static void apply(const int n, const int t, V & in, V & out, prk::thread_pool & pool) {
+            const double * RESTRICT pin  = in.data();
+                  double * RESTRICT pout = out.data();
+            const int nb = pool.size();
+            pool.parallel_for(0, nb, [=](int p) {
+                stencil_detail::slab3<Shape,Radius>(n, t, stencil_detail::slab3_begin<Radius>(n,p,nb),
+                                                    stencil_detail::slab3_begin<Radius>(n,p+1,nb), pin, pout);
+            });
+        }
+    };
+#endif
+
+    /// As make_stencil, for the 3D stencil3d<>::apply with radii
+    /// 1..PRK_STENCIL3D_MAX_RADIUS.
+    template <typename Backend, typename F>
+    F make_stencil3d(bool star, int radius, F fallback)
+    {
+        F f = stencil_detail::table<prk::stencil3d, Backend, F, PRK_STENCIL3D_MAX_RADIUS>::get(star, radius);
+        return (f != nullptr) ? f : fallback;
+    }
+
+} // namespace prk
+
+#endif /* PRK_STENCIL3D_H */
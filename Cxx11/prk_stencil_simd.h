@@ -0,0 +1,271 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_STENCIL_SIMD_H
+#define PRK_STENCIL_SIMD_H
+
+/// Hand-vectorized stencil kernels with runtime ISA dispatch.
+///
+/// prk::stencil<Shape, Radius, stencil_backend::{sse2,avx2,avx512}> compute
+/// a block of B rows by W columns of `out` per step: every vector of `in`
+/// is loaded once and multiplied into all of the B accumulators whose
+/// stencil covers it, so a grid stencil of radius R does (B+2R)(2R+1)
+/// instead of B(2R+1)^2 loads per block.  The kernels use GCC vector
+/// extensions, so one generic implementation is compiled three times with
+/// target attributes, and prk::make_stencil_simd picks the widest ISA the
+/// CPU supports at runtime.  PRK_STENCIL_ISA=none|sse2|avx2|avx512 limits
+/// the choice (e.g. to compare ISAs on one node).  W is the vector width
+/// in elements, so float kernels have twice the lanes of double ones.
+
+#include "prk_stencil.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# define PRK_STENCIL_SIMD 1
+#endif
+
+namespace prk {
+
+    namespace stencil_backend {
+        struct sse2 {};
+        struct avx2 {};
+        struct avx512 {};
+    }
+
+#ifdef PRK_STENCIL_SIMD
+
+    namespace stencil_detail {
+
+        // Bytes/sizeof(E) lanes of E
+        template <typename E, int Bytes>
+        struct simd_vec {
+            typedef E type __attribute__((vector_size(Bytes)));
+        };
+
+        template <typename T>
+        struct simd_elem {
+            typedef typename std::remove_reference<decltype(std::declval<T>()[0])>::type type;
+        };
+
+        // true if input row DR of a block (relative to its first row) at column
+        // offset DJ has a nonzero weight for any of the first B rows of the block
+        constexpr bool simd_used(stencil_shape s, int r, int b, int dr, int dj) {
+            return (b==0) ? false
+                 : ( (abs(dr-(b-1))<=r && stencil_weight(s,r,dr-(b-1),dj)!=0.0) || simd_used(s,r,b-1,dr,dj) );
+        }
+
+        template <typename T, stencil_shape S, int R, int DI, int DJ,
+                  bool Zero = (abs(DI)>R || stencil_weight(S,R,DI,DJ)==0.0)>
+        struct simd_row {
+            static PRK_STENCIL_INLINE void fma(const T & v, T & acc) {
+                acc += v * static_cast<typename simd_elem<T>::type>(stencil_weight(S,R,DI,DJ));
+            }
+        };
+
+        template <typename T, stencil_shape S, int R, int DI, int DJ>
+        struct simd_row<T,S,R,DI,DJ,true> {
+            static PRK_STENCIL_INLINE void fma(const T &, T &) {}
+        };
+
+        // adds the contribution of input row DR to accumulators K..B-1
+        template <typename T, stencil_shape S, int R, int B, int DR, int DJ, int K = 0>
+        struct simd_rows {
+            static PRK_STENCIL_INLINE void fma(const T & v, T * acc) {
+                simd_row<T,S,R,DR-K,DJ>::fma(v, acc[K]);
+                simd_rows<T,S,R,B,DR,DJ,K+1>::fma(v, acc);
+            }
+        };
+
+        template <typename T, stencil_shape S, int R, int B, int DR, int DJ>
+        struct simd_rows<T,S,R,B,DR,DJ,B> {
+            static PRK_STENCIL_INLINE void fma(const T &, T *) {}
+        };
+
+        template <typename T, stencil_shape S, int R, int B, int DR, int DJ,
+                  bool Used = simd_used(S,R,B,DR,DJ)>
+        struct simd_load {
+            static PRK_STENCIL_INLINE void run(const typename simd_elem<T>::type * RESTRICT in, int n, int i, int j, T * acc) {
+                T v;
+                __builtin_memcpy(&v, &in[(i+DR)*n+(j+DJ)], sizeof(T));
+                simd_rows<T,S,R,B,DR,DJ>::fma(v, acc);
+            }
+        };
+
+        template <typename T, stencil_shape S, int R, int B, int DR, int DJ>
+        struct simd_load<T,S,R,B,DR,DJ,false> {
+            static PRK_STENCIL_INLINE void run(const typename simd_elem<T>::type * RESTRICT, int, int, int, T *) {}
+        };
+
+        // visits input rows -R..B-1+R and columns -R..R of the block
+        template <typename T, stencil_shape S, int R, int B, int DR = -R, int DJ = -R,
+                  bool Last = (DR==B-1+R && DJ==R)>
+        struct simd_taps {
+            static PRK_STENCIL_INLINE void run(const typename simd_elem<T>::type * RESTRICT in, int n, int i, int j, T * acc) {
+                simd_load<T,S,R,B,DR,DJ>::run(in, n, i, j, acc);
+                simd_taps<T,S,R,B, (DJ==R ? DR+1 : DR), (DJ==R ? -R : DJ+1)>::run(in, n, i, j, acc);
+            }
+        };
+
+        template <typename T, stencil_shape S, int R, int B, int DR, int DJ>
+        struct simd_taps<T,S,R,B,DR,DJ,true> {
+            static PRK_STENCIL_INLINE void run(const typename simd_elem<T>::type * RESTRICT in, int n, int i, int j, T * acc) {
+                simd_load<T,S,R,B,DR,DJ>::run(in, n, i, j, acc);
+            }
+        };
+
+        // out(i..i+B-1, j..j+W-1) += stencil, with W = Bytes/sizeof(E)
+        template <stencil_shape S, int R, int Bytes, int B, typename E>
+        PRK_STENCIL_INLINE void simd_block(const E * RESTRICT in, E * RESTRICT out, int n, int i, int j)
+        {
+            typedef typename simd_vec<E,Bytes>::type T;
+            T acc[B];
+            for (int b=0; b<B; ++b) {
+                acc[b] = T{} ;
+            }
+            simd_taps<T,S,R,B>::run(in, n, i, j, acc);
+            for (int b=0; b<B; ++b) {
+                T o;
+                __builtin_memcpy(&o, &out[(i+b)*n+j], sizeof(T));
+                o += acc[b];
+                __builtin_memcpy(&out[(i+b)*n+j], &o, sizeof(T));
+            }
+        }
+
+        // rows [i,i+B) of one column tile [jt,jend)
+        template <stencil_shape S, int R, int Bytes, int B, typename E>
+        PRK_STENCIL_INLINE void simd_rows_tile(const E * RESTRICT in, E * RESTRICT out,
+                                               int n, int i, int jt, int jend)
+        {
+            constexpr int W = Bytes/sizeof(E);
+            auto j=jt;
+            for (; j+W<=jend; j+=W) {
+                simd_block<S,R,Bytes,B>(in, out, n, i, j);
+            }
+            for (; j<jend; ++j) {
+                for (int b=0; b<B; ++b) {
+                    out[(i+b)*n+j] += taps<S,R>::sum(in, n, i+b, j, E(0));
+                }
+            }
+        }
+
+        template <stencil_shape S, int R, int Bytes, int B, typename E>
+        PRK_STENCIL_INLINE void simd_sweep(const int n, const int t, const E * RESTRICT in, E * RESTRICT out)
+        {
+            for (auto jt=R; jt<n-R; jt+=t) {
+                const int jend = std::min(n-R,jt+t);
+                auto i=R;
+                for (; i+B<=n-R; i+=B) {
+                    simd_rows_tile<S,R,Bytes,B>(in, out, n, i, jt, jend);
+                }
+                for (; i<n-R; ++i) {
+                    simd_rows_tile<S,R,Bytes,1>(in, out, n, i, jt, jend);
+                }
+            }
+        }
+
+        // mixed precision has no SIMD kernel, so it runs the scalar loop
+        template <stencil_shape S, int R, int Bytes, int B, typename T, typename C>
+        void simd_sweep(const int n, const int t, const T * RESTRICT in, C * RESTRICT out)
+        {
+            for (auto jt=R; jt<n-R; jt+=t) {
+                const int jend = std::min(n-R,jt+t);
+                for (auto i=R; i<n-R; ++i) {
+                    for (auto j=jt; j<jend; ++j) {
+                        out[i*n+j] += taps<S,R>::sum(in, n, i, j, C(0));
+                    }
+                }
+            }
+        }
+
+    } // namespace stencil_detail
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::sse2> {
+        template <typename VI, typename VO>
+        __attribute__((target("sse2")))
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            stencil_detail::simd_sweep<Shape,Radius,16,4>(n, t, in.data(), out.data());
+        }
+    };
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::avx2> {
+        template <typename VI, typename VO>
+        __attribute__((target("avx2,fma")))
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            stencil_detail::simd_sweep<Shape,Radius,32,4>(n, t, in.data(), out.data());
+        }
+    };
+
+    template <stencil_shape Shape, int Radius>
+    struct stencil<Shape, Radius, stencil_backend::avx512> {
+        template <typename VI, typename VO>
+        __attribute__((target("avx512f,fma")))
+        static void apply(const int n, const int t, VI & in, VO & out) {
+            stencil_detail::simd_sweep<Shape,Radius,64,4>(n, t, in.data(), out.data());
+        }
+    };
+
+#endif /* PRK_STENCIL_SIMD */
+
+    /// The widest ISA with a SIMD stencil kernel that this CPU supports,
+    /// limited by PRK_STENCIL_ISA: "avx512", "avx2", "sse2" or "none".
+    static inline std::string stencil_simd_isa(void)
+    {
+        const char * e = std::getenv("PRK_STENCIL_ISA");
+        const std::string limit = (e!=nullptr) ? std::string(e) : std::string("avx512");
+#ifdef PRK_STENCIL_SIMD
+        __builtin_cpu_init();
+        if ( (limit=="avx512") && __builtin_cpu_supports("avx512f") ) return "avx512";
+        if ( (limit=="avx512" || limit=="avx2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) return "avx2";
+        if ( (limit!="none") && __builtin_cpu_supports("sse2") ) return "sse2";
+#endif
+        return "none";
+    }
+
+    /// As make_stencil, for the SIMD kernel of the given ISA; returns
+    /// fallback (e.g. the seq backend) for "none".
+    template <typename F>
+    F make_stencil_simd(const std::string & isa, bool star, int radius, F fallback)
+    {
+#ifdef PRK_STENCIL_SIMD
+        if (isa == "avx512") return make_stencil<stencil_backend::avx512>(star, radius, fallback);
+        if (isa == "avx2")   return make_stencil<stencil_backend::avx2>(star, radius, fallback);
+        if (isa == "sse2")   return make_stencil<stencil_backend::sse2>(star, radius, fallback);
+#else
+        (void)isa; (void)star; (void)radius;
+#endif
+        return fallback;
+    }
+
+} // namespace prk
+
+#endif /* PRK_STENCIL_SIMD_H */
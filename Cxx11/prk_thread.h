@@ -0,0 +1,444 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_THREAD_H
+#define PRK_THREAD_H
+
+/// A persistent work-stealing thread pool for the C++11 thread and async
+/// variants, with no dependence on OpenMP or TBB.
+///
+/// The pool starts size()-1 workers once and reuses them for every
+/// parallel_for, so a kernel does not pay for thread creation per
+/// iteration.  The calling thread takes part as worker 0.  A loop is cut
+/// into chunks of the grain size and each worker owns a Chase-Lev deque
+/// of chunk ranges: it splits the range it holds in halves, pushes the
+/// upper halves to the bottom of its deque and runs one chunk at a time,
+/// while idle workers steal the largest pending range from the top of a
+/// random victim.  Since a range is split in halves, a deque holds at most
+/// log2(chunks) ranges, so the deques have a fixed capacity.
+/// for_each_worker instead runs one call per worker without stealing, for
+/// the kernels that place their data by first touch.
+///
+/// PRK_NUM_THREADS sets the default size (hardware_concurrency otherwise)
+/// and PRK_THREAD_PIN=1 pins worker p to core p on Linux.
+///
+/// parallel_for is called by the thread that created the pool, and never
+/// from inside a task, i.e. parallel loops do not nest.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace prk {
+
+    /// [begin,end) cut into chunks of grainsize, as tbb::blocked_range
+    class blocked_range {
+
+        private:
+            int begin_;
+            int end_;
+            int grain_;
+
+        public:
+            blocked_range(int begin, int end, int grainsize = 1)
+                : begin_(begin), end_(end), grain_(std::max(grainsize,1)) {}
+
+            int begin(void) const { return begin_; }
+            int end(void) const { return end_; }
+            int grainsize(void) const { return grain_; }
+            int size(void) const { return end_-begin_; }
+
+            int chunks(void) const {
+                return (size() > 0) ? (size()+grain_-1)/grain_ : 0;
+            }
+
+            blocked_range chunk(int k) const {
+                const int b = begin_ + k*grain_;
+                return blocked_range(b, std::min(end_,b+grain_), grain_);
+            }
+    };
+
+    /// rows x cols cut into row-major tiles, as tbb::blocked_range2d
+    class blocked_range2d {
+
+        private:
+            blocked_range rows_;
+            blocked_range cols_;
+
+        public:
+            blocked_range2d(int row_begin, int row_end, int row_grainsize,
+                            int col_begin, int col_end, int col_grainsize)
+                : rows_(row_begin, row_end, row_grainsize), cols_(col_begin, col_end, col_grainsize) {}
+
+            blocked_range2d(const blocked_range & rows, const blocked_range & cols)
+                : rows_(rows), cols_(cols) {}
+
+            const blocked_range & rows(void) const { return rows_; }
+            const blocked_range & cols(void) const { return cols_; }
+
+            int chunks(void) const {
+                return rows_.chunks() * cols_.chunks();
+            }
+
+            blocked_range2d chunk(int k) const {
+                const int nc = cols_.chunks();
+                return blocked_range2d(rows_.chunk(k/nc), cols_.chunk(k%nc));
+            }
+    };
+
+    namespace thread_detail {
+
+        /// Chase-Lev work-stealing deque (Le et al., PPoPP 2013) of ranges
+        /// [lo,hi) of chunks packed in one word.  The owner pushes and pops
+        /// at the bottom, thieves steal at the top.  The capacity is fixed,
+        /// so push fails rather than grow when the deque is full.
+        class deque {
+
+            private:
+                static const int64_t capacity = 64;
+
+                alignas(64) std::atomic<int64_t> top_;
+                alignas(64) std::atomic<int64_t> bottom_;
+                std::atomic<uint64_t> items_[capacity];
+
+            public:
+                deque() : top_(0), bottom_(0) {}
+
+                static uint64_t pack(int lo, int hi) {
+                    return (static_cast<uint64_t>(static_cast<uint32_t>(lo)) << 32) | static_cast<uint32_t>(hi);
+                }
+
+                static int lo(uint64_t r) { return static_cast<int>(r >> 32); }
+                static int hi(uint64_t r) { return static_cast<int>(r & 0xffffffffu); }
+
+                // owner only
+                bool push(uint64_t r) {
+                    const int64_t b = bottom_.load(std::memory_order_relaxed);
+                    const int64_t t = top_.load(std::memory_order_acquire);
+                    if (b-t >= capacity) return false;
+                    items_[b % capacity].store(r, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+                    bottom_.store(b+1, std::memory_order_relaxed);
+                    return true;
+                }
+
+                // owner only
+                bool pop(uint64_t & r) {
+                    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+                    bottom_.store(b, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    int64_t t = top_.load(std::memory_order_relaxed);
+                    if (t > b) {
+                        bottom_.store(b+1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    r = items_[b % capacity].load(std::memory_order_relaxed);
+                    if (t < b) return true;
+                    // last item: race the thieves for it
+                    const bool won = top_.compare_exchange_strong(t, t+1, std::memory_order_seq_cst,
+                                                                  std::memory_order_relaxed);
+                    bottom_.store(b+1, std::memory_order_relaxed);
+                    return won;
+                }
+
+                // any thread
+                bool steal(uint64_t & r) {
+                    int64_t t = top_.load(std::memory_order_acquire);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    const int64_t b = bottom_.load(std::memory_order_acquire);
+                    if (t >= b) return false;
+                    r = items_[t % capacity].load(std::memory_order_relaxed);
+                    return top_.compare_exchange_strong(t, t+1, std::memory_order_seq_cst,
+                                                        std::memory_order_relaxed);
+                }
+        };
+
+        /// pins the calling thread to core p modulo the number of cores
+        static inline void pin(int p)
+        {
+#ifdef __linux__
+            const int ncores = std::max(1u, std::thread::hardware_concurrency());
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(p % ncores, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void)p;
+#endif
+        }
+
+    } // namespace thread_detail
+
+    class thread_pool {
+
+        private:
+            typedef void (*body_t)(const void *, int);
+
+            int size_;
+            bool pinned_;
+            std::vector<std::thread> workers_;
+            std::unique_ptr<thread_detail::deque[]> deques_;
+
+            // the current loop: body_(ctx_,k) runs chunk k
+            body_t body_;
+            const void * ctx_;
+            alignas(64) std::atomic<int> pending_;
+
+            // the loop of for_each_worker counts down the workers in arrived_
+            alignas(64) std::atomic<int> arrived_;
+
+            // workers sleep between loops until epoch_ changes, its lowest
+            // bit is set for the loops of for_each_worker
+            alignas(64) std::atomic<uint64_t> epoch_;
+            bool stop_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+
+            // idle polls of epoch_ before a worker goes to sleep
+            static const int spin_ = 4096;
+
+            // runs the chunks of r, leaving the upper halves for thieves
+            void execute(int p, uint64_t r)
+            {
+                int lo = thread_detail::deque::lo(r);
+                int hi = thread_detail::deque::hi(r);
+                while (lo < hi) {
+                    while (hi-lo > 1) {
+                        const int mid = lo + (hi-lo)/2;
+                        if (!deques_[p].push(thread_detail::deque::pack(mid,hi))) break;
+                        hi = mid;
+                    }
+                    for (auto k=lo; k<hi; ++k) {
+                        body_(ctx_, k);
+                    }
+                    pending_.fetch_sub(hi-lo, std::memory_order_acq_rel);
+                    uint64_t next;
+                    if (!deques_[p].pop(next)) return;
+                    lo = thread_detail::deque::lo(next);
+                    hi = thread_detail::deque::hi(next);
+                }
+            }
+
+            // worker p runs and steals chunks until the loop is done
+            void work(int p)
+            {
+                uint32_t seed = 2654435761u * static_cast<uint32_t>(p+1);
+                while (pending_.load(std::memory_order_acquire) > 0) {
+                    uint64_t r;
+                    if (deques_[p].pop(r)) {
+                        execute(p, r);
+                        continue;
+                    }
+                    if (size_ > 1) {
+                        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+                        const int victim = static_cast<int>(seed % static_cast<uint32_t>(size_));
+                        if (victim != p && deques_[victim].steal(r)) {
+                            execute(p, r);
+                            continue;
+                        }
+                    }
+                    std::this_thread::yield();
+                }
+            }
+
+            void worker(int p)
+            {
+                if (pinned_) thread_detail::pin(p);
+                uint64_t seen = 0;
+                while (true) {
+                    int spin = 0;
+                    while (epoch_.load(std::memory_order_acquire) == seen && spin++ < spin_) {
+                        std::this_thread::yield();
+                    }
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        wake_.wait(lock, [&] { return stop_ || epoch_.load(std::memory_order_acquire) != seen; });
+                        if (stop_) return;
+                        seen = epoch_.load(std::memory_order_acquire);
+                    }
+                    if (seen & 1) {
+                        body_(ctx_, p);
+                        arrived_.fetch_sub(1, std::memory_order_acq_rel);
+                    } else {
+                        work(p);
+                    }
+                }
+            }
+
+            template <typename R, typename F>
+            static void run_chunk(const void * ctx, int k)
+            {
+                const auto & c = *static_cast<const std::pair<const R*,const F*>*>(ctx);
+                (*c.second)(c.first->chunk(k));
+            }
+
+            void run(body_t body, const void * ctx, int chunks)
+            {
+                if (chunks <= 0) return;
+                body_ = body;
+                ctx_  = ctx;
+                pending_.store(chunks, std::memory_order_release);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    epoch_.store((epoch_.load(std::memory_order_relaxed) | 1) + 1, std::memory_order_release);
+                }
+                wake_.notify_all();
+                execute(0, thread_detail::deque::pack(0,chunks));
+                work(0);
+            }
+
+            // body(ctx,p) on worker p for every p
+            void run_each(body_t body, const void * ctx)
+            {
+                body_ = body;
+                ctx_  = ctx;
+                arrived_.store(size_-1, std::memory_order_release);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    epoch_.store((epoch_.load(std::memory_order_relaxed) | 1) + 2, std::memory_order_release);
+                }
+                wake_.notify_all();
+                body_(ctx_, 0);
+                while (arrived_.load(std::memory_order_acquire) > 0) {
+                    std::this_thread::yield();
+                }
+            }
+
+            template <typename F>
+            static void run_worker(const void * ctx, int p)
+            {
+                (*static_cast<const F*>(ctx))(p);
+            }
+
+        public:
+            explicit thread_pool(int num_threads = default_size())
+                : size_(std::max(num_threads,1)),
+                  pinned_(prk::bench::getenv_int("PRK_THREAD_PIN",0) != 0),
+                  deques_(new thread_detail::deque[std::max(num_threads,1)]),
+                  body_(nullptr), ctx_(nullptr), pending_(0), arrived_(0), epoch_(0), stop_(false)
+            {
+                if (pinned_) thread_detail::pin(0);
+                workers_.reserve(size_-1);
+                for (auto p=1; p<size_; ++p) {
+                    workers_.push_back(std::thread([this,p] { worker(p); }));
+                }
+            }
+
+            ~thread_pool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                wake_.notify_all();
+                std::for_each(workers_.begin(), workers_.end(), [](std::thread & t) { t.join(); });
+            }
+
+            thread_pool(const thread_pool &) = delete;
+            thread_pool & operator=(const thread_pool &) = delete;
+
+            static int default_size(void)
+            {
+                const int hw = std::max(1u, std::thread::hardware_concurrency());
+                return std::max(1,prk::bench::getenv_int("PRK_NUM_THREADS",hw));
+            }
+
+            int size(void) const { return size_; }
+            bool pinned(void) const { return pinned_; }
+
+            /// f(const blocked_range &) once per chunk of r
+            template <typename F>
+            void parallel_for(const blocked_range & r, const F & f)
+            {
+                const std::pair<const blocked_range*,const F*> ctx(&r, &f);
+                run(run_chunk<blocked_range,F>, &ctx, r.chunks());
+            }
+
+            /// f(const blocked_range2d &) once per tile of r
+            template <typename F>
+            void parallel_for(const blocked_range2d & r, const F & f)
+            {
+                const std::pair<const blocked_range2d*,const F*> ctx(&r, &f);
+                run(run_chunk<blocked_range2d,F>, &ctx, r.chunks());
+            }
+
+            /// f(i) for i in [begin,end)
+            template <typename F>
+            void parallel_for(int begin, int end, const F & f)
+            {
+                parallel_for(blocked_range(begin, end), [&f](const blocked_range & r) {
+                    for (auto i=r.begin(); i<r.end(); ++i) f(i);
+                });
+            }
+
+            /// f(p) on worker p for p in [0,size()), without stealing, so
+            /// the data a worker touches first stays with the same worker
+            /// (and with PRK_THREAD_PIN=1 on the same core) from one call
+            /// to the next
+            template <typename F>
+            void for_each_worker(const F & f)
+            {
+                run_each(run_worker<F>, &f);
+            }
+    };
+
+    /// Collects tasks with run() and executes them on the pool in wait(),
+    /// the pool counterpart of a vector of std::async futures.
+    class task_group {
+
+        private:
+            thread_pool & pool_;
+            std::vector<std::function<void()>> tasks_;
+
+        public:
+            explicit task_group(thread_pool & pool) : pool_(pool) {}
+
+            template <typename F>
+            void run(F && f) {
+                tasks_.emplace_back(std::forward<F>(f));
+            }
+
+            void wait(void) {
+                pool_.parallel_for(0, static_cast<int>(tasks_.size()), [this](int i) { tasks_[i](); });
+                tasks_.clear();
+            }
+    };
+
+} // namespace prk
+
+#endif /* PRK_THREAD_H */
@@ -0,0 +1,112 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_TRANSPOSE_H
+#define PRK_TRANSPOSE_H
+
+/// Cache-oblivious transpose: B += A^T; A += 1 without a tile size.
+///
+/// prk::transpose_oblivious<Fork> halves the longer side of the block of
+/// B it is given until the block is at most oblivious_base on a side, so
+/// at some depth of the recursion the blocks of A and B fit in every level
+/// of the cache, whatever its size.  The leaves run the tile kernel of
+/// prk_transpose_simd.h (or the scalar loop), and the split points are
+/// multiples of oblivious_align so the leaves fill whole SIMD blocks.
+/// The halves are disjoint in both A and B, so blocks of at least
+/// oblivious_fork elements run their halves in parallel with Fork
+/// (prk::fork_seq, fork_task or fork_tbb).
+///
+/// PRK_TRANSPOSE_OBLIVIOUS=1 selects it in the drivers that support it.
+
+#include "prk_transpose_simd.h"
+
+namespace prk {
+
+    static inline bool transpose_oblivious_enabled(void)
+    {
+        return (prk::bench::getenv_int("PRK_TRANSPOSE_OBLIVIOUS",0) != 0);
+    }
+
+    /// PRK_TRANSPOSE_INPLACE=1 transposes A onto itself (square matrices only)
+    static inline bool transpose_inplace_enabled(void)
+    {
+        return (prk::bench::getenv_int("PRK_TRANSPOSE_INPLACE",0) != 0);
+    }
+
+    namespace transpose_detail {
+
+        constexpr int oblivious_base  = 64;
+        constexpr int oblivious_align = 16;
+        constexpr int oblivious_fork  = 128*128;
+
+        // rows [i0,i1) x columns [j0,j1) of B
+        template <typename Fork, typename TA, typename TB>
+        void oblivious(const int order, const int i0, const int i1, const int j0, const int j1,
+                       TA * RESTRICT A, TB * RESTRICT B, transpose_tile_fn<TA,TB> leaf)
+        {
+            const int ni = i1-i0;
+            const int nj = j1-j0;
+            if (ni <= oblivious_base && nj <= oblivious_base) {
+                leaf(order, i0, i1, j0, j1, A, B);
+                return;
+            }
+            const bool rows = (ni >= nj);
+            const int n = rows ? ni : nj;
+            const int m = ((n/2 + oblivious_align-1)/oblivious_align)*oblivious_align;
+            const int i2 = rows ? i0+m : i1;
+            const int j2 = rows ? j1 : j0+m;
+            const int i3 = rows ? i0+m : i0;
+            const int j3 = rows ? j0 : j0+m;
+            if (static_cast<long>(ni)*nj >= oblivious_fork) {
+                Fork::run([=] { oblivious<Fork>(order, i0, i2, j0, j2, A, B, leaf); },
+                          [=] { oblivious<Fork>(order, i3, i1, j3, j1, A, B, leaf); });
+            } else {
+                oblivious<Fork>(order, i0, i2, j0, j2, A, B, leaf);
+                oblivious<Fork>(order, i3, i1, j3, j1, A, B, leaf);
+            }
+        }
+
+    } // namespace transpose_detail
+
+    /// B += A^T; A += 1 for order x order matrices, with the SIMD tile kernel
+    /// of the given ISA at the leaves ("none" for the scalar loop)
+    template <typename Fork, typename TA, typename TB>
+    void transpose_oblivious(const int order, TA * RESTRICT A, TB * RESTRICT B, const std::string & isa)
+    {
+        transpose_tile_fn<TA,TB> leaf = make_transpose_simd<TA,TB>(isa);
+        if (leaf == nullptr) leaf = transpose_detail::tile_scalar<TA,TB>;
+        transpose_detail::oblivious<Fork>(order, 0, order, 0, order, A, B, leaf);
+    }
+
+} // namespace prk
+
+#endif /* PRK_TRANSPOSE_H */
@@ -0,0 +1,399 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef PRK_TRANSPOSE_SIMD_H
+#define PRK_TRANSPOSE_SIMD_H
+
+/// In-register transpose kernels for B += A^T; A += 1 with runtime ISA
+/// dispatch.
+///
+/// A tile is cut into W x W blocks, W being the number of elements in a
+/// vector (2x2 double with SSE2, 4x4 with AVX2 and 8x8 with AVX-512, twice
+/// that in float).  A block loads W rows of A, transposes them in
+/// registers in log2(W) stages that swap the off-diagonal h x h sub-blocks
+/// of every pair of rows h apart, and adds the resulting rows to B, so both
+/// matrices are accessed one full vector at a time instead of A being
+/// gathered one element per row.  The swaps are written with
+/// __builtin_shufflevector on GCC vector extensions, so one generic kernel
+/// is compiled per ISA with target attributes and the compiler emits the
+/// unpack/permute shuffles of that ISA.  The rows and columns of a tile
+/// that do not fill a block use the scalar loop.
+///
+/// The in-place kernels (A = A^T + 1) swap a pair of tiles (it,jt) and
+/// (jt,it) with the same blocks: both blocks of a pair are transposed in
+/// registers and stored in each other's place.  Pairs are disjoint, so
+/// they can be processed in any order or in parallel.
+///
+/// prk::transpose_simd_isa() picks the widest ISA the CPU supports,
+/// limited by PRK_TRANSPOSE_ISA=none|sse2|avx2|avx512.
+
+#include "prk_util.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# if defined(__has_builtin)
+#  if __has_builtin(__builtin_shufflevector)
+#   define PRK_TRANSPOSE_SIMD 1
+#  endif
+# endif
+#endif
+
+#define PRK_TRANSPOSE_INLINE inline __attribute__((always_inline))
+
+namespace prk {
+
+    /// transposes rows [it,imax) x columns [jt,jmax) of an order x order matrix
+    template <typename TA, typename TB>
+    using transpose_tile_fn = void (*)(const int order, const int it, const int imax,
+                                       const int jt, const int jmax, TA * RESTRICT A, TB * RESTRICT B);
+
+    /// A = A^T + 1 on the pair of tiles rows [it,imax) x columns [jt,jmax)
+    /// and its mirror, for it <= jt (the tile is square when it == jt)
+    template <typename T>
+    using transpose_inplace_fn = void (*)(const int order, const int it, const int imax,
+                                          const int jt, const int jmax, T * RESTRICT A);
+
+    namespace transpose_detail {
+
+        template <typename TA, typename TB>
+        static PRK_TRANSPOSE_INLINE void scalar(const int order, const int it, const int imax,
+                                                const int jt, const int jmax, TA * RESTRICT A, TB * RESTRICT B)
+        {
+            for (auto i=it; i<imax; i++) {
+                for (auto j=jt; j<jmax; j++) {
+                    B[i*order+j] += A[j*order+i];
+                    A[j*order+i] += TA(1);
+                }
+            }
+        }
+
+        template <typename TA, typename TB>
+        void tile_scalar(const int order, const int it, const int imax,
+                         const int jt, const int jmax, TA * RESTRICT A, TB * RESTRICT B)
+        {
+            scalar(order, it, imax, jt, jmax, A, B);
+        }
+
+        // A(i,j), A(j,i) = A(j,i)+1, A(i,j)+1
+        template <typename T>
+        static PRK_TRANSPOSE_INLINE void swap1(const int order, const int i, const int j, T * RESTRICT A)
+        {
+            const T a = A[i*order+j];
+            A[i*order+j] = A[j*order+i] + T(1);
+            A[j*order+i] = a + T(1);
+        }
+
+        // the elements of an in-place tile pair not covered by the W x W blocks
+        // of rows [it,ib) x columns [jt,jb); W=1 does the whole pair
+        template <typename T>
+        static PRK_TRANSPOSE_INLINE void scalar_inplace(const int order, const int it, const int imax,
+                                                        const int jt, const int jmax,
+                                                        const int ib, const int jb, T * RESTRICT A)
+        {
+            if (it == jt) {
+                // upper triangle of the diagonal tile, then its diagonal
+                for (auto i=it; i<imax; i++) {
+                    for (auto j=std::max(i+1,jb); j<jmax; j++) {
+                        swap1(order, i, j, A);
+                    }
+                    if (i >= ib) A[i*order+i] += T(1);
+                }
+            } else {
+                for (auto i=it; i<imax; i++) {
+                    for (auto j=(i<ib ? jb : jt); j<jmax; j++) {
+                        swap1(order, i, j, A);
+                    }
+                }
+            }
+        }
+
+        template <typename T>
+        void tile_inplace_scalar(const int order, const int it, const int imax,
+                                 const int jt, const int jmax, T * RESTRICT A)
+        {
+            scalar_inplace(order, it, imax, jt, jmax, it, jt, A);
+        }
+
+#ifdef PRK_TRANSPOSE_SIMD
+
+        template <typename T, int Bytes>
+        struct vec {
+            typedef T type __attribute__((vector_size(Bytes)));
+        };
+
+        // lane L of the pair of rows (a,b) after swapping their off-diagonal
+        // H x H sub-blocks, as an index into the concatenation of a and b
+        constexpr int swap_lane(int w, int h, bool hi, int l) {
+            return hi ? ( (l & h) ? w+l : l+h ) : ( (l & h) ? w+l-h : l );
+        }
+
+        template <typename V, int W, int H, int... L>
+        static PRK_TRANSPOSE_INLINE void swap(V & a, V & b, std::integer_sequence<int,L...>) {
+            const V lo = __builtin_shufflevector(a, b, swap_lane(W,H,false,L)...);
+            const V hi = __builtin_shufflevector(a, b, swap_lane(W,H,true,L)...);
+            a = lo;
+            b = hi;
+        }
+
+        // one stage per H = W/2, W/4, ..., 1
+        template <typename V, int W, int H>
+        struct stage {
+            static PRK_TRANSPOSE_INLINE void run(V * r) {
+                for (int k=0; k<W; ++k) {
+                    if (!(k & H)) swap<V,W,H>(r[k], r[k+H], std::make_integer_sequence<int,W>());
+                }
+                stage<V,W,H/2>::run(r);
+            }
+        };
+
+        template <typename V, int W>
+        struct stage<V,W,0> {
+            static PRK_TRANSPOSE_INLINE void run(V *) {}
+        };
+
+        // row K..W-1 of a block, unrolled so that the rows stay in registers
+        template <typename T, typename V, int W, int K = 0>
+        struct rows {
+            // r[k] = A(j+k,i:i+W); A(j+k,i:i+W) += 1
+            static PRK_TRANSPOSE_INLINE void load(const int order, const int i, const int j, T * RESTRICT A, V * r) {
+                __builtin_memcpy(&r[K], &A[(j+K)*order+i], sizeof(V));
+                const V a = r[K] + T(1);
+                __builtin_memcpy(&A[(j+K)*order+i], &a, sizeof(V));
+                rows<T,V,W,K+1>::load(order, i, j, A, r);
+            }
+            // B(i+k,j:j+W) += r[k]
+            static PRK_TRANSPOSE_INLINE void add(const int order, const int i, const int j, T * RESTRICT B, const V * r) {
+                V b;
+                __builtin_memcpy(&b, &B[(i+K)*order+j], sizeof(V));
+                b += r[K];
+                __builtin_memcpy(&B[(i+K)*order+j], &b, sizeof(V));
+                rows<T,V,W,K+1>::add(order, i, j, B, r);
+            }
+            // r[k] = A(i+k,j:j+W)
+            static PRK_TRANSPOSE_INLINE void get(const int order, const int i, const int j, const T * RESTRICT A, V * r) {
+                __builtin_memcpy(&r[K], &A[(i+K)*order+j], sizeof(V));
+                rows<T,V,W,K+1>::get(order, i, j, A, r);
+            }
+            // A(i+k,j:j+W) = r[k] + 1
+            static PRK_TRANSPOSE_INLINE void put1(const int order, const int i, const int j, T * RESTRICT A, const V * r) {
+                const V a = r[K] + T(1);
+                __builtin_memcpy(&A[(i+K)*order+j], &a, sizeof(V));
+                rows<T,V,W,K+1>::put1(order, i, j, A, r);
+            }
+        };
+
+        template <typename T, typename V, int W>
+        struct rows<T,V,W,W> {
+            static PRK_TRANSPOSE_INLINE void load(const int, const int, const int, T * RESTRICT, V *) {}
+            static PRK_TRANSPOSE_INLINE void add(const int, const int, const int, T * RESTRICT, const V *) {}
+            static PRK_TRANSPOSE_INLINE void get(const int, const int, const int, const T * RESTRICT, V *) {}
+            static PRK_TRANSPOSE_INLINE void put1(const int, const int, const int, T * RESTRICT, const V *) {}
+        };
+
+        // B(i:i+W,j:j+W) += A(j:j+W,i:i+W)^T; A(j:j+W,i:i+W) += 1
+        template <typename T, int Bytes>
+        static PRK_TRANSPOSE_INLINE void block(const int order, const int i, const int j,
+                                               T * RESTRICT A, T * RESTRICT B)
+        {
+            typedef typename vec<T,Bytes>::type V;
+            constexpr int W = Bytes/sizeof(T);
+            V r[W];
+            rows<T,V,W>::load(order, i, j, A, r);
+            stage<V,W,W/2>::run(r);
+            rows<T,V,W>::add(order, i, j, B, r);
+        }
+
+        template <typename T, int Bytes>
+        static PRK_TRANSPOSE_INLINE void tile(const int order, const int it, const int imax,
+                                              const int jt, const int jmax, T * RESTRICT A, T * RESTRICT B)
+        {
+            constexpr int W = Bytes/sizeof(T);
+            const int ib = it + ((imax-it)/W)*W;
+            const int jb = jt + ((jmax-jt)/W)*W;
+            for (auto i=it; i<ib; i+=W) {
+                for (auto j=jt; j<jb; j+=W) {
+                    block<T,Bytes>(order, i, j, A, B);
+                }
+            }
+            // remainders: the columns right of the blocks, then the rows below
+            scalar(order, it, ib, jb, jmax, A, B);
+            scalar(order, ib, imax, jt, jmax, A, B);
+        }
+
+        // A(i:i+W,j:j+W), A(j:j+W,i:i+W) = A(j:j+W,i:i+W)^T+1, A(i:i+W,j:j+W)^T+1
+        template <typename T, int Bytes>
+        static PRK_TRANSPOSE_INLINE void block_inplace(const int order, const int i, const int j, T * RESTRICT A)
+        {
+            typedef typename vec<T,Bytes>::type V;
+            constexpr int W = Bytes/sizeof(T);
+            V r[W];
+            rows<T,V,W>::get(order, i, j, A, r);
+            stage<V,W,W/2>::run(r);
+            if (i == j) {
+                rows<T,V,W>::put1(order, i, i, A, r);
+                return;
+            }
+            V s[W];
+            rows<T,V,W>::get(order, j, i, A, s);
+            stage<V,W,W/2>::run(s);
+            rows<T,V,W>::put1(order, j, i, A, r);
+            rows<T,V,W>::put1(order, i, j, A, s);
+        }
+
+        template <typename T, int Bytes>
+        static PRK_TRANSPOSE_INLINE void tile_inplace(const int order, const int it, const int imax,
+                                                      const int jt, const int jmax, T * RESTRICT A)
+        {
+            constexpr int W = Bytes/sizeof(T);
+            const int ib = it + ((imax-it)/W)*W;
+            const int jb = jt + ((jmax-jt)/W)*W;
+            for (auto i=it; i<ib; i+=W) {
+                // the upper triangle of blocks of a diagonal tile
+                for (auto j=(it==jt ? i : jt); j<jb; j+=W) {
+                    block_inplace<T,Bytes>(order, i, j, A);
+                }
+            }
+            scalar_inplace(order, it, imax, jt, jmax, ib, jb, A);
+        }
+
+        template <typename T>
+        __attribute__((target("sse2")))
+        void tile_sse2(const int order, const int it, const int imax,
+                       const int jt, const int jmax, T * RESTRICT A, T * RESTRICT B) {
+            tile<T,16>(order, it, imax, jt, jmax, A, B);
+        }
+
+        template <typename T>
+        __attribute__((target("sse2")))
+        void tile_inplace_sse2(const int order, const int it, const int imax,
+                               const int jt, const int jmax, T * RESTRICT A) {
+            tile_inplace<T,16>(order, it, imax, jt, jmax, A);
+        }
+
+        template <typename T>
+        __attribute__((target("avx2")))
+        void tile_avx2(const int order, const int it, const int imax,
+                       const int jt, const int jmax, T * RESTRICT A, T * RESTRICT B) {
+            tile<T,32>(order, it, imax, jt, jmax, A, B);
+        }
+
+        template <typename T>
+        __attribute__((target("avx2")))
+        void tile_inplace_avx2(const int order, const int it, const int imax,
+                               const int jt, const int jmax, T * RESTRICT A) {
+            tile_inplace<T,32>(order, it, imax, jt, jmax, A);
+        }
+
+        template <typename T>
+        __attribute__((target("avx512f")))
+        void tile_avx512(const int order, const int it, const int imax,
+                         const int jt, const int jmax, T * RESTRICT A, T * RESTRICT B) {
+            tile<T,64>(order, it, imax, jt, jmax, A, B);
+        }
+
+        template <typename T>
+        __attribute__((target("avx512f")))
+        void tile_inplace_avx512(const int order, const int it, const int imax,
+                                 const int jt, const int jmax, T * RESTRICT A) {
+            tile_inplace<T,64>(order, it, imax, jt, jmax, A);
+        }
+
+#endif /* PRK_TRANSPOSE_SIMD */
+
+        // there are no mixed-precision kernels
+        template <typename TA, typename TB>
+        struct simd_table {
+            static transpose_tile_fn<TA,TB> get(const std::string &) { return nullptr; }
+        };
+
+        template <typename T>
+        struct simd_table<T,T> {
+            static transpose_tile_fn<T,T> get(const std::string & isa) {
+#ifdef PRK_TRANSPOSE_SIMD
+                if (isa == "avx512") return tile_avx512<T>;
+                if (isa == "avx2")   return tile_avx2<T>;
+                if (isa == "sse2")   return tile_sse2<T>;
+#else
+                (void)isa;
+#endif
+                return nullptr;
+            }
+        };
+
+        template <typename T>
+        struct inplace_table {
+            static transpose_inplace_fn<T> get(const std::string & isa) {
+#ifdef PRK_TRANSPOSE_SIMD
+                if (isa == "avx512") return tile_inplace_avx512<T>;
+                if (isa == "avx2")   return tile_inplace_avx2<T>;
+                if (isa == "sse2")   return tile_inplace_sse2<T>;
+#else
+                (void)isa;
+#endif
+                return tile_inplace_scalar<T>;
+            }
+        };
+
+    } // namespace transpose_detail
+
+    /// The widest ISA with a SIMD transpose kernel that this CPU supports,
+    /// limited by PRK_TRANSPOSE_ISA: "avx512", "avx2", "sse2" or "none".
+    static inline std::string transpose_simd_isa(void)
+    {
+        const char * e = std::getenv("PRK_TRANSPOSE_ISA");
+        const std::string limit = (e!=nullptr) ? std::string(e) : std::string("avx512");
+#ifdef PRK_TRANSPOSE_SIMD
+        __builtin_cpu_init();
+        if ( (limit=="avx512") && __builtin_cpu_supports("avx512f") ) return "avx512";
+        if ( (limit=="avx512" || limit=="avx2") && __builtin_cpu_supports("avx2") ) return "avx2";
+        if ( (limit!="none") && __builtin_cpu_supports("sse2") ) return "sse2";
+#endif
+        return "none";
+    }
+
+    /// The tile kernel of the given ISA, or nullptr for "none" or mixed
+    /// precision, in which case the drivers keep their scalar loops.
+    template <typename TA, typename TB>
+    transpose_tile_fn<TA,TB> make_transpose_simd(const std::string & isa)
+    {
+        return transpose_detail::simd_table<TA,TB>::get(isa);
+    }
+
+    /// The in-place tile pair kernel of the given ISA, or the scalar one for "none".
+    template <typename T>
+    transpose_inplace_fn<T> make_transpose_inplace(const std::string & isa)
+    {
+        return transpose_detail::inplace_table<T>::get(isa);
+    }
+
+} // namespace prk
+
+#endif /* PRK_TRANSPOSE_SIMD_H */
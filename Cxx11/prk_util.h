@@ -63,6 +63,10 @@
 #include <atomic>
 #include <numeric>
 #include <algorithm>
+#include <memory>  // std::allocator_traits
+#include <new>     // std::bad_alloc
+#include <type_traits>
+#include <limits>
 
 #include "prk_simd.h"
 
@@ -74,6 +78,15 @@
 # include "prk_openmp.h"
 #endif
 
+#ifdef USE_TBB
+# include <tbb/parallel_for.h>
+# include <tbb/blocked_range.h>
+# include <tbb/partitioner.h>
+# include <tbb/task_group.h>
+#endif
+
+#include "prk_alloc.h"
+
 #define RESTRICT __restrict__
 
 #if (defined(__cplusplus) && (__cplusplus >= 201703L))
@@ -134,13 +147,15 @@ namespace prk {
     {
         const int alignment = prk::get_alignment();
         const size_t bytes = n * sizeof(T);
-        return (T*)_mm_malloc( bytes, alignment);
+        void * ptr = prk::alloc::map(bytes);
+        if (ptr==nullptr) ptr = _mm_malloc( bytes, alignment);
+        return (T*)prk::alloc::first_touch(ptr, bytes);
     }
 
     template <typename T>
     void free(T * p)
     {
-        _mm_free(p);
+        if (!prk::alloc::unmap(p)) _mm_free(p);
         p = nullptr;
     }
 
@@ -174,14 +189,18 @@ namespace prk {
         const size_t padded = bytes;
         const size_t excess = bytes % alignment;
         if (excess>0) padded += (alignment - excess);
-        return aligned_alloc(alignment,padded);
+        void * ptr = prk::alloc::map(bytes);
+        if (ptr==nullptr) ptr = aligned_alloc(alignment,padded);
+        return (T*)prk::alloc::first_touch(ptr, bytes);
 
 #else
 
-        T * ptr = nullptr;
-        const int ret = posix_memalign((void**)&ptr,alignment,bytes);
-        if (ret!=0) ptr = nullptr;
-        return ptr;
+        T * ptr = (T*)prk::alloc::map(bytes);
+        if (ptr==nullptr) {
+            const int ret = posix_memalign((void**)&ptr,alignment,bytes);
+            if (ret!=0) ptr = nullptr;
+        }
+        return (T*)prk::alloc::first_touch(ptr, bytes);
 
 #endif
 
@@ -190,7 +209,7 @@ namespace prk {
     template <typename T>
     void free(T * p)
     {
-        std::free(p);
+        if (!prk::alloc::unmap(p)) std::free(p);
         p = nullptr;
     }
 
@@ -212,54 +231,198 @@ namespace prk {
 #endif
     }
 
+    /// Standard allocator on top of prk::malloc, so containers honor
+    /// PRK_ALIGNMENT and the PRK_ALLOC placement policy.
     template <typename T>
+    class allocator {
+
+        public:
+            typedef T value_type;
+
+            allocator() = default;
+
+            template <typename U>
+            allocator(const allocator<U> &) {}
+
+            T * allocate(size_t n) {
+                T * p = prk::malloc<T>(n);
+                if (p==nullptr && n>0) throw std::bad_alloc();
+                return p;
+            }
+
+            void deallocate(T * p, size_t) {
+                prk::free<T>(p);
+            }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const allocator<T> &, const allocator<U> &) { return true; }
+
+    template <typename T, typename U>
+    bool operator!=(const allocator<T> &, const allocator<U> &) { return false; }
+
+    /// Tag for prk::vector constructors that leave the elements uninitialized,
+    /// so that the kernel can first-touch them with its own schedule.
+    struct uninitialized_t {};
+    constexpr uninitialized_t uninitialized{};
+
+    /// Calls f(i) for i in [0,n) with the static schedule the OpenMP and TBB
+    /// drivers use for their 1D loops, so that pages are first touched by the
+    /// thread that later computes on them.
+    template <typename F>
+    void parallel_for_static(size_t n, F f)
+    {
+#if defined(USE_OPENMP) && defined(_OPENMP)
+        OMP_PARALLEL( )
+        {
+            OMP_FOR( schedule(static) )
+            for (size_t i=0; i<n; ++i) {
+                f(i);
+            }
+        }
+#elif defined(USE_TBB)
+        tbb::parallel_for( tbb::blocked_range<size_t>(0,n), [&](const tbb::blocked_range<size_t> & r) {
+                               for (size_t i=r.begin(); i!=r.end(); ++i) {
+                                   f(i);
+                               }
+                           }, tbb::static_partitioner() );
+#else
+        for (size_t i=0; i<n; ++i) {
+            f(i);
+        }
+#endif
+    }
+
+    template <typename T, typename Allocator = prk::allocator<T>>
     class vector {
 
         private:
+            Allocator alloc_;
             T * data_;
             size_t size_;
 
-        public:
+            typedef std::allocator_traits<Allocator> traits;
 
-            vector(size_t n) {
-                //this->data_ = new T[n];
-                this->data_ = prk::malloc<T>(n);
+            void allocate(size_t n) {
+                this->data_ = (n>0) ? traits::allocate(this->alloc_, n) : nullptr;
                 this->size_ = n;
             }
 
-            vector(size_t n, T v) {
-                //this->data_ = new T[n];
-                this->data_ = prk::malloc<T>(n);
-                for (size_t i=0; i<n; ++i) this->data_[i] = v;
-                this->size_ = n;
+            void release(void) {
+                if (this->data_ == nullptr) return;
+                if (!std::is_trivially_destructible<T>::value) {
+                    for (size_t i=0; i<this->size_; ++i) traits::destroy(this->alloc_, &(this->data_[i]));
+                }
+                traits::deallocate(this->alloc_, this->data_, this->size_);
+                this->data_ = nullptr;
+                this->size_ = 0;
+            }
+
+        public:
+
+            typedef T value_type;
+            typedef T * iterator;
+            typedef const T * const_iterator;
+
+            vector(const Allocator & a = Allocator()) : alloc_(a), data_(nullptr), size_(0) {}
+
+            // value-initialized elements, in parallel
+            explicit vector(size_t n, const Allocator & a = Allocator()) : alloc_(a) {
+                allocate(n);
+                T * d = this->data_;
+                Allocator & al = this->alloc_;
+                prk::parallel_for_static(n, [&](size_t i) { traits::construct(al, &d[i]); });
+            }
+
+            // elements are copies of v, in parallel
+            vector(size_t n, const T & v, const Allocator & a = Allocator()) : alloc_(a) {
+                allocate(n);
+                T * d = this->data_;
+                Allocator & al = this->alloc_;
+                prk::parallel_for_static(n, [&](size_t i) { traits::construct(al, &d[i], v); });
+            }
+
+            // element i is f(i), in parallel
+            template <typename F, typename = decltype(std::declval<F&>()(size_t(0)))>
+            vector(size_t n, F f, const Allocator & a = Allocator()) : alloc_(a) {
+                allocate(n);
+                T * d = this->data_;
+                Allocator & al = this->alloc_;
+                prk::parallel_for_static(n, [&](size_t i) { traits::construct(al, &d[i], f(i)); });
+            }
+
+            // elements are not initialized; the caller must write them first
+            vector(size_t n, prk::uninitialized_t, const Allocator & a = Allocator()) : alloc_(a) {
+                static_assert(std::is_trivially_default_constructible<T>::value,
+                              "prk::uninitialized requires a trivial element type");
+                allocate(n);
+            }
+
+            vector(const vector & other)
+              : alloc_(traits::select_on_container_copy_construction(other.alloc_)) {
+                allocate(other.size_);
+                T * d = this->data_;
+                const T * o = other.data_;
+                Allocator & al = this->alloc_;
+                prk::parallel_for_static(this->size_, [&](size_t i) { traits::construct(al, &d[i], o[i]); });
+            }
+
+            vector(vector && other) noexcept
+              : alloc_(std::move(other.alloc_)), data_(other.data_), size_(other.size_) {
+                other.data_ = nullptr;
+                other.size_ = 0;
+            }
+
+            vector & operator=(const vector & other) {
+                if (this != &other) {
+                    vector temp(other);
+                    this->swap(temp);
+                }
+                return *this;
+            }
+
+            vector & operator=(vector && other) noexcept {
+                if (this != &other) {
+                    release();
+                    this->alloc_ = std::move(other.alloc_);
+                    this->data_  = other.data_;
+                    this->size_  = other.size_;
+                    other.data_  = nullptr;
+                    other.size_  = 0;
+                }
+                return *this;
             }
 
             ~vector() {
-                //delete[] this->data_;
-                prk::free<T>(this->data_);
+                release();
             }
 
+            // frees the storage early; the vector is empty afterwards
             void operator~() {
-                this->~vector();
+                release();
+            }
+
+            void swap(vector & other) noexcept {
+                std::swap(this->alloc_, other.alloc_);
+                std::swap(this->data_,  other.data_);
+                std::swap(this->size_,  other.size_);
             }
 
             T * data() {
                 return this->data_;
             }
 
-            size_t size() {
-                return this->size_;
+            const T * data() const {
+                return this->data_;
             }
 
-#if 0
-            T const & operator[] (int n) const {
-                return this->data_[n];
+            size_t size() const {
+                return this->size_;
             }
 
-            T & operator[] (int n) {
-                return this->data_[n];
+            bool empty() const {
+                return (this->size_ == 0);
             }
-#endif
 
             T const & operator[] (size_t n) const {
                 return this->data_[n];
@@ -270,22 +433,20 @@ namespace prk {
             }
 
             T * begin() {
-                return &(this->data_[0]);
+                return this->data_;
             }
 
             T * end() {
-                return &(this->data_[this->size_]);
+                return this->data_ + this->size_;
             }
 
-#if 0
-            T & begin() {
-                return this->data_[0];
+            const T * begin() const {
+                return this->data_;
             }
 
-            T & end() {
-                return this->data_[this->size_];
+            const T * end() const {
+                return this->data_ + this->size_;
             }
-#endif
     };
 
     static inline double wtime(void)
@@ -302,6 +463,39 @@ namespace prk {
 #endif
     }
 
+    /// Fork::run(f,g) runs f and g, possibly in parallel, and returns when
+    /// both are done.  This is the fork-join step of the recursive
+    /// (cache-oblivious) kernels: fork_task must be called from a task or
+    /// a single thread inside a parallel region.
+    struct fork_seq {
+        template <typename F, typename G>
+        static void run(const F & f, const G & g) { f(); g(); }
+    };
+
+#ifdef USE_OPENMP
+    struct fork_task {
+        template <typename F, typename G>
+        static void run(F f, G g) {
+            OMP_TASK( firstprivate(f) )
+            f();
+            g();
+            OMP_TASKWAIT
+        }
+    };
+#endif
+
+#ifdef USE_TBB
+    struct fork_tbb {
+        template <typename F, typename G>
+        static void run(const F & f, const G & g) {
+            tbb::task_group tg;
+            tg.run(f);
+            g();
+            tg.wait();
+        }
+    };
+#endif
+
     template <class T1, class T2>
     static inline auto divceil(T1 numerator, T2 denominator) -> decltype(numerator / denominator) {
         return ( numerator / denominator + (numerator % denominator > 0) );
@@ -309,4 +503,9 @@ namespace prk {
 
 } // namespace prk
 
+#include "prk_bench.h"
+#include "prk_counters.h"
+#include "prk_roofline.h"
+#include "prk_precision.h"
+
 #endif /* PRK_UTIL_H */
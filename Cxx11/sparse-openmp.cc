@@ -0,0 +1,437 @@
+
+///
+/// Copyright (c) 2013, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+//////////////////////////////////////////////////////////////////////
+///
+/// NAME:    Stencil
+///
+/// PURPOSE: This program tests the efficiency with which a space-invariant,
+///          linear, symmetric filter (stencil) can be applied to a square
+///          grid or image.
+///
+/// USAGE:   The program takes as input the linear
+///          dimension of the grid, and the number of iterations on the grid
+///
+///                <progname> <iterations> <grid size>
+///
+///          The output consists of diagnostics to make sure the
+///          algorithm worked, and of timing statistics.
+///
+/// FUNCTIONS CALLED:
+///
+///          Other than standard C functions, the following functions are used in
+///          this program:
+///          wtime()
+///
+/// HISTORY: - Written by Rob Van der Wijngaart, February 2009.
+///          - RvdW: Removed unrolling pragmas for clarity;
+///            added constant to array "in" at end of each iteration to force
+///            refreshing of neighbor data in parallel versions; August 2013
+///            C++11-ification by Jeff Hammond, May 2017.
+///
+//////////////////////////////////////////////////////////////////////
+
+#include "prk_util.h"
+#include "prk_sparse.h"
+#include "prk_sparse_io.h"
+
+int main(int argc, char* argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+#ifdef _OPENMP
+  std::cout << "C++11/OpenMP Sparse matrix-vector multiplication" << std::endl;
+#else
+  std::cout << "C++11 Sparse matrix-vector multiplication" << std::endl;
+#endif
+
+  //////////////////////////////////////////////////////////////////////
+  // Process and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations, lsize(0);
+  unsigned radius(0), stencil_size(0);
+  size_t size(0), size2(0), nent(0);
+  double sparsity(0);
+  std::string file, format, index, order, error;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <2log grid size> <stencil radius> [format: csr|sell|ell] [index: 64|32|delta] [order: none|rcm|morton|hilbert]\n"
+              "   or: <# iterations> <matrix file: .mtx|.csr> [format: csr|sell|ell] [index: 64|32|delta] [order: none|rcm]";
+      }
+
+      // number of times to run the algorithm
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      // a matrix file instead of the generated matrix
+      const std::string arg2(argv[2]);
+      if (arg2.find_first_not_of("0123456789") != std::string::npos) {
+        file = arg2;
+      }
+
+      if (file.empty()) {
+        if (argc < 4) {
+          throw "ERROR: the stencil radius is missing";
+        }
+
+        // linear grid dimension
+        lsize  = std::atoi(argv[2]);
+        if (lsize < 1) {
+          throw "ERROR: grid dimension must be positive";
+        }
+        //size_t lsize2 = 2*lsize;
+        size = 1L<<lsize;
+        size2 = size*size;
+
+        // stencil radius
+        radius = std::atoi(argv[3]);
+
+        if (radius < 0) {
+          throw "ERROR: Stencil radius must be nonnegative";
+        }
+
+        stencil_size = 4*radius+1;
+        sparsity = (4.*radius+1.)/size2;
+        nent = size2 * stencil_size;
+      }
+
+      // storage format and column indices of the matrix in the timed loop
+      const int opt = file.empty() ? 4 : 3;
+      format = (argc > opt)   ? std::string(argv[opt])   : std::string("csr");
+      index  = (argc > opt+1) ? std::string(argv[opt+1]) : std::string("64");
+      error  = prk::sparse::stored_matrix::check(format, index, size2);
+      // renumbering of the rows and columns before the conversion
+      order  = (argc > opt+2) ? std::string(argv[opt+2]) : std::string("none");
+      if (error.empty()) error = prk::sparse::check_order(order);
+      if (error.empty() && !file.empty() && order != "none" && order != "rcm") {
+        error = "a matrix file has no grid for the " + order + " ordering";
+      }
+      if (!error.empty()) {
+        error = "ERROR: " + error;
+        throw error.c_str();
+      }
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+#ifdef _OPENMP
+  const int num_threads = omp_get_max_threads();
+#else
+  const int num_threads = 1;
+#endif
+  std::cout << "Number of threads    = " << num_threads << std::endl;
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
+
+  //////////////////////////////////////////////////////////////////////
+  // Allocate space and perform the computation
+  //////////////////////////////////////////////////////////////////////
+
+  prk::vector<double> matrix;
+  prk::vector<size_t> colIndex;
+  prk::vector<size_t> rowPtr;
+  prk::vector<double> vector;
+  prk::vector<double> result;
+  size_t nrows(size2), ncols(size2);
+
+  // the matrix as read, for the reference multiplication
+  prk::sparse::csr input;
+
+  if (file.empty()) {
+    std::cout << "Matrix order         = " << size2 << std::endl;
+    std::cout << "Stencil diameter     = " << 2*radius+1 << std::endl;
+    std::cout << "Sparsity             = " << sparsity << std::endl;
+#if SCRAMBLE
+    std::cout << "Using scrambled indexing"  << std::endl;
+#else
+    std::cout << "Using canonical indexing"  << std::endl;
+#endif
+
+    matrix   = prk::vector<double>(nent, prk::uninitialized);
+    colIndex = prk::vector<size_t>(nent, prk::uninitialized);
+    rowPtr   = prk::vector<size_t>(size2+1, prk::uninitialized);
+    vector   = prk::vector<double>(size2, prk::uninitialized);
+    result   = prk::vector<double>(size2, prk::uninitialized);
+
+    // all loops over rows have the same static schedule, so every thread
+    // assembles, and hence first touches, the rows it multiplies
+    OMP_PARALLEL()
+    {
+      OMP_FOR( schedule(static) )
+      for (size_t row=0; row<size2; row++) {
+        rowPtr[row] = row*stencil_size;
+        prk::sparse::build_row(row, lsize, radius, prk::sparse::scrambled,
+                               &(colIndex[row*stencil_size]), &(matrix[row*stencil_size]));
+        vector[row] = 0.0;
+        result[row] = 0.0;
+      }
+    }
+    rowPtr[size2] = nent;
+  } else {
+    // every thread parses a part of the file, or copies a range of rows of a binary one
+    auto for_each = [](int n, auto f) {
+      OMP_PARALLEL()
+      {
+        OMP_FOR( schedule(static) )
+        for (int p=0; p<n; p++) f(p);
+      }
+    };
+    const double t0 = prk::wtime();
+    error = prk::sparse::load(file, input, num_threads, for_each);
+    const double load_time = prk::wtime() - t0;
+    if (error.empty()) error = prk::sparse::stored_matrix::check(format, index, input.ncols);
+    if (!error.empty()) {
+      std::cout << "ERROR: " << error << std::endl;
+      return 1;
+    }
+    nrows = input.nrows;
+    ncols = input.ncols;
+    nent  = input.nnz();
+    std::cout << "Matrix file          = " << file << std::endl;
+    std::cout << "Matrix rows          = " << nrows << std::endl;
+    std::cout << "Matrix columns       = " << ncols << std::endl;
+    std::cout << "Nonzeros             = " << nent << std::endl;
+    std::cout << "Sparsity             = " << static_cast<double>(nent)/nrows/ncols << std::endl;
+    std::cout << "Load time (s)        = " << load_time << std::endl;
+
+    // PRK_SPARSE_SAVE_CSR=1 saves a Matrix Market file in the binary format for faster loads
+    if (prk::bench::getenv_int("PRK_SPARSE_SAVE_CSR", 0) && !prk::sparse::is_binary(file)) {
+      const std::string binary = file.substr(0, file.rfind('.')) + ".csr";
+      error = prk::sparse::write_binary(binary, input);
+      std::cout << (error.empty() ? "Saved " + binary : "ERROR: " + error) << std::endl;
+    }
+
+    rowPtr   = input.rowptr;
+    colIndex = input.colIndex;
+    matrix   = input.values;
+    vector   = prk::vector<double>(ncols, 0.0);
+    result   = prk::vector<double>(nrows, 0.0);
+  }
+
+  // the matrix is reordered after timing the original order with the same storage;
+  // the ordering is sequential, the permutation of the rows parallel
+  const std::string isa = (format == "csr") ? std::string("none") : prk::sparse::simd_isa();
+  const int sigma = (format == "sell") ? prk::bench::getenv_int("PRK_SPARSE_SIGMA", 1) : 1;
+  prk::sparse::ordering perm;
+  double original_time(0), reorder_time(0);
+  if (order != "none") {
+    {
+      prk::sparse::stored_matrix A0(format, index, isa, sigma, nrows, ncols, rowPtr.data(), colIndex.data(), matrix.data());
+      prk::vector<double> x(ncols,0.0), y(nrows,0.0);
+      const size_t units = A0.units();
+      auto range = [units,num_threads](int t) { return prk::sparse::first_row(units, t, num_threads); };
+      double t0(0);
+      OMP_PARALLEL()
+      {
+        OMP_FOR( schedule(static) )
+        for (int t=0; t<num_threads; t++) {
+          A0.assign(range(t), range(t+1));
+        }
+        for (int iter=0; iter<=iterations; iter++) {
+          // the first multiplication is a warm-up
+          OMP_BARRIER
+          OMP_MASTER
+          if (iter==1) t0 = prk::wtime();
+          OMP_BARRIER
+          OMP_FOR( schedule(static) )
+          for (size_t col=0; col<ncols; col++) {
+              x[col] += (col+1.);
+          }
+          OMP_FOR( schedule(static) )
+          for (int t=0; t<num_threads; t++) {
+              A0.multiply(range(t), range(t+1), x.data(), y.data());
+          }
+        }
+      }
+      original_time = (iterations > 0) ? (prk::wtime() - t0) / iterations : 0.0;
+    }
+
+    const double t0 = prk::wtime();
+    perm = file.empty() ? prk::sparse::grid_order(order, lsize, prk::sparse::scrambled, rowPtr.data(), colIndex.data())
+                        : prk::sparse::rcm(nrows, ncols, rowPtr.data(), colIndex.data());
+    prk::vector<size_t> newPtr(nrows+1, prk::uninitialized);
+    prk::vector<size_t> newIndex(nent, prk::uninitialized);
+    prk::vector<double> newMatrix(nent, prk::uninitialized);
+    prk::sparse::permuted_rowptr(perm, rowPtr.data(), newPtr.data());
+    const auto newcol = prk::sparse::renumbering(perm);
+    OMP_PARALLEL()
+    {
+      OMP_FOR( schedule(static) )
+      for (int t=0; t<num_threads; t++) {
+        prk::sparse::permute_rows(prk::sparse::first_row(nrows, t, num_threads), prk::sparse::first_row(nrows, t+1, num_threads),
+                                  perm, newcol, rowPtr.data(), colIndex.data(), matrix.data(),
+                                  newPtr.data(), newIndex.data(), newMatrix.data());
+      }
+    }
+    reorder_time = prk::wtime() - t0;
+    rowPtr.swap(newPtr);
+    colIndex.swap(newIndex);
+    matrix.swap(newMatrix);
+  }
+
+  // the CSR arrays are converted to the storage of the timed loop
+  prk::sparse::stored_matrix A(format, index, isa, sigma, nrows, ncols, rowPtr.data(), colIndex.data(), matrix.data());
+
+  std::cout << "Storage format       = " << format << std::endl;
+  std::cout << "Column indices       = " << index << std::endl;
+  if (format != "csr") {
+    std::cout << "SIMD ISA             = " << isa << std::endl;
+    std::cout << "Chunk height         = " << A.chunk_height() << std::endl;
+    if (format == "sell") std::cout << "Sorting scope        = " << sigma << std::endl;
+    std::cout << "Stored entries       = " << A.stored() << " (" << 100.0*(A.stored()-nent)/nent << "% padding)" << std::endl;
+  }
+  std::cout << "Ordering             = " << order << std::endl;
+  std::cout << "Matrix footprint     = " << 1.0e-6*A.footprint() << " MB ("
+            << static_cast<double>(A.index_bytes())/A.stored() << " index bytes per entry)" << std::endl;
+
+  prk::bench::timer sparse_time(iterations);
+  prk::bench::record record("sparse", "openmp", sparse_time);
+  if (file.empty()) {
+    record.param("lsize", lsize).param("radius", radius);
+  } else {
+    record.param("matrix", file).param("nnz", nent);
+  }
+  record.threads(num_threads).param("alloc", prk::alloc::name())
+        .param("format", format).param("index", index).param("isa", isa).param("footprint", A.footprint()).param("order", order);
+  if (format == "sell") record.param("sigma", sigma);
+
+  // thread t converts and multiplies the t-th contiguous range of units
+  // (rows, or chunks of rows), which matches the static schedule of the rows
+  const size_t units = A.units();
+  auto range = [units,num_threads](int t) { return prk::sparse::first_row(units, t, num_threads); };
+
+  OMP_PARALLEL()
+  {
+    OMP_FOR( schedule(static) )
+    for (int t=0; t<num_threads; t++) {
+      A.assign(range(t), range(t+1));
+    }
+
+    while (true) {
+      OMP_BARRIER
+      OMP_MASTER
+      sparse_time.next();
+      OMP_BARRIER
+      if (!sparse_time.running()) break;
+
+      // row k of a reordered vector is row perm.cols[k] of the original
+      if (order == "none") {
+        OMP_FOR( schedule(static) )
+        for (size_t col=0; col<ncols; col++) {
+            vector[col] += (col+1.);
+        }
+      } else {
+        OMP_FOR( schedule(static) )
+        for (size_t col=0; col<ncols; col++) {
+            vector[col] += (perm.cols[col]+1.);
+        }
+      }
+
+      OMP_FOR( schedule(static) )
+      for (int t=0; t<num_threads; t++) {
+          A.multiply(range(t), range(t+1), vector.data(), result.data());
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Analyze and output results.
+  //////////////////////////////////////////////////////////////////////
+
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = sparse_time.applications() - 1;
+
+  double reference_sum = (0.5*nent) * (iterations+1.) * (iterations+2.);
+
+  double vector_sum(0);
+  OMP_PARALLEL_FOR_REDUCE( +:vector_sum )
+  for (size_t row=0; row<nrows; row++) {
+      vector_sum += result[row];
+  }
+
+  const double epsilon(1.e-8);
+
+  // a file is checked row by row against one serial multiplication by the
+  // sum of the vectors of all iterations, within the rounding error bound
+  size_t wrong(0);
+  if (!file.empty()) {
+    const double updates = 0.5 * (iterations+1.) * (iterations+2.);
+    prk::vector<double> x(ncols, [=](size_t col) { return (col+1.) * updates; });
+    prk::vector<double> y(nrows, prk::uninitialized), bound(nrows, prk::uninitialized);
+    prk::sparse::reference_multiply(input, x.data(), y.data(), bound.data());
+    reference_sum = 0.0;
+    for (size_t row=0; row<nrows; row++) {
+      const size_t r = (order == "none") ? row : perm.rows[row];
+      if (std::fabs(result[row]-y[r]) > epsilon * bound[r]) wrong++;
+      reference_sum += y[r];
+    }
+  }
+
+  if (wrong > 0 || (file.empty() && std::fabs(vector_sum-reference_sum) > epsilon)) {
+    if (wrong > 0) std::cout << "ERROR: " << wrong << " rows differ from the reference multiplication" << std::endl;
+    std::cout << "ERROR: Vector norm = " << vector_sum
+              << " Reference vector norm = " << reference_sum << std::endl;
+    return 1;
+  } else {
+    std::cout << "Solution validates" << std::endl;
+#ifdef VERBOSE
+    std::cout << "Reference sum = " << reference_sum
+              << ", vector sum = " << vector_sum << std::endl;
+#endif
+    double avgtime = sparse_time.mean();
+    std::cout << "Rate (MFlops/s): " << 1.0e-6 * (2.*nent)/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    // the values, the indices, and the vector and the result once
+    const auto traffic = prk::roofline::sparse(A.stored(), nrows, static_cast<double>(A.index_bytes())/A.stored());
+    std::cout << "Bandwidth (GB/s): " << 1.0e-9 * traffic.bytes/avgtime << std::endl;
+    if (order != "none") {
+      std::cout << "Reorder time (s): " << reorder_time << " Original avg time (s): " << original_time
+                << " Speedup: " << original_time/avgtime << std::endl;
+      // the number of multiplications that pay for the reordering
+      if (original_time > avgtime) {
+        std::cout << "Break-even iterations: " << std::ceil(reorder_time/(original_time-avgtime)) << std::endl;
+      } else {
+        std::cout << "Break-even iterations: never" << std::endl;
+      }
+      record.param("reorder_time", reorder_time).param("original_time", original_time);
+    }
+    std::cout << sparse_time << std::endl;
+    prk::roofline::report(traffic, avgtime);
+    record.validated("MFlops/s", 1.0e-6 * (2.*nent)/avgtime);
+  }
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+
+///
+/// Copyright (c) 2013, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+//////////////////////////////////////////////////////////////////////
+///
+/// NAME:    Stencil
+///
+/// PURPOSE: This program tests the efficiency with which a space-invariant,
+///          linear, symmetric filter (stencil) can be applied to a square
+///          grid or image.
+///
+/// USAGE:   The program takes as input the linear
+///          dimension of the grid, and the number of iterations on the grid
+///
+///                <progname> <iterations> <grid size>
+///
+///          The output consists of diagnostics to make sure the
+///          algorithm worked, and of timing statistics.
+///
+/// FUNCTIONS CALLED:
+///
+///          Other than standard C functions, the following functions are used in
+///          this program:
+///          wtime()
+///
+/// HISTORY: - Written by Rob Van der Wijngaart, February 2009.
+///          - RvdW: Removed unrolling pragmas for clarity;
+///            added constant to array "in" at end of each iteration to force
+///            refreshing of neighbor data in parallel versions; August 2013
+///            C++11-ification by Jeff Hammond, May 2017.
+///
+//////////////////////////////////////////////////////////////////////
+
+#include "prk_util.h"
+#include "prk_thread.h"
+#include "prk_sparse.h"
+
+int main(int argc, char* argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+  std::cout << "C++11/Threads Sparse matrix-vector multiplication" << std::endl;
+
+  //////////////////////////////////////////////////////////////////////
+  // Process and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations, lsize;
+  unsigned radius, stencil_size;
+  size_t size, size2, nent;
+  double sparsity;
+  try {
+      if (argc < 4) {
+        throw "Usage: <# iterations> <2log grid size> <stencil radius>]";
+      }
+
+      // number of times to run the algorithm
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      // linear grid dimension
+      lsize  = std::atoi(argv[2]);
+      if (lsize < 1) {
+        throw "ERROR: grid dimension must be positive";
+      }
+      //size_t lsize2 = 2*lsize;
+      size = 1L<<lsize;
+      size2 = size*size;
+
+      // stencil radius
+      radius = std::atoi(argv[3]);
+
+      if (radius < 0) {
+        throw "ERROR: Stencil radius must be nonnegative";
+      }
+
+      stencil_size = 4*radius+1;
+      sparsity = (4.*radius+1.)/size2;
+      nent = size2 * stencil_size;
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  prk::thread_pool pool;
+  const int num_threads = pool.size();
+
+  std::cout << "Number of threads    = " << num_threads << std::endl;
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
+  std::cout << "Matrix order         = " << size2 << std::endl;
+  std::cout << "Stencil diameter     = " << 2*radius+1 << std::endl;
+  std::cout << "Sparsity             = " << sparsity << std::endl;
+#if SCRAMBLE
+  std::cout << "Using scrambled indexing"  << std::endl;
+#else
+  std::cout << "Using canonical indexing"  << std::endl;
+#endif
+
+  //////////////////////////////////////////////////////////////////////
+  // Allocate space and perform the computation
+  //////////////////////////////////////////////////////////////////////
+
+  prk::vector<double> matrix(nent, prk::uninitialized);
+  prk::vector<size_t> colIndex(nent, prk::uninitialized);
+  prk::vector<double> vector(size2, prk::uninitialized);
+  prk::vector<double> result(size2, prk::uninitialized);
+
+  prk::bench::timer sparse_time(iterations);
+  prk::bench::record record("sparse", "thread", sparse_time);
+  record.param("lsize", lsize).param("radius", radius).threads(num_threads).param("pinned", (pool.pinned() ? "yes" : "no")).param("alloc", prk::alloc::name());
+
+  // the rows are cut into one contiguous part per worker, and worker p
+  // works on part p in every loop, so every worker assembles, and hence
+  // first touches, the rows it multiplies
+  auto part = [size2,num_threads](int p) {
+      return prk::sparse::first_row(size2, p, num_threads);
+  };
+
+  pool.for_each_worker([&](int p) {
+      for (size_t row=part(p); row<part(p+1); row++) {
+        prk::sparse::build_row(row, lsize, radius, prk::sparse::scrambled,
+                               &(colIndex[row*stencil_size]), &(matrix[row*stencil_size]));
+        vector[row] = 0.0;
+        result[row] = 0.0;
+      }
+  });
+
+  while (sparse_time.next()) {
+    pool.for_each_worker([&](int p) {
+        for (size_t row=part(p); row<part(p+1); row++) {
+            vector[row] += (row+1.);
+        }
+    });
+
+    pool.for_each_worker([&](int p) {
+        for (size_t row=part(p); row<part(p+1); row++) {
+            double temp(0);
+            for (size_t col=stencil_size*row; col<stencil_size*(row+1); col++) {
+                temp += matrix[col]*vector[colIndex[col]];
+            }
+            result[row] += temp;
+        }
+    });
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Analyze and output results.
+  //////////////////////////////////////////////////////////////////////
+
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = sparse_time.applications() - 1;
+
+  double reference_sum = (0.5*nent) * (iterations+1.) * (iterations+2.);
+
+  double vector_sum(0);
+  for (size_t row=0; row<size2; row++) {
+      vector_sum += result[row];
+  }
+
+  const double epsilon(1.e-8);
+
+  if (std::fabs(vector_sum-reference_sum) > epsilon) {
+    std::cout << "ERROR: Vector norm = " << vector_sum
+              << " Reference vector norm = " << reference_sum << std::endl;
+    return 1;
+  } else {
+    std::cout << "Solution validates" << std::endl;
+#ifdef VERBOSE
+    std::cout << "Reference sum = " << reference_sum
+              << ", vector sum = " << vector_sum << std::endl;
+#endif
+    double avgtime = sparse_time.mean();
+    std::cout << "Rate (MFlops/s): " << 1.0e-6 * (2.*nent)/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    std::cout << sparse_time << std::endl;
+    prk::roofline::report(prk::roofline::sparse(nent, size2, sizeof(size_t)), avgtime);
+    record.validated("MFlops/s", 1.0e-6 * (2.*nent)/avgtime);
+  }
+
+  return 0;
+}
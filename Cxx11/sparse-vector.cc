@@ -61,40 +61,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
-
-static inline size_t offset(size_t i, size_t j, size_t lsize)
-{
-    return (i+(j<<lsize));
-}
-
-/* Code below reverses bits in unsigned integer stored in a 64-bit word.
-   Bit reversal is with respect to the largest integer that is going to be
-   processed for the particular run of the code, to make sure the reversal
-   constitutes a true permutation. Hence, the final result needs to be shifted
-   to the right.
-   Example: if largest integer being processed is 0x000000ff = 255 =
-   0000...0011111111 (binary), then the unshifted reversal of 0x00000006 = 6 =
-   0000...0000000110 (binary) would be 011000000...0000 = 3*2^61, which is
-   outside the range of the original sequence 0-255. Setting shift_in_bits to
-   2log(256) = 8, the final result is shifted the the right by 64-8=56 bits,
-   so we get 000...0001100000 (binary) = 96, which is within the proper range */
-
-static inline uint64_t reverse(uint64_t x, int shift_in_bits)
-{
-  x = ((x >> 1)  & 0x5555555555555555) | ((x << 1)  & 0xaaaaaaaaaaaaaaaa);
-  x = ((x >> 2)  & 0x3333333333333333) | ((x << 2)  & 0xcccccccccccccccc);
-  x = ((x >> 4)  & 0x0f0f0f0f0f0f0f0f) | ((x << 4)  & 0xf0f0f0f0f0f0f0f0);
-  x = ((x >> 8)  & 0x00ff00ff00ff00ff) | ((x << 8)  & 0xff00ff00ff00ff00);
-  x = ((x >> 16) & 0x0000ffff0000ffff) | ((x << 16) & 0xffff0000ffff0000);
-  x = ((x >> 32) & 0x00000000ffffffff) | ((x << 32) & 0xffffffff00000000);
-  return ( x >> (8*sizeof(uint64_t)-shift_in_bits) );
-}
-
-#if SCRAMBLE
-  #define REVERSE(a,b)  reverse((a),(b))
-#else
-  #define REVERSE(a,b) (a)
-#endif
+#include "prk_sparse.h"
 
 int main(int argc, char* argv[])
 {
@@ -130,7 +97,7 @@ int main(int argc, char* argv[])
       size2 = size*size;
 
       // stencil radius
-      radius = std::atoi(argv[5]);
+      radius = std::atoi(argv[3]);
 
       if (radius < 0) {
         throw "ERROR: Stencil radius must be nonnegative";
@@ -164,30 +131,17 @@ int main(int argc, char* argv[])
   std::vector<double> vector(size2,0.0);
   std::vector<double> result(size2,0.0);
 
-  double sparse_time(0);
+  prk::bench::timer sparse_time(iterations);
+  prk::bench::record record("sparse", "vector", sparse_time);
+  record.param("lsize", lsize).param("radius", radius);
 
   {
     for (size_t row=0; row<size2; row++) {
-      size_t i = row % size;
-      size_t j = row / size;
-      size_t elm = row*stencil_size;
-      colIndex[elm] = REVERSE(offset(i,j,lsize),lsize2);
-      for (size_t r=1; r<=radius; r++, elm+=4) {
-        colIndex[elm+1] = REVERSE(offset((i+r)%size,j,lsize),lsize2);
-        colIndex[elm+2] = REVERSE(offset((i-r+size)%size,j,lsize),lsize2);
-        colIndex[elm+3] = REVERSE(offset(i,(j+r)%size,lsize),lsize2);
-        colIndex[elm+4] = REVERSE(offset(i,(j-r+size)%size,lsize),lsize2);
-      }
-      std::sort(&(colIndex[row*stencil_size]), &(colIndex[(row+1)*stencil_size]));
-      for (size_t elm=row*stencil_size; elm<(row+1)*stencil_size; elm++) {
-        matrix[elm] = 1.0/(colIndex[elm]+1.);
-      }
+      prk::sparse::build_row(row, lsize, radius, prk::sparse::scrambled,
+                             &(colIndex[row*stencil_size]), &(matrix[row*stencil_size]));
     }
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) sparse_time = prk::wtime();
-
+    while (sparse_time.next()) {
       for (size_t row=0; row<size2; row++) {
           vector[row] += (row+1.);
       }
@@ -201,13 +155,15 @@ int main(int argc, char* argv[])
       }
 
     }
-    sparse_time = prk::wtime() - sparse_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = sparse_time.applications() - 1;
+
   double reference_sum = (0.5*nent) * (iterations+1.) * (iterations+2.);
 
   double vector_sum(0);
@@ -227,9 +183,12 @@ int main(int argc, char* argv[])
     std::cout << "Reference sum = " << reference_sum
               << ", vector sum = " << vector_sum << std::endl;
 #endif
-    double avgtime = sparse_time/iterations;
+    double avgtime = sparse_time.mean();
     std::cout << "Rate (MFlops/s): " << 1.0e-6 * (2.*nent)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << sparse_time << std::endl;
+    prk::roofline::report(prk::roofline::sparse(nent, size2, sizeof(size_t)), avgtime);
+    record.validated("MFlops/s", 1.0e-6 * (2.*nent)/avgtime);
   }
 
   return 0;
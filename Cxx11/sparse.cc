@@ -61,40 +61,8 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
-
-static inline size_t offset(size_t i, size_t j, size_t lsize)
-{
-    return (i+(j<<lsize));
-}
-
-/* Code below reverses bits in unsigned integer stored in a 64-bit word.
-   Bit reversal is with respect to the largest integer that is going to be
-   processed for the particular run of the code, to make sure the reversal
-   constitutes a true permutation. Hence, the final result needs to be shifted
-   to the right.
-   Example: if largest integer being processed is 0x000000ff = 255 =
-   0000...0011111111 (binary), then the unshifted reversal of 0x00000006 = 6 =
-   0000...0000000110 (binary) would be 011000000...0000 = 3*2^61, which is
-   outside the range of the original sequence 0-255. Setting shift_in_bits to
-   2log(256) = 8, the final result is shifted the the right by 64-8=56 bits,
-   so we get 000...0001100000 (binary) = 96, which is within the proper range */
-
-static inline uint64_t reverse(uint64_t x, int shift_in_bits)
-{
-  x = ((x >> 1)  & 0x5555555555555555) | ((x << 1)  & 0xaaaaaaaaaaaaaaaa);
-  x = ((x >> 2)  & 0x3333333333333333) | ((x << 2)  & 0xcccccccccccccccc);
-  x = ((x >> 4)  & 0x0f0f0f0f0f0f0f0f) | ((x << 4)  & 0xf0f0f0f0f0f0f0f0);
-  x = ((x >> 8)  & 0x00ff00ff00ff00ff) | ((x << 8)  & 0xff00ff00ff00ff00);
-  x = ((x >> 16) & 0x0000ffff0000ffff) | ((x << 16) & 0xffff0000ffff0000);
-  x = ((x >> 32) & 0x00000000ffffffff) | ((x << 32) & 0xffffffff00000000);
-  return ( x >> (8*sizeof(uint64_t)-shift_in_bits) );
-}
-
-#if SCRAMBLE
-  #define REVERSE(a,b)  reverse((a),(b))
-#else
-  #define REVERSE(a,b) (a)
-#endif
+#include "prk_sparse.h"
+#include "prk_sparse_io.h"
 
 int main(int argc, char* argv[])
 {
@@ -105,13 +73,15 @@ int main(int argc, char* argv[])
   // Process and test input parameters
   //////////////////////////////////////////////////////////////////////
 
-  int iterations, lsize;
-  unsigned radius, stencil_size;
-  size_t size, size2, nent;
-  double sparsity;
+  int iterations, lsize(0);
+  unsigned radius(0), stencil_size(0);
+  size_t size(0), size2(0), nent(0);
+  double sparsity(0);
+  std::string file, format, index, order, error;
   try {
-      if (argc < 4) {
-        throw "Usage: <# iterations> <2log grid size> <stencil radius>]";
+      if (argc < 3) {
+        throw "Usage: <# iterations> <2log grid size> <stencil radius> [format: csr|sell|ell] [index: 64|32|delta] [order: none|rcm|morton|hilbert]\n"
+              "   or: <# iterations> <matrix file: .mtx|.csr> [format: csr|sell|ell] [index: 64|32|delta] [order: none|rcm]";
       }
 
       // number of times to run the algorithm
@@ -120,25 +90,53 @@ int main(int argc, char* argv[])
         throw "ERROR: iterations must be >= 1";
       }
 
-      // linear grid dimension
-      lsize  = std::atoi(argv[2]);
-      if (lsize < 1) {
-        throw "ERROR: grid dimension must be positive";
+      // a matrix file instead of the generated matrix
+      const std::string arg2(argv[2]);
+      if (arg2.find_first_not_of("0123456789") != std::string::npos) {
+        file = arg2;
       }
-      //size_t lsize2 = 2*lsize;
-      size = 1L<<lsize;
-      size2 = size*size;
 
-      // stencil radius
-      radius = std::atoi(argv[5]);
+      if (file.empty()) {
+        if (argc < 4) {
+          throw "ERROR: the stencil radius is missing";
+        }
+
+        // linear grid dimension
+        lsize  = std::atoi(argv[2]);
+        if (lsize < 1) {
+          throw "ERROR: grid dimension must be positive";
+        }
+        //size_t lsize2 = 2*lsize;
+        size = 1L<<lsize;
+        size2 = size*size;
+
+        // stencil radius
+        radius = std::atoi(argv[3]);
 
-      if (radius < 0) {
-        throw "ERROR: Stencil radius must be nonnegative";
+        if (radius < 0) {
+          throw "ERROR: Stencil radius must be nonnegative";
+        }
+
+        stencil_size = 4*radius+1;
+        sparsity = (4.*radius+1.)/size2;
+        nent = size2 * stencil_size;
       }
 
-      stencil_size = 4*radius+1;
-      sparsity = (4.*radius+1.)/size2;
-      nent = size2 * stencil_size;
+      // storage format and column indices of the matrix in the timed loop
+      const int opt = file.empty() ? 4 : 3;
+      format = (argc > opt)   ? std::string(argv[opt])   : std::string("csr");
+      index  = (argc > opt+1) ? std::string(argv[opt+1]) : std::string("64");
+      error  = prk::sparse::stored_matrix::check(format, index, size2);
+      // renumbering of the rows and columns before the conversion
+      order  = (argc > opt+2) ? std::string(argv[opt+2]) : std::string("none");
+      if (error.empty()) error = prk::sparse::check_order(order);
+      if (error.empty() && !file.empty() && order != "none" && order != "rcm") {
+        error = "a matrix file has no grid for the " + order + " ordering";
+      }
+      if (!error.empty()) {
+        error = "ERROR: " + error;
+        throw error.c_str();
+      }
   }
   catch (const char * e) {
     std::cout << e << std::endl;
@@ -146,78 +144,187 @@ int main(int argc, char* argv[])
   }
 
   std::cout << "Number of iterations = " << iterations << std::endl;
-  std::cout << "Matrix order         = " << size2 << std::endl;
-  std::cout << "Stencil diameter     = " << 2*radius+1 << std::endl;
-  std::cout << "Sparsity             = " << sparsity << std::endl;
-#if SCRAMBLE
-  std::cout << "Using scrambled indexing"  << std::endl;
-#else
-  std::cout << "Using canonical indexing"  << std::endl;
-#endif
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  prk::vector<double> matrix(nent,0.0);
-  prk::vector<size_t> colIndex(nent,0);
-  prk::vector<double> vector(size2,0.0);
-  prk::vector<double> result(size2,0.0);
+  prk::vector<double> matrix;
+  prk::vector<size_t> colIndex;
+  prk::vector<size_t> rowPtr;
+  size_t nrows(size2), ncols(size2);
 
-  double sparse_time(0);
+  // the matrix as read, for the reference multiplication
+  prk::sparse::csr input;
+
+  if (file.empty()) {
+    std::cout << "Matrix order         = " << size2 << std::endl;
+    std::cout << "Stencil diameter     = " << 2*radius+1 << std::endl;
+    std::cout << "Sparsity             = " << sparsity << std::endl;
+#if SCRAMBLE
+    std::cout << "Using scrambled indexing"  << std::endl;
+#else
+    std::cout << "Using canonical indexing"  << std::endl;
+#endif
+
+    matrix   = prk::vector<double>(nent, prk::uninitialized);
+    colIndex = prk::vector<size_t>(nent, prk::uninitialized);
+    rowPtr   = prk::vector<size_t>(size2+1, prk::uninitialized);
 
-  {
     for (size_t row=0; row<size2; row++) {
-      size_t i = row % size;
-      size_t j = row / size;
-      size_t elm = row*stencil_size;
-      colIndex[elm] = REVERSE(offset(i,j,lsize),lsize2);
-      for (size_t r=1; r<=radius; r++, elm+=4) {
-        colIndex[elm+1] = REVERSE(offset((i+r)%size,j,lsize),lsize2);
-        colIndex[elm+2] = REVERSE(offset((i-r+size)%size,j,lsize),lsize2);
-        colIndex[elm+3] = REVERSE(offset(i,(j+r)%size,lsize),lsize2);
-        colIndex[elm+4] = REVERSE(offset(i,(j-r+size)%size,lsize),lsize2);
-      }
-      std::sort(&(colIndex[row*stencil_size]), &(colIndex[(row+1)*stencil_size]));
-      for (size_t elm=row*stencil_size; elm<(row+1)*stencil_size; elm++) {
-        matrix[elm] = 1.0/(colIndex[elm]+1.);
-      }
+      rowPtr[row] = row*stencil_size;
+      prk::sparse::build_row(row, lsize, radius, prk::sparse::scrambled,
+                             &(colIndex[row*stencil_size]), &(matrix[row*stencil_size]));
+    }
+    rowPtr[size2] = nent;
+  } else {
+    const double t0 = prk::wtime();
+    error = prk::sparse::load(file, input, 1, [](int n, auto f) { for (int p=0; p<n; p++) f(p); });
+    const double load_time = prk::wtime() - t0;
+    if (error.empty()) error = prk::sparse::stored_matrix::check(format, index, input.ncols);
+    if (!error.empty()) {
+      std::cout << "ERROR: " << error << std::endl;
+      return 1;
     }
+    nrows = input.nrows;
+    ncols = input.ncols;
+    nent  = input.nnz();
+    std::cout << "Matrix file          = " << file << std::endl;
+    std::cout << "Matrix rows          = " << nrows << std::endl;
+    std::cout << "Matrix columns       = " << ncols << std::endl;
+    std::cout << "Nonzeros             = " << nent << std::endl;
+    std::cout << "Sparsity             = " << static_cast<double>(nent)/nrows/ncols << std::endl;
+    std::cout << "Load time (s)        = " << load_time << std::endl;
 
-    for (auto iter = 0; iter<=iterations; iter++) {
+    // PRK_SPARSE_SAVE_CSR=1 saves a Matrix Market file in the binary format for faster loads
+    if (prk::bench::getenv_int("PRK_SPARSE_SAVE_CSR", 0) && !prk::sparse::is_binary(file)) {
+      const std::string binary = file.substr(0, file.rfind('.')) + ".csr";
+      error = prk::sparse::write_binary(binary, input);
+      std::cout << (error.empty() ? "Saved " + binary : "ERROR: " + error) << std::endl;
+    }
 
-      if (iter==1) sparse_time = prk::wtime();
+    rowPtr   = input.rowptr;
+    colIndex = input.colIndex;
+    matrix   = input.values;
+  }
 
-      for (size_t row=0; row<size2; row++) {
-          vector[row] += (row+1.);
-      }
+  prk::vector<double> vector(ncols,0.0);
+  prk::vector<double> result(nrows,0.0);
 
-      for (size_t row=0; row<size2; row++) {
-          double temp(0);
-          for (size_t col=stencil_size*row; col<stencil_size*(row+1); col++) {
-              temp += matrix[col]*vector[colIndex[col]];
-          }
-          result[row] += temp;
+  // the matrix is reordered after timing the original order with the same storage
+  const std::string isa = (format == "csr") ? std::string("none") : prk::sparse::simd_isa();
+  const int sigma = (format == "sell") ? prk::bench::getenv_int("PRK_SPARSE_SIGMA", 1) : 1;
+  prk::sparse::ordering perm;
+  double original_time(0), reorder_time(0);
+  if (order != "none") {
+    {
+      prk::sparse::stored_matrix A0(format, index, isa, sigma, nrows, ncols, rowPtr.data(), colIndex.data(), matrix.data());
+      A0.assign(0, A0.units());
+      prk::vector<double> x(ncols,0.0), y(nrows,0.0);
+      A0.multiply(0, A0.units(), x.data(), y.data());
+      const double t0 = prk::wtime();
+      for (int iter=0; iter<iterations; iter++) {
+        for (size_t col=0; col<ncols; col++) {
+            x[col] += (col+1.);
+        }
+        A0.multiply(0, A0.units(), x.data(), y.data());
       }
+      original_time = (prk::wtime() - t0) / iterations;
+    }
+
+    const double t0 = prk::wtime();
+    perm = file.empty() ? prk::sparse::grid_order(order, lsize, prk::sparse::scrambled, rowPtr.data(), colIndex.data())
+                        : prk::sparse::rcm(nrows, ncols, rowPtr.data(), colIndex.data());
+    prk::vector<size_t> newPtr(nrows+1, prk::uninitialized);
+    prk::vector<size_t> newIndex(nent, prk::uninitialized);
+    prk::vector<double> newMatrix(nent, prk::uninitialized);
+    prk::sparse::permuted_rowptr(perm, rowPtr.data(), newPtr.data());
+    const auto newcol = prk::sparse::renumbering(perm);
+    prk::sparse::permute_rows(0, nrows, perm, newcol, rowPtr.data(), colIndex.data(), matrix.data(),
+                              newPtr.data(), newIndex.data(), newMatrix.data());
+    reorder_time = prk::wtime() - t0;
+    rowPtr.swap(newPtr);
+    colIndex.swap(newIndex);
+    matrix.swap(newMatrix);
+  }
+
+  // the CSR arrays are converted to the storage of the timed loop
+  prk::sparse::stored_matrix A(format, index, isa, sigma, nrows, ncols, rowPtr.data(), colIndex.data(), matrix.data());
+  A.assign(0, A.units());
+
+  std::cout << "Storage format       = " << format << std::endl;
+  std::cout << "Column indices       = " << index << std::endl;
+  if (format != "csr") {
+    std::cout << "SIMD ISA             = " << isa << std::endl;
+    std::cout << "Chunk height         = " << A.chunk_height() << std::endl;
+    if (format == "sell") std::cout << "Sorting scope        = " << sigma << std::endl;
+    std::cout << "Stored entries       = " << A.stored() << " (" << 100.0*(A.stored()-nent)/nent << "% padding)" << std::endl;
+  }
+  std::cout << "Ordering             = " << order << std::endl;
+  std::cout << "Matrix footprint     = " << 1.0e-6*A.footprint() << " MB ("
+            << static_cast<double>(A.index_bytes())/A.stored() << " index bytes per entry)" << std::endl;
 
+  prk::bench::timer sparse_time(iterations);
+  prk::bench::record record("sparse", "seq", sparse_time);
+  if (file.empty()) {
+    record.param("lsize", lsize).param("radius", radius);
+  } else {
+    record.param("matrix", file).param("nnz", nent);
+  }
+  record.param("alloc", prk::alloc::name())
+        .param("format", format).param("index", index).param("isa", isa).param("footprint", A.footprint()).param("order", order);
+  if (format == "sell") record.param("sigma", sigma);
+
+  while (sparse_time.next()) {
+    // row k of a reordered vector is row perm.cols[k] of the original
+    if (order == "none") {
+      for (size_t col=0; col<ncols; col++) {
+          vector[col] += (col+1.);
+      }
+    } else {
+      for (size_t col=0; col<ncols; col++) {
+          vector[col] += (perm.cols[col]+1.);
+      }
     }
-    sparse_time = prk::wtime() - sparse_time;
+
+    A.multiply(0, A.units(), vector.data(), result.data());
   }
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = sparse_time.applications() - 1;
+
   double reference_sum = (0.5*nent) * (iterations+1.) * (iterations+2.);
 
   double vector_sum(0);
-  for (size_t row=0; row<size2; row++) {
+  for (size_t row=0; row<nrows; row++) {
       vector_sum += result[row];
   }
 
   const double epsilon(1.e-8);
 
-  if (std::fabs(vector_sum-reference_sum) > epsilon) {
+  // a file is checked row by row against one serial multiplication by the
+  // sum of the vectors of all iterations, within the rounding error bound
+  size_t wrong(0);
+  if (!file.empty()) {
+    const double updates = 0.5 * (iterations+1.) * (iterations+2.);
+    prk::vector<double> x(ncols, [=](size_t col) { return (col+1.) * updates; });
+    prk::vector<double> y(nrows, prk::uninitialized), bound(nrows, prk::uninitialized);
+    prk::sparse::reference_multiply(input, x.data(), y.data(), bound.data());
+    reference_sum = 0.0;
+    for (size_t row=0; row<nrows; row++) {
+      const size_t r = (order == "none") ? row : perm.rows[row];
+      if (std::fabs(result[row]-y[r]) > epsilon * bound[r]) wrong++;
+      reference_sum += y[r];
+    }
+  }
+
+  if (wrong > 0 || (file.empty() && std::fabs(vector_sum-reference_sum) > epsilon)) {
+    if (wrong > 0) std::cout << "ERROR: " << wrong << " rows differ from the reference multiplication" << std::endl;
     std::cout << "ERROR: Vector norm = " << vector_sum
               << " Reference vector norm = " << reference_sum << std::endl;
     return 1;
@@ -227,9 +334,26 @@ int main(int argc, char* argv[])
     std::cout << "Reference sum = " << reference_sum
               << ", vector sum = " << vector_sum << std::endl;
 #endif
-    double avgtime = sparse_time/iterations;
+    double avgtime = sparse_time.mean();
     std::cout << "Rate (MFlops/s): " << 1.0e-6 * (2.*nent)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    // the values, the indices, and the vector and the result once
+    const auto traffic = prk::roofline::sparse(A.stored(), nrows, static_cast<double>(A.index_bytes())/A.stored());
+    std::cout << "Bandwidth (GB/s): " << 1.0e-9 * traffic.bytes/avgtime << std::endl;
+    if (order != "none") {
+      std::cout << "Reorder time (s): " << reorder_time << " Original avg time (s): " << original_time
+                << " Speedup: " << original_time/avgtime << std::endl;
+      // the number of multiplications that pay for the reordering
+      if (original_time > avgtime) {
+        std::cout << "Break-even iterations: " << std::ceil(reorder_time/(original_time-avgtime)) << std::endl;
+      } else {
+        std::cout << "Break-even iterations: never" << std::endl;
+      }
+      record.param("reorder_time", reorder_time).param("original_time", original_time);
+    }
+    std::cout << sparse_time << std::endl;
+    prk::roofline::report(traffic, avgtime);
+    record.validated("MFlops/s", 1.0e-6 * (2.*nent)/avgtime);
   }
 
   return 0;
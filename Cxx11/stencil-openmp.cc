@@ -61,122 +61,70 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
-#ifdef _OPENMP
-#include "stencil_openmp.hpp"
-#else
-#include "stencil_seq.hpp"
-#endif
+#include "prk_stencil.h"
 
-void nothing(const int n, const int t, const double * RESTRICT in, double * RESTRICT out)
+template <typename TI, typename TO>
+void nothing(const int n, const int t, const TI * RESTRICT in, TO * RESTRICT out)
 {
-    std::cout << "You are trying to use a stencil that does not exist.\n";
-    std::cout << "Please generate the new stencil using the code generator\n";
-    std::cout << "and add it to the case-switch in the driver." << std::endl;
+    std::cout << "You are trying to use a stencil radius larger than PRK_STENCIL_MAX_RADIUS.\n";
+    std::cout << "Please rebuild with -DPRK_STENCIL_MAX_RADIUS=<radius>." << std::endl;
     // n will never be zero - this is to silence compiler warnings.
     if (n==0 || t==0) std::cout << in << out << std::endl;
     std::abort();
 }
 
-int main(int argc, char* argv[])
+template <typename TI, typename TO>
+void nothing_steps(const int n, const int t, const int steps,
+                   const TI * RESTRICT in, TI * RESTRICT in_next, TO * RESTRICT out)
 {
-  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
-#ifdef _OPENMP
-  std::cout << "C++11/OpenMP Stencil execution on 2D grid" << std::endl;
-#else
-  std::cout << "C++11 Stencil execution on 2D grid" << std::endl;
-#endif
-
-  //////////////////////////////////////////////////////////////////////
-  // Process and test input parameters
-  //////////////////////////////////////////////////////////////////////
-
-  int iterations, n, radius, tile_size;
-  bool star = true;
-  try {
-      if (argc < 3) {
-        throw "Usage: <# iterations> <array dimension> [<tile_size> <star/grid> <radius>]";
-      }
-
-      // number of times to run the algorithm
-      iterations  = std::atoi(argv[1]);
-      if (iterations < 1) {
-        throw "ERROR: iterations must be >= 1";
-      }
-
-      // linear grid dimension
-      n  = std::atoi(argv[2]);
-      if (n < 1) {
-        throw "ERROR: grid dimension must be positive";
-      } else if (n > std::floor(std::sqrt(INT_MAX))) {
-        throw "ERROR: grid dimension too large - overflow risk";
-      }
-
-      // default tile size for tiling of local transpose
-      tile_size = 32;
-      if (argc > 3) {
-          tile_size = std::atoi(argv[3]);
-          if (tile_size <= 0) tile_size = n;
-          if (tile_size > n) tile_size = n;
-      }
-
-      // stencil pattern
-      if (argc > 4) {
-          auto stencil = std::string(argv[4]);
-          auto grid = std::string("grid");
-          star = (stencil == grid) ? false : true;
-      }
+    if (steps==0) std::cout << in_next << std::endl;
+    nothing(n, t, in, out);
+}
 
-      // stencil radius
-      radius = 2;
-      if (argc > 5) {
-          radius = std::atoi(argv[5]);
-      }
+template <typename TI, typename TO>
+void nothing_fused(const int n, const int t, TI * RESTRICT in, TO * RESTRICT out)
+{
+    nothing(n, t, in, out);
+}
 
-      if ( (radius < 1) || (2*radius+1 > n) ) {
-        throw "ERROR: Stencil radius negative or too large";
-      }
-  }
-  catch (const char * e) {
-    std::cout << e << std::endl;
-    return 1;
-  }
+template <typename TI, typename TO>
+int run(int iterations, int n, int radius, int tile_size, int time_block, bool star)
+{
+  // PRK_STENCIL_FUSED=1 adds the constant to in during the stencil sweep
+  const bool fused = (time_block == 1) && prk::stencil_fused_enabled();
 
 #ifdef _OPENMP
   std::cout << "Number of threads    = " << omp_get_max_threads() << std::endl;
 #endif
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Precision            = " << prk::precision::name<TI,TO>() << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Grid size            = " << n << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
   std::cout << "Type of stencil      = " << (star ? "star" : "grid") << std::endl;
   std::cout << "Radius of stencil    = " << radius << std::endl;
+  std::cout << "Fused update         = " << (fused ? "yes" : "no") << std::endl;
+  std::cout << "Time block           = " << time_block << std::endl;
 
-  auto stencil = nothing;
-  if (star) {
-      switch (radius) {
-          case 1: stencil = star1; break;
-          case 2: stencil = star2; break;
-          case 3: stencil = star3; break;
-          case 4: stencil = star4; break;
-          case 5: stencil = star5; break;
-      }
-  } else {
-      switch (radius) {
-          case 1: stencil = grid1; break;
-          case 2: stencil = grid2; break;
-          case 3: stencil = grid3; break;
-          case 4: stencil = grid4; break;
-          case 5: stencil = grid5; break;
-      }
-  }
+  auto stencil = prk::make_stencil<prk::stencil_backend::openmp>(star, radius, nothing<TI,TO>);
+  auto stencil_fused = prk::make_stencil_fused<prk::stencil_backend::openmp>(star, radius, nothing_fused<TI,TO>);
+  auto stencil_steps = prk::make_stencil_steps<prk::stencil_backend::openmp>(star, radius, nothing_steps<TI,TO>);
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto stencil_time = 0.0;
+  prk::bench::timer stencil_time(iterations);
+  prk::bench::record record("stencil", "openmp", stencil_time);
+  record.param("n", n).param("tile_size", tile_size).param("stencil", (star ? "star" : "grid")).param("radius", radius).param("fused", (fused ? "yes" : "no")).param("time_block", time_block).param("alloc", prk::alloc::name()).param("precision", prk::precision::name<TI,TO>());
+  prk::counters::region stencil_counters("stencil");
+
+  TI * RESTRICT in  = prk::malloc<TI>(n*n);
+  TO * RESTRICT out = prk::malloc<TO>(n*n);
+  // temporal blocking reads in and writes in_next, then swaps them
+  TI * RESTRICT in_next = (time_block > 1) ? prk::malloc<TI>(n*n) : nullptr;
 
-  double * RESTRICT in  = new double[n*n];
-  double * RESTRICT out = new double[n*n];
+  int steps = 0;
 
   OMP_PARALLEL()
   {
@@ -184,47 +132,72 @@ int main(int argc, char* argv[])
     for (auto it=0; it<n; it+=tile_size) {
       for (auto jt=0; jt<n; jt+=tile_size) {
         for (auto i=it; i<std::min(n,it+tile_size); i++) {
+          const auto jmax = std::min(n,jt+tile_size);
           PRAGMA_SIMD
-          for (auto j=jt; j<std::min(n,jt+tile_size); j++) {
-            in[i*n+j] = static_cast<double>(i+j);
-            out[i*n+j] = 0.0;
+          for (auto j=jt; j<jmax; j++) {
+            in[i*n+j] = static_cast<TI>(i+j);
+            out[i*n+j] = TO(0);
           }
         }
       }
     }
 
-    for (auto iter = 0; iter<=iterations; iter++) {
+    if (time_block > 1) {
+      while (true) {
+        OMP_BARRIER
+        OMP_MASTER
+        steps = stencil_time.next_block(time_block);
+        OMP_BARRIER
+        if (steps == 0) break;
+        if (stencil_time.timed()) stencil_counters.start();
 
-      if (iter==1) {
-          OMP_BARRIER
-          OMP_MASTER
-          stencil_time = prk::wtime();
+        // Apply the stencil operator and add the constant for several iterations per tile
+        stencil_steps(n, tile_size, steps, in, in_next, out);
+        OMP_MASTER
+        std::swap(in, in_next);
+        stencil_counters.stop();
       }
+    } else {
+      while (true) {
+        OMP_BARRIER
+        OMP_MASTER
+        stencil_time.next();
+        OMP_BARRIER
+        if (!stencil_time.running()) break;
+        if (stencil_time.timed()) stencil_counters.start();
 
-      // Apply the stencil operator
-      stencil(n, tile_size, in, out);
-      // Add constant to solution to force refresh of neighbor data, if any
-      OMP_FOR( collapse(2) )
-      for (auto it=0; it<n; it+=tile_size) {
-        for (auto jt=0; jt<n; jt+=tile_size) {
-          for (auto i=it; i<std::min(n,it+tile_size); i++) {
-            PRAGMA_SIMD
-            for (auto j=jt; j<std::min(n,jt+tile_size); j++) {
-              in[i*n+j] += 1.0;
+        if (fused) {
+          // Apply the stencil operator and add the constant in the same sweep
+          stencil_fused(n, tile_size, in, out);
+        } else {
+          // Apply the stencil operator
+          stencil(n, tile_size, in, out);
+          // Add constant to solution to force refresh of neighbor data, if any
+          OMP_FOR( collapse(2) )
+          for (auto it=0; it<n; it+=tile_size) {
+            for (auto jt=0; jt<n; jt+=tile_size) {
+              for (auto i=it; i<std::min(n,it+tile_size); i++) {
+                const auto jmax = std::min(n,jt+tile_size);
+                PRAGMA_SIMD
+                for (auto j=jt; j<jmax; j++) {
+                  in[i*n+j] += TI(1);
+                }
+              }
             }
           }
         }
+        stencil_counters.stop();
       }
     }
-    OMP_BARRIER
-    OMP_MASTER
-    stencil_time = prk::wtime() - stencil_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = stencil_time.applications() - 1;
+
   // interior of grid with respect to stencil
   size_t active_points = static_cast<size_t>(n-2*radius)*static_cast<size_t>(n-2*radius);
   // compute L1 norm in parallel
@@ -238,7 +211,8 @@ int main(int argc, char* argv[])
   norm /= active_points;
 
   // verify correctness
-  const double epsilon = 1.0e-8;
+  // out sums iterations+1 stencils of values up to 2n
+  const double epsilon = prk::precision::epsilon<TO>(1.0e-8, 2.*n*(iterations+1.));
   double reference_norm = 2.*(iterations+1.);
   if (std::fabs(norm-reference_norm) > epsilon) {
     std::cout << "ERROR: L1 norm = " << norm
@@ -252,10 +226,102 @@ int main(int argc, char* argv[])
 #endif
     const int stencil_size = star ? 4*radius+1 : (2*radius+1)*(2*radius+1);
     size_t flops = (2L*(size_t)stencil_size+1L) * active_points;
-    auto avgtime = stencil_time/iterations;
+    auto avgtime = stencil_time.mean();
     std::cout << "Rate (MFlops/s): " << 1.0e-6 * static_cast<double>(flops)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << stencil_time << std::endl;
+    // in moves 3 words (2 when fused) and out 2 words per point
+    const double word = (fused ? (2.0*sizeof(TI) + 2.0*sizeof(TO)) / 4.0
+                               : (3.0*sizeof(TI) + 2.0*sizeof(TO)) / 5.0);
+    prk::roofline::report(fused ? prk::roofline::stencil_fused(n, active_points, stencil_size, word)
+                                : prk::roofline::stencil(n, active_points, stencil_size, word), avgtime);
+    std::cout << stencil_counters;
+    record.validated("MFlops/s", 1.0e-6 * static_cast<double>(flops)/avgtime);
   }
 
   return 0;
 }
+
+int main(int argc, char* argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+#ifdef _OPENMP
+  std::cout << "C++11/OpenMP Stencil execution on 2D grid" << std::endl;
+#else
+  std::cout << "C++11 Stencil execution on 2D grid" << std::endl;
+#endif
+
+  //////////////////////////////////////////////////////////////////////
+  // Process and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations, n, radius, tile_size, time_block;
+  bool star = true;
+  prk::precision::kind precision;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <array dimension> [<tile_size> <star/grid> <radius> <time_block>]";
+      }
+
+      // number of times to run the algorithm
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      // linear grid dimension
+      n  = std::atoi(argv[2]);
+      if (n < 1) {
+        throw "ERROR: grid dimension must be positive";
+      } else if (n > std::floor(std::sqrt(INT_MAX))) {
+        throw "ERROR: grid dimension too large - overflow risk";
+      }
+
+      // default tile size for tiling of local transpose
+      tile_size = 32;
+      if (argc > 3) {
+          tile_size = std::atoi(argv[3]);
+          if (tile_size <= 0) tile_size = n;
+          if (tile_size > n) tile_size = n;
+      }
+
+      // stencil pattern
+      if (argc > 4) {
+          auto stencil = std::string(argv[4]);
+          auto grid = std::string("grid");
+          star = (stencil == grid) ? false : true;
+      }
+
+      // stencil radius
+      radius = 2;
+      if (argc > 5) {
+          radius = std::atoi(argv[5]);
+      }
+
+      if ( (radius < 1) || (2*radius+1 > n) ) {
+        throw "ERROR: Stencil radius negative or too large";
+      }
+
+      // number of iterations advanced per cache-resident tile (1 = no temporal blocking)
+      time_block = 1;
+      if (argc > 6) {
+          time_block = std::atoi(argv[6]);
+          if (time_block < 1) {
+            throw "ERROR: time block must be positive";
+          }
+      }
+
+      // PRK_PRECISION=double|float|mixed
+      precision = prk::precision::get();
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  switch (precision) {
+    case prk::precision::kind::fp32:  return run<float,float>(iterations, n, radius, tile_size, time_block, star);
+    case prk::precision::kind::mixed: return run<float,double>(iterations, n, radius, tile_size, time_block, star);
+    default:                          return run<double,double>(iterations, n, radius, tile_size, time_block, star);
+  }
+}
@@ -163,7 +163,9 @@ int main(int argc, char* argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto stencil_time = 0.0;
+  prk::bench::timer stencil_time(iterations);
+  prk::bench::record record("stencil", "raja", stencil_time);
+  record.param("n", n).param("tile_size", tile_size).param("stencil", (star ? "star" : "grid")).param("radius", radius);
 
   double * RESTRICT imem = new double[n*n];
   double * RESTRICT omem = new double[n*n];
@@ -186,9 +188,7 @@ int main(int argc, char* argv[])
       out(i,j) = 0.0;
   });
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) stencil_time = prk::wtime();
+  while (stencil_time.next()) {
     // Apply the stencil operator
     stencil(n, tile_size, in, out);
     // Add constant to solution to force refresh of neighbor data, if any
@@ -197,12 +197,13 @@ int main(int argc, char* argv[])
     });
   }
 
-  stencil_time = prk::wtime() - stencil_time;
-
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = stencil_time.applications() - 1;
+
   // interior of grid with respect to stencil
   size_t active_points = static_cast<size_t>(n-2*radius)*static_cast<size_t>(n-2*radius);
 
@@ -231,9 +232,12 @@ int main(int argc, char* argv[])
 #endif
     const int stencil_size = star ? 4*radius+1 : (2*radius+1)*(2*radius+1);
     size_t flops = (2L*(size_t)stencil_size+1L) * active_points;
-    auto avgtime = stencil_time/iterations;
+    auto avgtime = stencil_time.mean();
     std::cout << "Rate (MFlops/s): " << 1.0e-6 * static_cast<double>(flops)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << stencil_time << std::endl;
+    prk::roofline::report(prk::roofline::stencil(n, active_points, stencil_size), avgtime);
+    record.validated("MFlops/s", 1.0e-6 * static_cast<double>(flops)/avgtime);
   }
 
   return 0;
@@ -63,20 +63,12 @@
 #include "prk_util.h"
 #include "prk_pstl.h"
 // See ParallelSTL.md for important information.
-#if defined(USE_PSTL) && ( defined(USE_INTEL_PSTL) || ( defined(__GNUC__) && (__GNUC__ >= 9) ) )
-#include "stencil_pstl.hpp"
-#elif defined(USE_PSTL) && defined(__GNUC__) && defined(__GNUC_MINOR__) \
-                        && ( (__GNUC__ == 8) || (__GNUC__ == 7) && (__GNUC_MINOR__ >= 2) )
-#include "stencil_pgnu.hpp"
-#else
-#include "stencil_stl.hpp"
-#endif
+#include "prk_stencil.h"
 
 void nothing(const int n, const int t, std::vector<double> & in, std::vector<double> & out)
 {
-    std::cout << "You are trying to use a stencil that does not exist.\n";
-    std::cout << "Please generate the new stencil using the code generator\n";
-    std::cout << "and add it to the case-switch in the driver." << std::endl;
+    std::cout << "You are trying to use a stencil radius larger than PRK_STENCIL_MAX_RADIUS.\n";
+    std::cout << "Please rebuild with -DPRK_STENCIL_MAX_RADIUS=<radius>." << std::endl;
     // n will never be zero - this is to silence compiler warnings.
     if (n==0 || t==0) std::cout << in.size() << out.size() << std::endl;
     std::abort();
@@ -146,36 +138,26 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // PRK_STENCIL_FUSED=1 adds the constant to in during the stencil sweep
+  const bool fused = prk::stencil_fused_enabled();
+
   std::cout << "Number of iterations = " << iterations << std::endl;
   std::cout << "Grid size            = " << n << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
   std::cout << "Type of stencil      = " << (star ? "star" : "grid") << std::endl;
   std::cout << "Radius of stencil    = " << radius << std::endl;
+  std::cout << "Fused update         = " << (fused ? "yes" : "no") << std::endl;
 
-  auto stencil = nothing;
-  if (star) {
-      switch (radius) {
-          case 1: stencil = star1; break;
-          case 2: stencil = star2; break;
-          case 3: stencil = star3; break;
-          case 4: stencil = star4; break;
-          case 5: stencil = star5; break;
-      }
-  } else {
-      switch (radius) {
-          case 1: stencil = grid1; break;
-          case 2: stencil = grid2; break;
-          case 3: stencil = grid3; break;
-          case 4: stencil = grid4; break;
-          case 5: stencil = grid5; break;
-      }
-  }
+  auto stencil = prk::make_stencil<prk::stencil_backend::pstl>(star, radius, nothing);
+  auto stencil_fused = prk::make_stencil_fused<prk::stencil_backend::pstl>(star, radius, nothing);
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  double stencil_time(0);
+  prk::bench::timer stencil_time(iterations);
+  prk::bench::record record("stencil", "pstl", stencil_time);
+  record.param("n", n).param("tile_size", tile_size).param("stencil", (star ? "star" : "grid")).param("radius", radius).param("fused", (fused ? "yes" : "no"));
 
   std::vector<double> in(n*n);
   std::vector<double> out(n*n);
@@ -198,11 +180,15 @@ int main(int argc, char* argv[])
     });
   });
 
-  for (int iter = 0; iter<=iterations; iter++) {
-    if (iter==1) stencil_time = prk::wtime();
-    // Apply the stencil operator
-    stencil(n, tile_size, in, out);
-    // Add constant to solution to force refresh of neighbor data, if any
+  while (stencil_time.next()) {
+    if (fused) {
+      // Apply the stencil operator and add the constant in the same sweep
+      stencil_fused(n, tile_size, in, out);
+    } else {
+      // Apply the stencil operator
+      stencil(n, tile_size, in, out);
+      // Add constant to solution to force refresh of neighbor data, if any
+    }
 #if defined(USE_PSTL) && ( defined(USE_INTEL_PSTL) || ( defined(__GNUC__) && (__GNUC__ >= 9) ) )
     std::transform( exec::par_unseq, in.begin(), in.end(), in.begin(), [](double c) { return c+=1.0; });
 #elif defined(USE_PSTL) && defined(__GNUC__) && defined(__GNUC_MINOR__) \
@@ -213,12 +199,13 @@ int main(int argc, char* argv[])
 #endif
   }
 
-  stencil_time = prk::wtime() - stencil_time;
-
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = stencil_time.applications() - 1;
+
   // interior of grid with respect to stencil
   size_t active_points = static_cast<size_t>(n-2*radius)*static_cast<size_t>(n-2*radius);
 
@@ -247,9 +234,13 @@ int main(int argc, char* argv[])
 #endif
     const int stencil_size = star ? 4*radius+1 : (2*radius+1)*(2*radius+1);
     size_t flops = (2L*(size_t)stencil_size+1L) * active_points;
-    auto avgtime = stencil_time/iterations;
+    auto avgtime = stencil_time.mean();
     std::cout << "Rate (MFlops/s): " << 1.0e-6 * static_cast<double>(flops)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << stencil_time << std::endl;
+    prk::roofline::report(fused ? prk::roofline::stencil_fused(n, active_points, stencil_size)
+                                : prk::roofline::stencil(n, active_points, stencil_size), avgtime);
+    record.validated("MFlops/s", 1.0e-6 * static_cast<double>(flops)/avgtime);
   }
 
   return 0;
@@ -62,17 +62,24 @@
 
 #include "prk_util.h"
 #include "prk_tbb.h"
-#include "stencil_tbb.hpp"
+#include "prk_stencil.h"
 
 void nothing(const int n, const int t, prk::vector<double> & in, prk::vector<double> & out)
 {
-    std::cout << "You are trying to use a stencil that does not exist." << std::endl;
-    std::cout << "Please generate the new stencil using the code generator." << std::endl;
+    std::cout << "You are trying to use a stencil radius larger than PRK_STENCIL_MAX_RADIUS.\n";
+    std::cout << "Please rebuild with -DPRK_STENCIL_MAX_RADIUS=<radius>." << std::endl;
     // n will never be zero - this is to silence compiler warnings.
     if (n==0) std::cout << in.size() << out.size() << std::endl;
     std::abort();
 }
 
+void nothing_oblivious(const int n, const int steps,
+                       prk::vector<double> & in, prk::vector<double> & in_next, prk::vector<double> & out)
+{
+    if (steps==0) std::cout << in_next.size() << std::endl;
+    nothing(n, 1, in, out);
+}
+
 int main(int argc, char* argv[])
 {
   std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
@@ -133,45 +140,47 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // PRK_STENCIL_OBLIVIOUS=1 replaces the tiles with trapezoidal space-time recursion
+  const bool oblivious = prk::stencil_oblivious_enabled();
+  // PRK_STENCIL_FUSED=1 adds the constant to in during the stencil sweep
+  const bool fused = !oblivious && prk::stencil_fused_enabled();
+
   const char* envvar = std::getenv("TBB_NUM_THREADS");
+#if defined(TBB_VERSION_MAJOR) && (TBB_VERSION_MAJOR >= 2021)
+  int num_threads = (envvar!=NULL) ? std::atoi(envvar) : tbb::info::default_concurrency();
+  tbb::global_control init(tbb::global_control::max_allowed_parallelism, num_threads);
+#else
   int num_threads = (envvar!=NULL) ? std::atoi(envvar) : tbb::task_scheduler_init::default_num_threads();
   tbb::task_scheduler_init init(num_threads);
+#endif
 
   std::cout << "Number of threads    = " << num_threads << std::endl;
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Grid size            = " << n << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
   std::cout << "Type of stencil      = " << (star ? "star" : "grid") << std::endl;
   std::cout << "Radius of stencil    = " << radius << std::endl;
+  std::cout << "Fused update         = " << (fused ? "yes" : "no") << std::endl;
+  std::cout << "Cache oblivious      = " << (oblivious ? "yes" : "no") << std::endl;
   std::cout << "TBB partitioner: " << typeid(tbb_partitioner).name() << std::endl;
 
-  auto stencil = nothing;
-  if (star) {
-      switch (radius) {
-          case 1: stencil = star1; break;
-          case 2: stencil = star2; break;
-          case 3: stencil = star3; break;
-          case 4: stencil = star4; break;
-          case 5: stencil = star5; break;
-      }
-  } else {
-      switch (radius) {
-          case 1: stencil = grid1; break;
-          case 2: stencil = grid2; break;
-          case 3: stencil = grid3; break;
-          case 4: stencil = grid4; break;
-          case 5: stencil = grid5; break;
-      }
-  }
+  auto stencil = prk::make_stencil<prk::stencil_backend::tbb>(star, radius, nothing);
+  auto stencil_fused = prk::make_stencil_fused<prk::stencil_backend::tbb>(star, radius, nothing);
+  auto stencil_oblivious = prk::make_stencil_oblivious<prk::stencil_backend::tbb>(star, radius, nothing_oblivious);
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto stencil_time = 0.0;
+  prk::bench::timer stencil_time(iterations);
+  prk::bench::record record("stencil", "tbb", stencil_time);
+  record.param("n", n).param("tile_size", tile_size).param("stencil", (star ? "star" : "grid")).param("radius", radius).param("fused", (fused ? "yes" : "no")).param("oblivious", (oblivious ? "yes" : "no")).threads(num_threads).param("alloc", prk::alloc::name());
 
-  prk::vector<double> in(n*n);
-  prk::vector<double> out(n*n);
+  prk::vector<double> in(n*n, prk::uninitialized);
+  prk::vector<double> out(n*n, prk::uninitialized);
+  // the cache-oblivious recursion reads in and writes in_next on alternate steps
+  prk::vector<double> in_next(oblivious ? n*n : 0, prk::uninitialized);
 
   tbb::blocked_range2d<int> range(0, n, tile_size, 0, n, tile_size);
   tbb::parallel_for( range, [&](decltype(range)& r) {
@@ -184,27 +193,40 @@ int main(int argc, char* argv[])
                      }
                    }, tbb_partitioner );
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) stencil_time = prk::wtime();
-    // Apply the stencil operator
-    stencil(n, tile_size, in, out);
-    // Add constant to solution to force refresh of neighbor data, if any
-    tbb::parallel_for( range, [&](decltype(range)& r) {
-                       for (auto i=r.rows().begin(); i!=r.rows().end(); ++i ) {
-                           PRAGMA_SIMD
-                           for (auto j=r.cols().begin(); j!=r.cols().end(); ++j ) {
-                               in[i*n+j] += 1.0;
+  if (oblivious) {
+    // Apply the stencil operator and add the constant for all timed iterations at once
+    while (auto steps = stencil_time.next_block(iterations)) {
+      stencil_oblivious(n, steps, in, in_next, out);
+      if (steps%2) in.swap(in_next);
+    }
+  } else {
+    while (stencil_time.next()) {
+      if (fused) {
+        // Apply the stencil operator and add the constant in the same sweep
+        stencil_fused(n, tile_size, in, out);
+      } else {
+        // Apply the stencil operator
+        stencil(n, tile_size, in, out);
+        // Add constant to solution to force refresh of neighbor data, if any
+        tbb::parallel_for( range, [&](decltype(range)& r) {
+                           for (auto i=r.rows().begin(); i!=r.rows().end(); ++i ) {
+                               PRAGMA_SIMD
+                               for (auto j=r.cols().begin(); j!=r.cols().end(); ++j ) {
+                                   in[i*n+j] += 1.0;
+                               }
                            }
-                       }
-                     }, tbb_partitioner);
+                         }, tbb_partitioner);
+      }
+    }
   }
-  stencil_time = prk::wtime() - stencil_time;
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results.
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = stencil_time.applications() - 1;
+
   // interior of grid with respect to stencil
   size_t active_points = static_cast<size_t>(n-2*radius)*static_cast<size_t>(n-2*radius);
 
@@ -247,9 +269,13 @@ int main(int argc, char* argv[])
 #endif
     const int stencil_size = star ? 4*radius+1 : (2*radius+1)*(2*radius+1);
     size_t flops = (2L*stencil_size+1L) * active_points;
-    auto avgtime = stencil_time/iterations;
+    auto avgtime = stencil_time.mean();
     std::cout << "Rate (MFlops/s): " << 1.0e-6 * static_cast<double>(flops)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << stencil_time << std::endl;
+    prk::roofline::report(fused ? prk::roofline::stencil_fused(n, active_points, stencil_size)
+                                : prk::roofline::stencil(n, active_points, stencil_size), avgtime);
+    record.validated("MFlops/s", 1.0e-6 * static_cast<double>(flops)/avgtime);
   }
 
   return 0;
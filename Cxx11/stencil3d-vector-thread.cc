@@ -0,0 +1,241 @@
+///
+/// Copyright (c) 2018, Intel Corporation
+///
+/// Redistribution and use in source and binary forms, with or without
+/// modification, are permitted provided that the following conditions
+/// are met:
+///
+/// * Redistributions of source code must retain the above copyright
+///       notice, this list of conditions and the following disclaimer.
+/// * Redistributions in binary form must reproduce the above
+///       copyright notice, this list of conditions and the following
+///       disclaimer in the documentation and/or other materials provided
+///       with the distribution.
+/// * Neither the name of Intel Corporation nor the names of its
+///       contributors may be used to endorse or promote products
+///       derived from this software without specific prior written
+///       permission.
+///
+/// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+/// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+/// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+/// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+/// COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+/// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+/// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+/// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+/// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+/// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+/// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+/// POSSIBILITY OF SUCH DAMAGE.
+
+
+//////////////////////////////////////////////////////////////////////
+///
+/// NAME:    Stencil 3D
+///
+/// PURPOSE: This program tests the efficiency with which a space-invariant,
+///          linear, symmetric filter (stencil) can be applied to a cubic
+///          grid, using 2.5D blocking: the stencil sweeps each block of
+///          <tile size> rows of the (j,k) plane along i, so that only 2r+1
+///          planes of the block need to stay in cache.
+///
+/// USAGE:   The program takes as input the linear
+///          dimension of the grid, and the number of iterations on the grid
+///
+///                <progname> <iterations> <grid size> [<tile size> <star/grid> <radius> <# threads>]
+///
+///          The star stencil of radius r has 6r+1 points (7 and 13 for
+///          r=1 and r=2), the grid stencil (2r+1)^3 points (27 for r=1).
+///
+///          The output consists of diagnostics to make sure the
+///          algorithm worked, and of timing statistics.
+///
+/// HISTORY: - Based on the 2D stencil by Rob Van der Wijngaart and
+///            Jeff Hammond.
+///
+//////////////////////////////////////////////////////////////////////
+
+#include "prk_util.h"
+#include "prk_stencil3d.h"
+
+void nothing(const int n, const int t, std::vector<double> & in, std::vector<double> & out, prk::thread_pool &)
+{
+    std::cout << "You are trying to use a stencil radius larger than PRK_STENCIL3D_MAX_RADIUS.\n"
+              << "Please rebuild with -DPRK_STENCIL3D_MAX_RADIUS=<radius>." << std::endl;
+    // n will never be zero - this is to silence compiler warnings.
+    if (n==0 || t==0) std::cout << in.size() << out.size() << std::endl;
+    std::abort();
+}
+
+int main(int argc, char* argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+  std::cout << "C++11/Threads Stencil execution on 3D grid" << std::endl;
+
+  //////////////////////////////////////////////////////////////////////
+  // Process and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations, n, radius, tile_size, num_threads;
+  bool star = true;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <array dimension> [<tile_size> <star/grid> <radius> <# threads>]";
+      }
+
+      // number of times to run the algorithm
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      // linear grid dimension
+      n  = std::atoi(argv[2]);
+      if (n < 1) {
+        throw "ERROR: grid dimension must be positive";
+      } else if (n > std::floor(std::cbrt(INT_MAX))) {
+        throw "ERROR: grid dimension too large - overflow risk";
+      }
+
+      // tile size of the (j,k) plane for 2.5D blocking
+      tile_size = 32;
+      if (argc > 3) {
+          tile_size = std::atoi(argv[3]);
+          if (tile_size <= 0) tile_size = n;
+          if (tile_size > n) tile_size = n;
+      }
+
+      // stencil pattern
+      if (argc > 4) {
+          auto stencil = std::string(argv[4]);
+          auto grid = std::string("grid");
+          star = (stencil == grid) ? false : true;
+      }
+
+      // stencil radius
+      radius = 1;
+      if (argc > 5) {
+          radius = std::atoi(argv[5]);
+      }
+
+      if ( (radius < 1) || (2*radius+1 > n) ) {
+        throw "ERROR: Stencil radius negative or too large";
+      }
+
+      // number of workers in the thread pool, each streaming one slab of planes
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+      if (argc > 6) {
+          num_threads = std::atoi(argv[6]);
+      }
+      if ( (num_threads < 1) || (num_threads > n-2*radius) ) {
+        throw "ERROR: number of threads must be between 1 and the number of interior planes";
+      }
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  std::cout << "Number of threads    = " << num_threads << std::endl;
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Grid size            = " << n << std::endl;
+  std::cout << "Tile size            = " << tile_size << std::endl;
+  std::cout << "Type of stencil      = " << (star ? "star" : "grid") << std::endl;
+  std::cout << "Radius of stencil    = " << radius << std::endl;
+
+  // the workers are started once and reused for every sweep
+  prk::thread_pool pool(num_threads);
+
+  auto stencil = prk::make_stencil3d<prk::stencil_backend::thread>(star, radius, nothing);
+
+  //////////////////////////////////////////////////////////////////////
+  // Allocate space and perform the computation
+  //////////////////////////////////////////////////////////////////////
+
+  prk::bench::timer stencil_time(iterations);
+  prk::bench::record record("stencil3d", "thread", stencil_time);
+  record.param("n", n).param("tile_size", tile_size).param("stencil", (star ? "star" : "grid")).param("radius", radius).threads(num_threads);
+
+  const size_t n3 = static_cast<size_t>(n)*n*n;
+  std::vector<double> in(n3);
+  std::vector<double> out(n3);
+
+  // runs f(i) for all planes i, split into one contiguous block per thread
+  auto for_planes = [&](auto f) {
+    pool.parallel_for(0, num_threads, [&](int p) {
+      const int i0 = (n*p)/num_threads;
+      const int i1 = (n*(p+1))/num_threads;
+      for (auto i=i0; i<i1; i++) f(i);
+    });
+  };
+
+  for_planes([&](int i) {
+    for (auto j=0; j<n; j++) {
+      PRAGMA_SIMD
+      for (auto k=0; k<n; k++) {
+        in[(i*n+j)*n+k] = static_cast<double>(i+j+k);
+        out[(i*n+j)*n+k] = 0.0;
+      }
+    }
+  });
+
+  while (stencil_time.next()) {
+    // Apply the stencil operator
+    stencil(n, tile_size, in, out, pool);
+    // Add constant to solution to force refresh of neighbor data, if any
+    for_planes([&](int i) {
+      PRAGMA_SIMD
+      for (auto jk=0; jk<n*n; jk++) {
+        in[i*n*n+jk] += 1.0;
+      }
+    });
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Analyze and output results.
+  //////////////////////////////////////////////////////////////////////
+
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = stencil_time.applications() - 1;
+
+  // interior of grid with respect to stencil
+  const size_t m = static_cast<size_t>(n-2*radius);
+  size_t active_points = m*m*m;
+
+  // compute L1 norm
+  double norm = 0.0;
+  for (auto i=radius; i<n-radius; i++) {
+    for (auto j=radius; j<n-radius; j++) {
+      for (auto k=radius; k<n-radius; k++) {
+        norm += std::fabs(out[(i*n+j)*n+k]);
+      }
+    }
+  }
+  norm /= active_points;
+
+  // verify correctness
+  const double epsilon = 1.0e-8;
+  double reference_norm = 3.*(iterations+1.);
+  if (std::fabs(norm-reference_norm) > epsilon) {
+    std::cout << "ERROR: L1 norm = " << norm
+              << " Reference L1 norm = " << reference_norm << std::endl;
+    return 1;
+  } else {
+    std::cout << "Solution validates" << std::endl;
+#ifdef VERBOSE
+    std::cout << "L1 norm = " << norm
+              << " Reference L1 norm = " << reference_norm << std::endl;
+#endif
+    const int stencil_size = star ? 6*radius+1 : (2*radius+1)*(2*radius+1)*(2*radius+1);
+    size_t flops = (2L*(size_t)stencil_size+1L) * active_points;
+    auto avgtime = stencil_time.mean();
+    std::cout << "Rate (MFlops/s): " << 1.0e-6 * static_cast<double>(flops)/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    std::cout << stencil_time << std::endl;
+    prk::roofline::report(prk::roofline::stencil3d(n, active_points, stencil_size), avgtime);
+    record.validated("MFlops/s", 1.0e-6 * static_cast<double>(flops)/avgtime);
+  }
+
+  return 0;
+}
@@ -97,27 +97,27 @@ int main(int argc, char * argv[])
   }
 
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order         = " << order << std::endl;
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "cblas", trans_time);
+  record.param("order", order).param("alloc", prk::alloc::name());
 
-  prk::vector<double> A(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
   prk::vector<double> B(order*order,0.0);
-  prk::vector<double> T(order*order);
+  prk::vector<double> T(order*order, prk::uninitialized);
   double one[1] = {1.0};
 
   // fill A with the sequence 0 to order^2-1 as doubles
   std::iota(A.begin(), A.end(), 0.0);
 
   {
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) trans_time = prk::wtime();
-
+    while (trans_time.next()) {
       // T = transpose(A)
 #if defined(MKL)
       mkl_domatcopy('R','T', order, order, 1.0, &(A[0]), order, &(T[0]), order);
@@ -136,13 +136,15 @@ int main(int argc, char * argv[])
       // A += 1
       cblas_daxpy(order*order, 1.0, one, 0, &(A[0]), 1);
     }
-    trans_time = prk::wtime() - trans_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   const auto addit = (iterations+1.) * (iterations/2.);
   double abserr(0);
   // TODO: replace with std::generate, std::accumulate, or similar
@@ -162,10 +164,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
@@ -53,67 +53,37 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
+#include "prk_transpose.h"
 
-int main(int argc, char * argv[])
+template <typename TI, typename TO>
+int run(int iterations, int order, int tile_size)
 {
-  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
-#ifdef _OPENMP
-  std::cout << "C++11/OpenMP Matrix transpose: B = A^T" << std::endl;
-#else
-  std::cout << "C++11 Matrix transpose: B = A^T" << std::endl;
-#endif
-
-  //////////////////////////////////////////////////////////////////////
-  // Read and test input parameters
-  //////////////////////////////////////////////////////////////////////
-
-  int iterations;
-  int order;
-  int tile_size;
-  try {
-      if (argc < 3) {
-        throw "Usage: <# iterations> <matrix order> [tile size]";
-      }
-
-      // number of times to do the transpose
-      iterations  = std::atoi(argv[1]);
-      if (iterations < 1) {
-        throw "ERROR: iterations must be >= 1";
-      }
-
-      // order of a the matrix
-      order = std::atoi(argv[2]);
-      if (order <= 0) {
-        throw "ERROR: Matrix Order must be greater than 0";
-      } else if (order > std::floor(std::sqrt(INT_MAX))) {
-        throw "ERROR: matrix dimension too large - overflow risk";
-      }
-
-      // default tile size for tiling of local transpose
-      tile_size = (argc>3) ? std::atoi(argv[3]) : 32;
-      // a negative tile size means no tiling of the local transpose
-      if (tile_size <= 0) tile_size = order;
-  }
-  catch (const char * e) {
-    std::cout << e << std::endl;
-    return 1;
-  }
-
 #ifdef _OPENMP
   std::cout << "Number of threads    = " << omp_get_max_threads() << std::endl;
 #endif
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order         = " << order << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
+  std::cout << "Precision            = " << prk::precision::name<TI,TO>() << std::endl;
+
+  // PRK_TRANSPOSE_ISA=none|sse2|avx2|avx512 caps the runtime ISA selection;
+  // the SIMD kernels replace the tiled loops and have no mixed-precision variant
+  const std::string isa = (tile_size < order && std::is_same<TI,TO>::value) ? prk::transpose_simd_isa()
+                                                                          : std::string("none");
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+  auto transpose_simd = prk::make_transpose_simd<TI,TO>(isa);
 
   //////////////////////////////////////////////////////////////////////
   /// Allocate space for the input and transpose matrix
   //////////////////////////////////////////////////////////////////////
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "openmp", trans_time);
+  record.param("order", order).param("tile_size", tile_size).param("alloc", prk::alloc::name()).param("precision", prk::precision::name<TI,TO>()).param("isa", isa);
 
-  double * RESTRICT A = new double[order*order];
-  double * RESTRICT B = new double[order*order];
+  TI * RESTRICT A = prk::malloc<TI>(order*order);
+  TO * RESTRICT B = prk::malloc<TO>(order*order);
 
   OMP_PARALLEL()
   {
@@ -121,30 +91,38 @@ int main(int argc, char * argv[])
     for (auto i=0;i<order; i++) {
       PRAGMA_SIMD
       for (auto j=0;j<order;j++) {
-        A[i*order+j] = static_cast<double>(i*order+j);
+        A[i*order+j] = static_cast<TI>(i*order+j);
         B[i*order+j] = 0.0;
       }
     }
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) {
-          OMP_BARRIER
-          OMP_MASTER
-          trans_time = prk::wtime();
-      }
+    while (true) {
+      OMP_BARRIER
+      OMP_MASTER
+      trans_time.next();
+      OMP_BARRIER
+      if (!trans_time.running()) break;
 
       // transpose the  matrix
-      if (tile_size < order) {
+      if (transpose_simd != nullptr) {
+        OMP_FOR()
+        for (auto it=0; it<order; it+=tile_size) {
+          for (auto jt=0; jt<order; jt+=tile_size) {
+            transpose_simd(order, it, std::min(order,it+tile_size), jt, std::min(order,jt+tile_size), A, B);
+          }
+        }
+      } else if (tile_size < order) {
         OMP_FOR()
         for (auto it=0; it<order; it+=tile_size) {
           for (auto jt=0; jt<order; jt+=tile_size) {
+            const auto imax = std::min(order,it+tile_size);
+            const auto jmax = std::min(order,jt+tile_size);
             PRAGMA_SIMD
-            for (auto i=it; i<std::min(order,it+tile_size); i++) {
+            for (auto i=it; i<imax; i++) {
               PRAGMA_SIMD
-              for (auto j=jt; j<std::min(order,jt+tile_size); j++) {
+              for (auto j=jt; j<jmax; j++) {
                 B[i*order+j] += A[j*order+i];
-                A[j*order+i] += 1.0;
+                A[j*order+i] += TI(1);
               }
             }
           }
@@ -155,20 +133,20 @@ int main(int argc, char * argv[])
         PRAGMA_SIMD
           for (auto j=0;j<order;j++) {
             B[i*order+j] += A[j*order+i];
-            A[j*order+i] += 1.0;
+            A[j*order+i] += TI(1);
           }
         }
       }
     }
-    OMP_BARRIER
-    OMP_MASTER
-    trans_time = prk::wtime() - trans_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   const auto addit = (iterations+1.) * (iterations/2.);
   auto abserr = 0.0;
   OMP_PARALLEL_FOR_REDUCE( +:abserr )
@@ -185,13 +163,120 @@ int main(int argc, char * argv[])
   std::cout << "Sum of absolute differences: " << abserr << std::endl;
 #endif
 
-  const auto epsilon = 1.0e-8;
+  // sum of the references, i.e. of the magnitudes in B
+  const double nn = static_cast<double>(order)*static_cast<double>(order);
+  const double refsum = (1.+iterations)*nn*(nn-1.)/2. + nn*addit;
+  const auto epsilon = prk::precision::epsilon<TO>(1.0e-8, refsum);
+  if (abserr < epsilon) {
+    std::cout << "Solution validates" << std::endl;
+    auto avgtime = trans_time.mean();
+    const double word = 0.5*(sizeof(TI) + sizeof(TO));
+    auto bytes = (size_t)order * (size_t)order * word;
+    std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order, word), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
+  } else {
+    std::cout << "ERROR: Aggregate squared error " << abserr
+              << " exceeds threshold " << epsilon << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+// A = A^T + 1 in place; each thread swaps whole tile pairs (it,jt) and (jt,it),
+// which are disjoint, so no two threads touch the same element
+template <typename T>
+int run_inplace(int iterations, int order, int tile_size)
+{
+#ifdef _OPENMP
+  std::cout << "Number of threads    = " << omp_get_max_threads() << std::endl;
+#endif
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
+  std::cout << "Matrix order         = " << order << std::endl;
+  std::cout << "Tile size            = " << tile_size << std::endl;
+  std::cout << "Precision            = " << prk::precision::name<T,T>() << std::endl;
+  std::cout << "In-place             = yes" << std::endl;
+
+  const std::string isa = (tile_size < order) ? prk::transpose_simd_isa() : std::string("none");
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+  auto transpose_inplace = prk::make_transpose_inplace<T>(isa);
+
+  //////////////////////////////////////////////////////////////////////
+  /// Allocate space for the matrix
+  //////////////////////////////////////////////////////////////////////
+
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "openmp", trans_time);
+  record.param("order", order).param("tile_size", tile_size).param("alloc", prk::alloc::name()).param("precision", prk::precision::name<T,T>()).param("isa", isa).param("inplace", "yes");
+
+  T * RESTRICT A = prk::malloc<T>(order*order);
+
+  OMP_PARALLEL()
+  {
+    OMP_FOR()
+    for (auto i=0;i<order; i++) {
+      PRAGMA_SIMD
+      for (auto j=0;j<order;j++) {
+        A[i*order+j] = static_cast<T>(i*order+j);
+      }
+    }
+
+    while (true) {
+      OMP_BARRIER
+      OMP_MASTER
+      trans_time.next();
+      OMP_BARRIER
+      if (!trans_time.running()) break;
+
+      // rows of tile pairs shrink towards the bottom, hence dynamic
+      OMP_FOR( schedule(dynamic) )
+      for (auto it=0; it<order; it+=tile_size) {
+        for (auto jt=it; jt<order; jt+=tile_size) {
+          transpose_inplace(order, it, std::min(order,it+tile_size), jt, std::min(order,jt+tile_size), A);
+        }
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  /// Analyze and output results
+  //////////////////////////////////////////////////////////////////////
+
+  // after k applications A(i,j) holds A(i,j) or A(j,i) of the start, plus k
+  const int k = trans_time.applications();
+  auto abserr = 0.0;
+  OMP_PARALLEL_FOR_REDUCE( +:abserr )
+  for (auto i=0; i<order; i++) {
+    for (auto j=0; j<order; j++) {
+      const int ij = i*order+j;
+      const int ji = j*order+i;
+      const double reference = static_cast<double>(k%2 ? ji : ij) + k;
+      abserr += std::fabs(A[ij] - reference);
+    }
+  }
+
+#ifdef VERBOSE
+  std::cout << "Sum of absolute differences: " << abserr << std::endl;
+#endif
+
+  // sum of the references, i.e. of the magnitudes in A
+  const double nn = static_cast<double>(order)*static_cast<double>(order);
+  const double refsum = nn*(nn-1.)/2. + nn*k;
+  const auto epsilon = prk::precision::epsilon<T>(1.0e-8, refsum);
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
-    auto bytes = (size_t)order * (size_t)order * sizeof(double);
+    auto avgtime = trans_time.mean();
+    // A is read and written once
+    auto bytes = (size_t)order * (size_t)order * sizeof(T);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose_inplace(order, sizeof(T)), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
@@ -201,4 +286,69 @@ int main(int argc, char * argv[])
   return 0;
 }
 
+int main(int argc, char * argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+#ifdef _OPENMP
+  std::cout << "C++11/OpenMP Matrix transpose: B = A^T" << std::endl;
+#else
+  std::cout << "C++11 Matrix transpose: B = A^T" << std::endl;
+#endif
+
+  //////////////////////////////////////////////////////////////////////
+  // Read and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations;
+  int order;
+  int tile_size;
+  prk::precision::kind precision;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <matrix order> [tile size]";
+      }
+
+      // number of times to do the transpose
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      // order of a the matrix
+      order = std::atoi(argv[2]);
+      if (order <= 0) {
+        throw "ERROR: Matrix Order must be greater than 0";
+      } else if (order > std::floor(std::sqrt(INT_MAX))) {
+        throw "ERROR: matrix dimension too large - overflow risk";
+      }
+
+      // default tile size for tiling of local transpose
+      tile_size = (argc>3) ? std::atoi(argv[3]) : 32;
+      // a negative tile size means no tiling of the local transpose
+      if (tile_size <= 0) tile_size = order;
+
+      // PRK_PRECISION=double|float|mixed
+      precision = prk::precision::get();
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
 
+  // PRK_TRANSPOSE_INPLACE=1 overwrites A with its transpose instead of accumulating into B
+  if (prk::transpose_inplace_enabled()) {
+    switch (precision) {
+      case prk::precision::kind::fp32:  return run_inplace<float>(iterations, order, tile_size);
+      case prk::precision::kind::mixed:
+        std::cout << "ERROR: the in-place transpose has no mixed precision" << std::endl;
+        return 1;
+      default:                          return run_inplace<double>(iterations, order, tile_size);
+    }
+  }
+
+  switch (precision) {
+    case prk::precision::kind::fp32:  return run<float,float>(iterations, order, tile_size);
+    case prk::precision::kind::mixed: return run<float,double>(iterations, order, tile_size);
+    default:                          return run<double,double>(iterations, order, tile_size);
+  }
+}
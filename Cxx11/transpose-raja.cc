@@ -107,7 +107,9 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  double trans_time(0);
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "raja", trans_time);
+  record.param("order", order).param("tile_size", tile_size);
 
   double * RESTRICT Amem = new double[order*order];
   double * RESTRICT Bmem = new double[order*order];
@@ -130,10 +132,7 @@ int main(int argc, char * argv[])
       B(i,j) = 0.0;
   });
 
-  for (int iter = 0; iter<=iterations; ++iter) {
-
-    if (iter==1) trans_time = prk::wtime();
-
+  while (trans_time.next()) {
     if (permute) {
         RAJA::kernel<permute_policy>(range2d, [=](int i, int j) {
             B(i,j) += A(j,i);
@@ -146,12 +145,14 @@ int main(int argc, char * argv[])
         });
     }
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   using reduce_policy = RAJA::KernelPolicy< RAJA::statement::For<0, thread_exec,
                                             RAJA::statement::For<1, RAJA::seq_exec,
                                             RAJA::statement::Lambda<0> > > >;
@@ -171,10 +172,13 @@ int main(int argc, char * argv[])
   double epsilon(1.0e-8);
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2.*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2.*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
@@ -108,17 +108,16 @@ int main(int argc, char * argv[])
   std::valarray<double> A(0.0,order*order);
   std::valarray<double> B(0.0,order*order);
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "valarray", trans_time);
+  record.param("order", order).param("tile_size", tile_size);
   for (auto j=0; j<order; j++) {
     for (auto i=0; i<order; i++) {
       A[j*order+i] = order*j+i;
     }
   }
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) trans_time = prk::wtime();
-
+  while (trans_time.next()) {
     // transpose the  matrix
     if (tile_size < order) {
       for (auto it=0; it<order; it+=tile_size) {
@@ -140,12 +139,14 @@ int main(int argc, char * argv[])
       }
     }
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   // Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   // TODO: replace with std::generate, std::accumulate, or similar
   const auto addit = (iterations+1.) * (iterations/2.);
   auto abserr = 0.0;
@@ -165,10 +166,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
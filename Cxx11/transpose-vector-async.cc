@@ -53,13 +53,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
-
-// These headers are busted with NVCC and GCC 5.4.0
-// The <future> header is busted with Cray C++ 8.6.1.
-#if !defined(__NVCC__) && !defined(_CRAYC)
-#include <thread>
-#include <future>
-#endif
+#include "prk_thread.h"
 
 int main(int argc, char * argv[])
 {
@@ -110,39 +104,37 @@ int main(int argc, char * argv[])
   if (order % block_size) num_futures++;
   num_futures *= num_futures;
 
+  // the futures run on PRK_NUM_THREADS workers that are started once
+  prk::thread_pool pool;
+
+  std::cout << "Number of threads     = " << pool.size() << std::endl;
   std::cout << "Number of futures     = " << num_futures << std::endl;
   std::cout << "Number of iterations  = " << iterations << std::endl;
+  std::cout << "Allocation policy     = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order          = " << order << std::endl;
   std::cout << "Block size            = " << block_size << std::endl;
   std::cout << "Tile size             = " << tile_size << std::endl;
 
-  if (num_futures > 300) {
-      std::cout << "These settings may lead to resource exhaustion.\n"
-                << "Please use a larger block size.\n";
-      return 1;
-  }
-
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  prk::vector<double> A(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
   prk::vector<double> B(order*order,0.0);
 
   // fill A with the sequence 0 to order^2-1 as doubles
   std::iota(A.begin(), A.end(), 0.0);
 
-  auto trans_time = 0.0;
-
-  std::vector<std::future<void>> pool;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "async", trans_time);
+  record.param("order", order).param("block_size", block_size).param("tile_size", tile_size).threads(pool.size()).param("futures", num_futures).param("alloc", prk::alloc::name());
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) trans_time = prk::wtime();
+  prk::task_group futures(pool);
 
+  while (trans_time.next()) {
     for (auto ib=0; ib<order; ib+=block_size) {
       for (auto jb=0; jb<order; jb+=block_size) {
-        pool.push_back(std::async(std::launch::async, [=,&A,&B] {
+        futures.run([=,&A,&B] {
           for (auto it=ib; it<std::min(order,ib+block_size); it+=tile_size) {
             for (auto jt=jb; jt<std::min(order,jb+block_size); jt+=tile_size) {
               for (auto i=it; i<std::min(ib+block_size,it+tile_size); i++) {
@@ -153,18 +145,19 @@ int main(int argc, char * argv[])
               }
             }
           }
-        } ));
+        } );
       }
     }
-    std::for_each(pool.begin(), pool.end(), [](std::future<void> & f) { f.wait(); });
-    pool.clear();
+    futures.wait();
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   // TODO: replace with std::generate, std::accumulate, or similar
   const auto addit = (iterations+1.) * (iterations/2.);
   auto abserr = 0.0;
@@ -184,10 +177,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
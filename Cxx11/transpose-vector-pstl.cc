@@ -108,12 +108,11 @@ int main(int argc, char * argv[])
 
   auto range = prk::range(0,order);
 
-  double trans_time(0);
-
-  for (int iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) trans_time = prk::wtime();
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "pstl", trans_time);
+  record.param("order", order);
 
+  while (trans_time.next()) {
     // transpose
 #if defined(USE_PSTL) && ( defined(USE_INTEL_PSTL) || ( defined(__GNUC__) && (__GNUC__ >= 9) ) )
   std::for_each( exec::par, std::begin(range), std::end(range), [&] (int i) {
@@ -131,12 +130,14 @@ int main(int argc, char * argv[])
       });
     });
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   // TODO: replace with std::generate, std::accumulate, or similar
   const auto addit = (iterations+1.) * (iterations/2.);
   auto abserr = 0.0;
@@ -156,10 +157,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
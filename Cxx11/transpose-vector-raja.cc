@@ -421,12 +421,11 @@ int main(int argc, char * argv[])
   }
 #endif
 
-  double trans_time(0);
-
-  for (int iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) trans_time = prk::wtime();
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "vector-raja", trans_time);
+  record.param("order", order).param("tile_size", tile_size);
 
+  while (trans_time.next()) {
     // transpose
     if (use_for=="seq") {
       if (use_nested) {
@@ -573,12 +572,14 @@ int main(int argc, char * argv[])
     }
 #endif
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   double abserr = 1.0;
 
   if (use_for=="seq") {
@@ -605,10 +606,13 @@ int main(int argc, char * argv[])
   double epsilon(1.0e-8);
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2.*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2.*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
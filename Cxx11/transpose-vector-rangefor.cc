@@ -94,6 +94,7 @@ int main(int argc, char * argv[])
   }
 
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order         = " << order << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
 
@@ -101,9 +102,11 @@ int main(int argc, char * argv[])
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "rangefor", trans_time);
+  record.param("order", order).param("tile_size", tile_size).param("alloc", prk::alloc::name());
 
-  prk::vector<double> A(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
   prk::vector<double> B(order*order,0.0);
 
   // fill A with the sequence 0 to order^2-1 as doubles
@@ -112,10 +115,7 @@ int main(int argc, char * argv[])
   auto itrange = prk::range(0,order,tile_size);
   auto jtrange = prk::range(0,order,tile_size);
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) trans_time = prk::wtime();
-
+  while (trans_time.next()) {
     for (auto it : itrange) {
       auto irange = prk::range(it,std::min(order,it+tile_size));
       for (auto jt : jtrange) {
@@ -129,12 +129,14 @@ int main(int argc, char * argv[])
       }
     }
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   // TODO: replace with std::generate, std::accumulate, or similar
   auto const addit = (iterations+1.) * (iterations/2.);
   double abserr(0);
@@ -156,10 +158,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
@@ -53,6 +53,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
+#include "prk_transpose.h"
 
 int main(int argc, char * argv[])
 {
@@ -106,17 +107,27 @@ int main(int argc, char * argv[])
   std::cout << "Taskloop grainsize   = " << gs << std::endl;
 #endif
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order         = " << order << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
 
+  // PRK_TRANSPOSE_OBLIVIOUS=1 replaces the tiles with recursive halving over tasks
+  const bool oblivious = prk::transpose_oblivious_enabled();
+  // the leaves of the recursion use the SIMD tile kernel
+  const std::string isa = oblivious ? prk::transpose_simd_isa() : std::string("none");
+  std::cout << "Cache oblivious      = " << (oblivious ? "yes" : "no") << std::endl;
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  prk::vector<double> A(order*order);
-  prk::vector<double> B(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
+  prk::vector<double> B(order*order, prk::uninitialized);
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "taskloop", trans_time);
+  record.param("order", order).param("tile_size", tile_size).param("alloc", prk::alloc::name()).param("oblivious", (oblivious ? "yes" : "no")).param("isa", isa);
 
   OMP_PARALLEL()
   OMP_MASTER
@@ -130,12 +141,11 @@ int main(int argc, char * argv[])
     }
     OMP_TASKWAIT
 
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) trans_time = prk::wtime();
-
+    while (trans_time.next()) {
       // transpose the  matrix
-      if (tile_size < order) {
+      if (oblivious) {
+        prk::transpose_oblivious<prk::fork_task>(order, A.data(), B.data(), isa);
+      } else if (tile_size < order) {
         OMP_TASKLOOP_COLLAPSE(2, firstprivate(order) shared(A,B) grainsize(gs) )
         for (auto it=0; it<order; it+=tile_size) {
           for (auto jt=0; jt<order; jt+=tile_size) {
@@ -158,13 +168,15 @@ int main(int argc, char * argv[])
       }
       OMP_TASKWAIT
     }
-    trans_time = prk::wtime() - trans_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   const auto addit = (iterations+1.) * (iterations/2.);
   auto abserr = 0.0;
   OMP_PARALLEL_FOR_REDUCE( +:abserr )
@@ -184,10 +196,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
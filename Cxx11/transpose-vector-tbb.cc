@@ -54,6 +54,7 @@
 
 #include "prk_util.h"
 #include "prk_tbb.h"
+#include "prk_transpose.h"
 
 int main(int argc, char * argv[])
 {
@@ -97,23 +98,38 @@ int main(int argc, char * argv[])
   }
 
   const char* envvar = std::getenv("TBB_NUM_THREADS");
+#if defined(TBB_VERSION_MAJOR) && (TBB_VERSION_MAJOR >= 2021)
+  int num_threads = (envvar!=NULL) ? std::atoi(envvar) : tbb::info::default_concurrency();
+  tbb::global_control init(tbb::global_control::max_allowed_parallelism, num_threads);
+#else
   int num_threads = (envvar!=NULL) ? std::atoi(envvar) : tbb::task_scheduler_init::default_num_threads();
   tbb::task_scheduler_init init(num_threads);
+#endif
 
   std::cout << "Number of threads    = " << num_threads << std::endl;
   std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Allocation policy    = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order         = " << order << std::endl;
   std::cout << "Tile size            = " << tile_size << std::endl;
   std::cout << "TBB partitioner: " << typeid(tbb_partitioner).name() << std::endl;
 
+  // PRK_TRANSPOSE_OBLIVIOUS=1 replaces the tiles with recursive halving over task groups
+  const bool oblivious = prk::transpose_oblivious_enabled();
+  // the leaves of the recursion use the SIMD tile kernel
+  const std::string isa = oblivious ? prk::transpose_simd_isa() : std::string("none");
+  std::cout << "Cache oblivious      = " << (oblivious ? "yes" : "no") << std::endl;
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "tbb", trans_time);
+  record.param("order", order).param("tile_size", tile_size).threads(num_threads).param("alloc", prk::alloc::name()).param("oblivious", (oblivious ? "yes" : "no")).param("isa", isa);
 
-  prk::vector<double> A(order*order);
-  prk::vector<double> B(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
+  prk::vector<double> B(order*order, prk::uninitialized);
 
   tbb::blocked_range2d<int> range(0, order, tile_size, 0, order, tile_size);
   tbb::parallel_for( range, [&](decltype(range)& r) {
@@ -126,24 +142,29 @@ int main(int argc, char * argv[])
                      }
                    }, tbb_partitioner);
 
-  for (auto iter = 0; iter<=iterations; iter++) {
-    if (iter==1) trans_time = prk::wtime();
-    tbb::parallel_for( range, [&](decltype(range)& r) {
-                       for (auto i=r.rows().begin(); i!=r.rows().end(); ++i ) {
-                           PRAGMA_SIMD
-                           for (auto j=r.cols().begin(); j!=r.cols().end(); ++j ) {
-                                B[i*order+j] += A[j*order+i];
-                                A[j*order+i] += 1.0;
-                           }
-                       }
-                     }, tbb_partitioner);
+  while (trans_time.next()) {
+    if (oblivious) {
+      prk::transpose_oblivious<prk::fork_tbb>(order, A.data(), B.data(), isa);
+    } else {
+      tbb::parallel_for( range, [&](decltype(range)& r) {
+                         for (auto i=r.rows().begin(); i!=r.rows().end(); ++i ) {
+                             PRAGMA_SIMD
+                             for (auto j=r.cols().begin(); j!=r.cols().end(); ++j ) {
+                                  B[i*order+j] += A[j*order+i];
+                                  A[j*order+i] += 1.0;
+                             }
+                         }
+                       }, tbb_partitioner);
+    }
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   const auto addit = (iterations+1.) * (iterations/2.);
   double abserr(0);
 #if 0
@@ -180,10 +201,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
@@ -53,13 +53,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
-
-// These headers are busted with NVCC and GCC 5.4.0
-// The <future> header is busted with Cray C++ 8.6.1.
-#if !defined(__NVCC__) && !defined(_CRAYC)
-#include <thread>
-#include <future>
-#endif
+#include "prk_thread.h"
 
 int main(int argc, char * argv[])
 {
@@ -91,15 +85,12 @@ int main(int argc, char * argv[])
         throw "ERROR: Matrix Order must be greater than 0";
       }
 
+      // blocks are the tasks scheduled on the thread pool
       block_size = std::atoi(argv[3]);
       if (block_size <= 0) {
         throw "ERROR: block size must be greater than 0";
       }
 
-      if (order / block_size > 16) {
-          throw "ERROR: this will create more than 256 threads";
-      }
-
       // default tile size for tiling of local transpose
       tile_size = (argc>4) ? std::atoi(argv[4]) : 32;
       // a negative tile size means no tiling of the local transpose
@@ -110,65 +101,56 @@ int main(int argc, char * argv[])
     return 1;
   }
 
-  int num_threads = order/block_size;
-  if (order % block_size) num_threads++;
-  num_threads *= num_threads;
+  // PRK_NUM_THREADS workers are started once and reused for every block
+  prk::thread_pool pool;
+  const int num_threads = pool.size();
 
   std::cout << "Number of threads     = " << num_threads << std::endl;
   std::cout << "Number of iterations  = " << iterations << std::endl;
+  std::cout << "Allocation policy     = " << prk::alloc::name() << std::endl;
   std::cout << "Matrix order          = " << order << std::endl;
   std::cout << "Block size            = " << block_size << std::endl;
   std::cout << "Tile size             = " << tile_size << std::endl;
 
-  if (num_threads > 300) {
-      std::cout << "These settings may lead to resource exhaustion.\n"
-                << "Please use a larger block size.\n";
-      return 1;
-  }
-
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  prk::vector<double> A(order*order);
+  prk::vector<double> A(order*order, prk::uninitialized);
   prk::vector<double> B(order*order,0.0);
 
   // fill A with the sequence 0 to order^2-1 as doubles
   std::iota(A.begin(), A.end(), 0.0);
 
-  auto trans_time = 0.0;
-
-  std::vector<std::thread> pool;
-
-  for (auto iter = 0; iter<=iterations; iter++) {
-
-    if (iter==1) trans_time = prk::wtime();
-
-    for (auto ib=0; ib<order; ib+=block_size) {
-      for (auto jb=0; jb<order; jb+=block_size) {
-        pool.push_back(std::thread([=,&A,&B] {
-          for (auto it=ib; it<std::min(order,ib+block_size); it+=tile_size) {
-            for (auto jt=jb; jt<std::min(order,jb+block_size); jt+=tile_size) {
-              for (auto i=it; i<std::min(ib+block_size,it+tile_size); i++) {
-                for (auto j=jt; j<std::min(jb+block_size,jt+tile_size); j++) {
-                  B[i*order+j] += A[j*order+i];
-                  A[j*order+i] += 1.0;
-                }
-              }
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "thread", trans_time);
+  record.param("order", order).param("block_size", block_size).param("tile_size", tile_size).threads(num_threads).param("pinned", (pool.pinned() ? "yes" : "no")).param("alloc", prk::alloc::name());
+
+  while (trans_time.next()) {
+    pool.parallel_for(prk::blocked_range2d(0, order, block_size, 0, order, block_size),
+                      [&](const prk::blocked_range2d & r) {
+      const auto ib = r.rows().begin(), iend = r.rows().end();
+      const auto jb = r.cols().begin(), jend = r.cols().end();
+      for (auto it=ib; it<iend; it+=tile_size) {
+        for (auto jt=jb; jt<jend; jt+=tile_size) {
+          for (auto i=it; i<std::min(iend,it+tile_size); i++) {
+            for (auto j=jt; j<std::min(jend,jt+tile_size); j++) {
+              B[i*order+j] += A[j*order+i];
+              A[j*order+i] += 1.0;
             }
           }
-        } ));
+        }
       }
-    }
-    std::for_each(pool.begin(), pool.end(), [](std::thread & t) { t.join(); });
-    pool.clear();
+    });
   }
-  trans_time = prk::wtime() - trans_time;
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   // TODO: replace with std::generate, std::accumulate, or similar
   const auto addit = (iterations+1.) * (iterations/2.);
   auto abserr = 0.0;
@@ -188,10 +170,13 @@ int main(int argc, char * argv[])
   const auto epsilon = 1.0e-8;
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
+    auto avgtime = trans_time.mean();
     auto bytes = (size_t)order * (size_t)order * sizeof(double);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order), avgtime);
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
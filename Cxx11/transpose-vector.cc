@@ -53,75 +53,58 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "prk_util.h"
+#include "prk_transpose.h"
 
-int main(int argc, char * argv[])
+template <typename TI, typename TO>
+int run(int iterations, int order, int tile_size)
 {
-  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
-  std::cout << "C++11 Matrix transpose: B = A^T" << std::endl;
+  std::cout << "Precision            = " << prk::precision::name<TI,TO>() << std::endl;
 
-  //////////////////////////////////////////////////////////////////////
-  // Read and test input parameters
-  //////////////////////////////////////////////////////////////////////
-
-  int iterations;
-  int order;
-  int tile_size;
-  try {
-      if (argc < 3) {
-        throw "Usage: <# iterations> <matrix order> [tile size]";
-      }
+  // PRK_TRANSPOSE_OBLIVIOUS=1 replaces the tiles with recursive halving
+  const bool oblivious = prk::transpose_oblivious_enabled();
+  std::cout << "Cache oblivious      = " << (oblivious ? "yes" : "no") << std::endl;
 
-      iterations  = std::atoi(argv[1]);
-      if (iterations < 1) {
-        throw "ERROR: iterations must be >= 1";
-      }
-
-      order = std::atoi(argv[2]);
-      if (order <= 0) {
-        throw "ERROR: Matrix Order must be greater than 0";
-      } else if (order > std::floor(std::sqrt(INT_MAX))) {
-        throw "ERROR: matrix dimension too large - overflow risk";
-      }
-
-      // default tile size for tiling of local transpose
-      tile_size = (argc>3) ? std::atoi(argv[3]) : 32;
-      // a negative tile size means no tiling of the local transpose
-      if (tile_size <= 0) tile_size = order;
-  }
-  catch (const char * e) {
-    std::cout << e << std::endl;
-    return 1;
-  }
-
-  std::cout << "Number of iterations = " << iterations << std::endl;
-  std::cout << "Matrix order         = " << order << std::endl;
-  std::cout << "Tile size            = " << tile_size << std::endl;
+  // PRK_TRANSPOSE_ISA=none|sse2|avx2|avx512 caps the runtime ISA selection;
+  // the SIMD kernels replace the tiled loops and have no mixed-precision variant
+  const std::string isa = ((oblivious || tile_size < order) && std::is_same<TI,TO>::value) ? prk::transpose_simd_isa()
+                                                                                         : std::string("none");
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+  auto transpose_simd = prk::make_transpose_simd<TI,TO>(isa);
 
   //////////////////////////////////////////////////////////////////////
   // Allocate space and perform the computation
   //////////////////////////////////////////////////////////////////////
 
-  auto trans_time = 0.0;
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "vector", trans_time);
+  record.param("order", order).param("tile_size", tile_size).param("precision", prk::precision::name<TI,TO>()).param("isa", isa).param("oblivious", (oblivious ? "yes" : "no"));
+  prk::counters::region trans_counters("transpose");
 
-  std::vector<double> A(order*order);
-  std::vector<double> B(order*order,0.0);
+  std::vector<TI> A(order*order);
+  std::vector<TO> B(order*order,0.0);
 
-  // fill A with the sequence 0 to order^2-1 as doubles
+  // fill A with the sequence 0 to order^2-1
   std::iota(A.begin(), A.end(), 0.0);
 
   {
-    for (auto iter = 0; iter<=iterations; iter++) {
-
-      if (iter==1) trans_time = prk::wtime();
-
+    while (trans_time.next()) {
+      if (trans_time.timed()) trans_counters.start();
       // transpose the  matrix
-      if (tile_size < order) {
+      if (oblivious) {
+        prk::transpose_oblivious<prk::fork_seq>(order, A.data(), B.data(), isa);
+      } else if (transpose_simd != nullptr) {
+        for (auto it=0; it<order; it+=tile_size) {
+          for (auto jt=0; jt<order; jt+=tile_size) {
+            transpose_simd(order, it, std::min(order,it+tile_size), jt, std::min(order,jt+tile_size), A.data(), B.data());
+          }
+        }
+      } else if (tile_size < order) {
         for (auto it=0; it<order; it+=tile_size) {
           for (auto jt=0; jt<order; jt+=tile_size) {
             for (auto i=it; i<std::min(order,it+tile_size); i++) {
               for (auto j=jt; j<std::min(order,jt+tile_size); j++) {
                 B[i*order+j] += A[j*order+i];
-                A[j*order+i] += 1.0;
+                A[j*order+i] += TI(1);
               }
             }
           }
@@ -130,18 +113,21 @@ int main(int argc, char * argv[])
         for (auto i=0;i<order; i++) {
           for (auto j=0;j<order;j++) {
             B[i*order+j] += A[j*order+i];
-            A[j*order+i] += 1.0;
+            A[j*order+i] += TI(1);
           }
         }
       }
+      trans_counters.stop();
     }
-    trans_time = prk::wtime() - trans_time;
   }
 
   //////////////////////////////////////////////////////////////////////
   /// Analyze and output results
   //////////////////////////////////////////////////////////////////////
 
+  // warm-up and early stopping determine how often the kernel was applied
+  iterations = trans_time.applications() - 1;
+
   const auto addit = (iterations+1.) * (iterations/2.);
   double abserr(0);
   // TODO: replace with std::generate, std::accumulate, or similar
@@ -158,13 +144,104 @@ int main(int argc, char * argv[])
   std::cout << "Sum of absolute differences: " << abserr << std::endl;
 #endif
 
-  const auto epsilon = 1.0e-8;
+  // sum of the references, i.e. of the magnitudes in B
+  const double nn = static_cast<double>(order)*static_cast<double>(order);
+  const double refsum = (1.+iterations)*nn*(nn-1.)/2. + nn*addit;
+  const auto epsilon = prk::precision::epsilon<TO>(1.0e-8, refsum);
+  if (abserr < epsilon) {
+    std::cout << "Solution validates" << std::endl;
+    auto avgtime = trans_time.mean();
+    const double word = 0.5*(sizeof(TI) + sizeof(TO));
+    auto bytes = (size_t)order * (size_t)order * word;
+    std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
+              << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose(order, word), avgtime);
+    std::cout << trans_counters;
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
+  } else {
+    std::cout << "ERROR: Aggregate squared error " << abserr
+              << " exceeds threshold " << epsilon << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+// A = A^T + 1 in place, swapping the tile pairs (it,jt) and (jt,it)
+template <typename T>
+int run_inplace(int iterations, int order, int tile_size)
+{
+  std::cout << "Precision            = " << prk::precision::name<T,T>() << std::endl;
+  std::cout << "In-place             = yes" << std::endl;
+
+  // the in-place kernels tile with blocks of the widest ISA the CPU supports
+  const std::string isa = (tile_size < order) ? prk::transpose_simd_isa() : std::string("none");
+  std::cout << "SIMD ISA             = " << isa << std::endl;
+  auto transpose_inplace = prk::make_transpose_inplace<T>(isa);
+
+  //////////////////////////////////////////////////////////////////////
+  // Allocate space and perform the computation
+  //////////////////////////////////////////////////////////////////////
+
+  prk::bench::timer trans_time(iterations);
+  prk::bench::record record("transpose", "vector", trans_time);
+  record.param("order", order).param("tile_size", tile_size).param("precision", prk::precision::name<T,T>()).param("isa", isa).param("inplace", "yes");
+  prk::counters::region trans_counters("transpose");
+
+  std::vector<T> A(order*order);
+
+  // fill A with the sequence 0 to order^2-1
+  std::iota(A.begin(), A.end(), 0.0);
+
+  {
+    while (trans_time.next()) {
+      if (trans_time.timed()) trans_counters.start();
+      // the pairs with jt >= it cover the matrix once
+      for (auto it=0; it<order; it+=tile_size) {
+        for (auto jt=it; jt<order; jt+=tile_size) {
+          transpose_inplace(order, it, std::min(order,it+tile_size), jt, std::min(order,jt+tile_size), A.data());
+        }
+      }
+      trans_counters.stop();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  /// Analyze and output results
+  //////////////////////////////////////////////////////////////////////
+
+  // after k applications A(i,j) holds A(i,j) or A(j,i) of the start, plus k
+  const int k = trans_time.applications();
+  double abserr(0);
+  for (auto i=0; i<order; i++) {
+    for (auto j=0; j<order; j++) {
+      const int ij = i*order+j;
+      const int ji = j*order+i;
+      const double reference = static_cast<double>(k%2 ? ji : ij) + k;
+      abserr += std::fabs(A[ij] - reference);
+    }
+  }
+
+#ifdef VERBOSE
+  std::cout << "Sum of absolute differences: " << abserr << std::endl;
+#endif
+
+  // sum of the references, i.e. of the magnitudes in A
+  const double nn = static_cast<double>(order)*static_cast<double>(order);
+  const double refsum = nn*(nn-1.)/2. + nn*k;
+  const auto epsilon = prk::precision::epsilon<T>(1.0e-8, refsum);
   if (abserr < epsilon) {
     std::cout << "Solution validates" << std::endl;
-    auto avgtime = trans_time/iterations;
-    auto bytes = (size_t)order * (size_t)order * sizeof(double);
+    auto avgtime = trans_time.mean();
+    // A is read and written once
+    auto bytes = (size_t)order * (size_t)order * sizeof(T);
     std::cout << "Rate (MB/s): " << 1.0e-6 * (2L*bytes)/avgtime
               << " Avg time (s): " << avgtime << std::endl;
+    std::cout << trans_time << std::endl;
+    prk::roofline::report(prk::roofline::transpose_inplace(order, sizeof(T)), avgtime);
+    std::cout << trans_counters;
+    record.validated("MB/s", 1.0e-6 * (2L*bytes)/avgtime);
   } else {
     std::cout << "ERROR: Aggregate squared error " << abserr
               << " exceeds threshold " << epsilon << std::endl;
@@ -174,4 +251,67 @@ int main(int argc, char * argv[])
   return 0;
 }
 
+int main(int argc, char * argv[])
+{
+  std::cout << "Parallel Research Kernels version " << PRKVERSION << std::endl;
+  std::cout << "C++11 Matrix transpose: B = A^T" << std::endl;
 
+  //////////////////////////////////////////////////////////////////////
+  // Read and test input parameters
+  //////////////////////////////////////////////////////////////////////
+
+  int iterations;
+  int order;
+  int tile_size;
+  prk::precision::kind precision;
+  try {
+      if (argc < 3) {
+        throw "Usage: <# iterations> <matrix order> [tile size]";
+      }
+
+      iterations  = std::atoi(argv[1]);
+      if (iterations < 1) {
+        throw "ERROR: iterations must be >= 1";
+      }
+
+      order = std::atoi(argv[2]);
+      if (order <= 0) {
+        throw "ERROR: Matrix Order must be greater than 0";
+      } else if (order > std::floor(std::sqrt(INT_MAX))) {
+        throw "ERROR: matrix dimension too large - overflow risk";
+      }
+
+      // default tile size for tiling of local transpose
+      tile_size = (argc>3) ? std::atoi(argv[3]) : 32;
+      // a negative tile size means no tiling of the local transpose
+      if (tile_size <= 0) tile_size = order;
+
+      // PRK_PRECISION=double|float|mixed
+      precision = prk::precision::get();
+  }
+  catch (const char * e) {
+    std::cout << e << std::endl;
+    return 1;
+  }
+
+  std::cout << "Number of iterations = " << iterations << std::endl;
+  std::cout << "Matrix order         = " << order << std::endl;
+  std::cout << "Tile size            = " << tile_size << std::endl;
+
+  // PRK_TRANSPOSE_INPLACE=1 overwrites A with its transpose instead of accumulating into B
+  if (prk::transpose_inplace_enabled()) {
+    switch (precision) {
+      case prk::precision::kind::fp32:  return run_inplace<float>(iterations, order, tile_size);
+      case prk::precision::kind::mixed:
+        std::cout << "ERROR: the in-place transpose has no mixed precision" << std::endl;
+        return 1;
+      default:                          return run_inplace<double>(iterations, order, tile_size);
+    }
+  }
+
+  switch (precision) {
+    case prk::precision::kind::fp32:  return run<float,float>(iterations, order, tile_size);
+    case prk::precision::kind::mixed: return run<float,double>(iterations, order, tile_size);
+    default:                          return run<double,double>(iterations, order, tile_size);
+  }
+}
@@ -140,6 +140,7 @@ int main(int argc, char **argv)
            my_ID,         /* rank                                        */
            root=0;        /* ID of master rank                           */
   int      error=0;       /* error flag for individual rank              */
+  char     params[256];   /* problem parameters for structured output    */
   double * RESTRICT a;    /* main vector                                 */
   double * RESTRICT b;    /* main vector                                 */
   double * RESTRICT c;    /* main vector                                 */
@@ -244,12 +245,19 @@ int main(int argc, char **argv)
              MPI_COMM_WORLD);
   
   if (my_ID == root) {
+    avgtime = nstream_time/iterations;
+    snprintf(params, sizeof(params), "length=%ld", length*Num_procs);
     if (checkTRIADresults(iterations, length, a)) {
-      avgtime = nstream_time/iterations;
       printf("Rate (MB/s): %lf Avg time (s): %lf\n",
              1.0E-06 * bytes/avgtime, avgtime);
+      prk_report("nstream", "mpi1", params, 1, Num_procs, iterations, NULL, 0,
+                 avgtime, "MB/s", 1.0E-06 * bytes/avgtime, 1);
+    }
+    else {
+      prk_report("nstream", "mpi1", params, 1, Num_procs, iterations, NULL, 0,
+                 avgtime, "MB/s", 0.0, 0);
+      error = 1;
     }
-    else error = 1;
   }
   bail_out(error);
   MPI_Finalize();
@@ -134,6 +134,7 @@ int main(int argc, char ** argv) {
   long   total_length_in; /* total required length to store input array          */
   long   total_length_out;/* total required length to store output array         */
   int    error=0;         /* error flag                                          */
+  char   params[256];     /* problem parameters for structured output            */
   DTYPE  weight[2*RADIUS+1][2*RADIUS+1]; /* weights of points in the stencil     */
   MPI_Request request[8];
 
@@ -441,6 +442,9 @@ int main(int argc, char ** argv) {
 
 /* verify correctness                                                            */
   if (my_ID == root) {
+    avgtime = stencil_time/iterations;
+    snprintf(params, sizeof(params), "n=%d stencil=%s radius=%d",
+             n, STAR ? "star" : "grid", RADIUS);
     norm /= f_active_points;
     if (RADIUS > 0) {
       reference_norm = (DTYPE) (iterations+1) * (COEFX + COEFY);
@@ -451,6 +455,8 @@ int main(int argc, char ** argv) {
     if (ABS(norm-reference_norm) > EPSILON) {
       printf("ERROR: L1 norm = "FSTR", Reference L1 norm = "FSTR"\n",
              norm, reference_norm);
+      prk_report("stencil", "mpi1", params, 1, Num_procs, iterations, NULL, 0,
+                 avgtime, "MFlops/s", 0.0, 0);
       error = 1;
     }
     else {
@@ -467,9 +473,10 @@ int main(int argc, char ** argv) {
     /* flops/stencil: 2 flops (fma) for each point in the stencil,
        plus one flop for the update of the input of the array        */
     flops = (DTYPE) (2*stencil_size+1) * f_active_points;
-    avgtime = stencil_time/iterations;
     printf("Rate (MFlops/s): "FSTR"  Avg time (s): %lf\n",
            1.0E-06 * flops/avgtime, avgtime);
+    prk_report("stencil", "mpi1", params, 1, Num_procs, iterations, NULL, 0,
+               avgtime, "MFlops/s", 1.0E-06 * flops/avgtime, 1);
   }
 
   MPI_Finalize();
@@ -150,6 +150,7 @@ int main(int argc, char ** argv)
   int phase;               /* phase inside staged communication     */
   int colstart;            /* starting column for owning rank       */
   int error;               /* error flag                            */
+  char params[256];        /* problem parameters for structured output */
   double * RESTRICT A_p;   /* original matrix column block          */
   double * RESTRICT B_p;   /* transposed matrix column block        */
   double * RESTRICT Work_in_p;/* workspace for transpose function   */
@@ -363,16 +364,21 @@ int main(int argc, char ** argv)
   MPI_Reduce(&abserr, &abserr_tot, 1, MPI_DOUBLE, MPI_SUM, root, MPI_COMM_WORLD);
 
   if (my_ID == root) {
+    avgtime = trans_time/(double)iterations;
+    snprintf(params, sizeof(params), "order=%ld tile=%d", order, Tile_order);
     if (abserr_tot < epsilon) {
       printf("Solution validates\n");
-      avgtime = trans_time/(double)iterations;
       printf("Rate (MB/s): %lf Avg time (s): %lf\n",1.0E-06*bytes/avgtime, avgtime);
+      prk_report("transpose", "mpi1", params, 1, Num_procs, iterations, NULL, 0,
+                 avgtime, "MB/s", 1.0E-06*bytes/avgtime, 1);
 #if VERBOSE
       printf("Summed errors: %f \n", abserr);
 #endif
     }
     else {
       printf("ERROR: Aggregate squared error %lf exceeds threshold %e\n", abserr, epsilon);
+      prk_report("transpose", "mpi1", params, 1, Num_procs, iterations, NULL, 0,
+                 avgtime, "MB/s", 0.0, 0);
       error = 1;
     }
   }
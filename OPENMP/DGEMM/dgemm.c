@@ -100,6 +100,7 @@ int main(int argc, char **argv){
   long    order;                /* number of rows and columns of matrices         */
   int     block;                /* tile size of matrices                          */
   int     shortcut;             /* true if only doing initialization              */
+  char    params[256];          /* problem parameters for structured output       */
 
   printf("Parallel Research Kernels version %s\n", PRKVERSION);
   printf("OpenMP Dense matrix-matrix multiplication\n");
@@ -288,12 +289,21 @@ int main(int argc, char **argv){
   for(checksum=0.0,j = 0; j < order; j++) for(i = 0; i < order; i++)
     checksum += C_arr(i,j);
 
+  avgtime = dgemm_time/iterations;
+#if !MKL
+  snprintf(params, sizeof(params), "order=%ld block=%d", order, block);
+#else
+  snprintf(params, sizeof(params), "order=%ld", order);
+#endif
+
   /* verification test                                                            */
   ref_checksum *= (iterations+1);
 
   if (ABS((checksum - ref_checksum)/ref_checksum) > epsilon) {
     printf("ERROR: Checksum = %lf, Reference checksum = %lf\n",
            checksum, ref_checksum);
+    prk_report("dgemm", "openmp", params, nthread_input, 1, iterations, NULL, 0,
+               avgtime, "MFlops/s", 0.0, 0);
     exit(EXIT_FAILURE);
   }
   else {
@@ -305,9 +315,10 @@ int main(int argc, char **argv){
   }
 
   double nflops = 2.0*forder*forder*forder;
-  avgtime = dgemm_time/iterations;
   printf("Rate (MFlops/s): %lf  Avg time (s): %lf\n",
          1.0E-06 *nflops/avgtime, avgtime);
+  prk_report("dgemm", "openmp", params, nthread_input, 1, iterations, NULL, 0,
+             avgtime, "MFlops/s", 1.0E-06 * nflops/avgtime, 1);
 
   exit(EXIT_SUCCESS);
 
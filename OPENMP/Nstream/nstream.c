@@ -141,6 +141,7 @@ int main(int argc, char **argv)
   int      nthread; 
   int      num_error=0;     /* flag that signals that requested and 
                               obtained numbers of threads are the same   */
+  char     params[256];   /* problem parameters for structured output    */
  
 /**********************************************************************************
 * process and test input parameters    
@@ -265,12 +266,19 @@ int main(int argc, char **argv)
   *********************************************************************/
  
   bytes   = 4.0 * sizeof(double) * length;
+  avgtime = nstream_time/iterations;
+  snprintf(params, sizeof(params), "length=%ld offset=%ld", length, offset);
   if (checkTRIADresults(iterations, length)) {
-    avgtime = nstream_time/iterations;
     printf("Rate (MB/s): %lf Avg time (s): %lf\n",
            1.0E-06 * bytes/avgtime, avgtime);
+    prk_report("nstream", "openmp", params, nthread, 1, iterations, NULL, 0,
+               avgtime, "MB/s", 1.0E-06 * bytes/avgtime, 1);
    }
-  else exit(EXIT_FAILURE);
+  else {
+    prk_report("nstream", "openmp", params, nthread, 1, iterations, NULL, 0,
+               avgtime, "MB/s", 0.0, 0);
+    exit(EXIT_FAILURE);
+  }
  
   return 0;
 }
@@ -117,6 +117,7 @@ int main(int argc, char ** argv)
   double * RESTRICT vector;/* vector pair to be reduced                      */
   int    num_error=0;     /* flag that signals that requested and obtained
                              numbers of threads are the same                 */
+  char   params[256];     /* problem parameters for structured output        */
 
 /*****************************************************************************
 ** process and test input parameters    
@@ -361,6 +362,10 @@ int main(int argc, char ** argv)
 
   } /* end of OpenMP parallel region                                         */
 
+  avgtime = reduce_time/iterations;
+  snprintf(params, sizeof(params), "length=%ld algorithm=%s",
+           vector_length, algorithm);
+
   /* verify correctness */
   element_value = (double)nthread*(2.0*(double)nthread+1.0);
 
@@ -368,6 +373,8 @@ int main(int argc, char ** argv)
     if (ABS(VEC0(0,i) - element_value) >= epsilon) {
        printf("First error at i=%d; value: %lf; reference value: %lf\n",
               i, VEC0(0,i), element_value);
+       prk_report("reduce", "openmp", params, nthread, 1, iterations, NULL, 0,
+                  avgtime, "MFlops/s", 0.0, 0);
        exit(EXIT_FAILURE);
     }
   }
@@ -376,9 +383,10 @@ int main(int argc, char ** argv)
 #if VERBOSE
   printf("Element verification value: %lf\n", element_value);
 #endif
-  avgtime = reduce_time/iterations;
   printf("Rate (MFlops/s): %lf  Avg time (s): %lf\n",
          1.0E-06 * (2.0*nthread-1.0)*vector_length/avgtime, avgtime);
+  prk_report("reduce", "openmp", params, nthread, 1, iterations, NULL, 0,
+             avgtime, "MFlops/s", 1.0E-06 * (2.0*nthread-1.0)*vector_length/avgtime, 1);
 
   exit(EXIT_SUCCESS);
 }
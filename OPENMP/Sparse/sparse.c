@@ -114,6 +114,7 @@ int main(int argc, char **argv){
                     nthread;
   int               num_error=0; /* flag that signals that requested and
                                    obtained numbers of threads are the same       */
+  char              params[256]; /* problem parameters for structured output      */
   size_t            vector_space, /* variables used to hold prk_malloc sizes          */
                     matrix_space,
                     index_space;
@@ -299,6 +300,9 @@ int main(int argc, char **argv){
 
   } /* end of parallel region                                                     */
 
+  avgtime = sparse_time/iterations;
+  snprintf(params, sizeof(params), "lsize=%d radius=%d", lsize, radius);
+
   /* verification test                                                            */
   reference_sum = 0.5 * (double) nent * (double) (iterations+1) *
                         (double) (iterations +2);
@@ -308,6 +312,8 @@ int main(int argc, char **argv){
   if (ABS(vector_sum-reference_sum) > epsilon) {
     printf("ERROR: Vector sum = %lf, Reference vector sum = %lf\n",
            vector_sum, reference_sum);
+    prk_report("sparse", "openmp", params, nthread, 1, iterations, NULL, 0,
+               avgtime, "MFlops/s", 0.0, 0);
     exit(EXIT_FAILURE);
   }
   else {
@@ -318,9 +324,10 @@ int main(int argc, char **argv){
 #endif
   }
 
-  avgtime = sparse_time/iterations;
   printf("Rate (MFlops/s): %lf  Avg time (s): %lf\n",
          1.0E-06 * (2.0*nent)/avgtime, avgtime);
+  prk_report("sparse", "openmp", params, nthread, 1, iterations, NULL, 0,
+             avgtime, "MFlops/s", 1.0E-06 * (2.0*nent)/avgtime, 1);
 
   exit(EXIT_SUCCESS);
 }
@@ -103,6 +103,7 @@ int main(int argc, char ** argv) {
   int    num_error=0;     /* flag that signals that requested and obtained
                              numbers of threads are the same                     */
   DTYPE  weight[2*RADIUS+1][2*RADIUS+1]; /* weights of points in the stencil     */
+  char   params[256];     /* problem parameters for structured output            */
 
   printf("Parallel Research Kernels version %s\n", PRKVERSION);
   printf("OpenMP stencil execution on 2D grid\n");
@@ -333,11 +334,17 @@ int main(int argc, char ** argv) {
   prk_free(out);
   prk_free(in);
 
+  avgtime = stencil_time/iterations;
+  snprintf(params, sizeof(params), "n=%ld stencil=%s radius=%d",
+           n, STAR ? "star" : "grid", RADIUS);
+
 /* verify correctness                                                            */
   reference_norm = (DTYPE) (iterations+1) * (COEFX + COEFY);
   if (ABS(norm-reference_norm) > EPSILON) {
     printf("ERROR: L1 norm = "FSTR", Reference L1 norm = "FSTR"\n",
            norm, reference_norm);
+    prk_report("stencil", "openmp", params, nthread, 1, iterations, NULL, 0,
+               avgtime, "MFlops/s", 0.0, 0);
     exit(EXIT_FAILURE);
   }
   else {
@@ -349,9 +356,10 @@ int main(int argc, char ** argv) {
   }
 
   flops = (DTYPE) (2*stencil_size+1) * f_active_points;
-  avgtime = stencil_time/iterations;
   printf("Rate (MFlops/s): "FSTR"  Avg time (s): %lf\n",
          1.0E-06 * flops/avgtime, avgtime);
+  prk_report("stencil", "openmp", params, nthread, 1, iterations, NULL, 0,
+             avgtime, "MFlops/s", 1.0E-06 * flops/avgtime, 1);
 
   exit(EXIT_SUCCESS);
 }
@@ -91,6 +91,7 @@ int main(int argc, char ** argv) {
          nthread;
   int    num_error=0;     /* flag that signals that requested and 
                              obtained numbers of threads are the same      */
+  char   params[256];   /* problem parameters for structured output        */
 
   /*********************************************************************
   ** read and test input parameters
@@ -260,11 +261,15 @@ int main(int argc, char ** argv) {
   ** Analyze and output results.
   *********************************************************************/
 
+  avgtime = transpose_time/iterations;
+  snprintf(params, sizeof(params), "order=%zu tile=%d", order, Tile_order);
+
   if (abserr < epsilon) {
     printf("Solution validates\n");
-    avgtime = transpose_time/iterations;
     printf("Rate (MB/s): %lf Avg time (s): %lf\n",
            1.0E-06 * bytes/avgtime, avgtime);
+    prk_report("transpose", "openmp", params, nthread, 1, iterations, NULL, 0,
+               avgtime, "MB/s", 1.0E-06 * bytes/avgtime, 1);
 #if VERBOSE
     printf("Squared errors: %f \n", abserr);
 #endif
@@ -273,6 +278,8 @@ int main(int argc, char ** argv) {
   else {
     printf("ERROR: Aggregate squared error %lf exceeds threshold %e\n",
            abserr, epsilon);
+    prk_report("transpose", "openmp", params, nthread, 1, iterations, NULL, 0,
+               avgtime, "MB/s", 0.0, 0);
     exit(EXIT_FAILURE);
   }
 
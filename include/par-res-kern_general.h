@@ -172,6 +172,85 @@ static inline void prk_pause(double dt)
   return;
 }
 
+/* Machine-readable result record.  Nothing is written unless the environment
+   variable PRK_OUTPUT is set to "json" (one object per line) or "csv" (one row,
+   preceded by a header if the output is empty).  Records are appended to the
+   file named by PRK_OUTPUT_FILE, or written to stdout if it is not set.
+
+   params is a whitespace-separated list of key=value pairs.  times holds
+   ntimes per-iteration times; kernels that only time the whole iteration loop
+   pass NULL and 0.  Only one process should call this function.            */
+static inline void prk_report(const char * kernel, const char * backend,
+                              const char * params, int threads, int ranks,
+                              int iterations, const double * times, int ntimes,
+                              double avgtime, const char * rate_unit, double rate,
+                              int valid)
+{
+  char * format   = getenv("PRK_OUTPUT");
+  char * filename = getenv("PRK_OUTPUT_FILE");
+  FILE * out      = stdout;
+  char   buffer[1024];
+  char * key, * value, * end, * saveptr;
+  int    json, first, i;
+  long   position = 0;
+
+  if (format==NULL) return;
+  if      (strcmp(format,"json")==0) json = 1;
+  else if (strcmp(format,"csv")==0)  json = 0;
+  else return;
+
+  if (filename!=NULL) {
+    out = fopen(filename,"a");
+    if (out==NULL) {
+      fprintf(stderr,"PRK_OUTPUT_FILE %s cannot be opened\n",filename);
+      return;
+    }
+    fseek(out,0,SEEK_END);
+    position = ftell(out);
+  }
+
+  strncpy(buffer,(params!=NULL) ? params : "",sizeof(buffer)-1);
+  buffer[sizeof(buffer)-1] = '\0';
+
+  if (json) {
+    fprintf(out,"{\"version\":\"%s\",\"kernel\":\"%s\",\"backend\":\"%s\",\"params\":{",
+            PRKVERSION, kernel, backend);
+    first = 1;
+    for (key=strtok_r(buffer," \t",&saveptr); key!=NULL; key=strtok_r(NULL," \t",&saveptr)) {
+      value = strchr(key,'=');
+      if (value==NULL) continue;
+      *value++ = '\0';
+      strtod(value,&end);
+      if (*value!='\0' && *end=='\0') fprintf(out,"%s\"%s\":%s",    first ? "" : ",", key, value);
+      else                            fprintf(out,"%s\"%s\":\"%s\"",first ? "" : ",", key, value);
+      first = 0;
+    }
+    fprintf(out,"},\"threads\":%d,\"ranks\":%d,\"warmup\":1,\"iterations\":%d,\"times\":[",
+            threads, ranks, iterations);
+    for (i=0; i<ntimes; i++) fprintf(out,"%s%.9g", i ? "," : "", times[i]);
+    fprintf(out,"],\"avg_time\":%.9g,\"rate\":%.9g,\"rate_unit\":\"%s\",\"valid\":%s}\n",
+            avgtime, rate, rate_unit, valid ? "true" : "false");
+  }
+  else {
+    if (position==0) {
+      fprintf(out,"version,kernel,backend,params,threads,ranks,warmup,iterations,times,"
+                  "avg_time,rate,rate_unit,valid\n");
+    }
+    fprintf(out,"%s,%s,%s,",PRKVERSION,kernel,backend);
+    first = 1;
+    for (key=strtok_r(buffer," \t",&saveptr); key!=NULL; key=strtok_r(NULL," \t",&saveptr)) {
+      fprintf(out,"%s%s", first ? "" : ";", key);
+      first = 0;
+    }
+    fprintf(out,",%d,%d,1,%d,",threads,ranks,iterations);
+    for (i=0; i<ntimes; i++) fprintf(out,"%s%.9g", i ? ";" : "", times[i]);
+    fprintf(out,",%.9g,%.9g,%s,%d\n",avgtime,rate,rate_unit,valid ? 1 : 0);
+  }
+
+  if (out!=stdout) fclose(out);
+  else             fflush(out);
+}
+
 /* find factorization of an integer into two factors that are as close together as 
    possible. If not the same, second factor is the largest                               */
 static inline void factor(int r, int *fac1, int *fac2) {
@@ -326,24 +326,61 @@ case "$PRK_TARGET" in
 
         # C++11 without external parallelism
         ${MAKE} -C $PRK_TARGET_PATH p2p-vector p2p-hyperplane-vector stencil-vector transpose-vector nstream-vector \
-                                 dgemm-vector sparse-vector
+                                 dgemm-vector sparse-vector stencil3d-vector sparse
         $PRK_TARGET_PATH/p2p-vector              10 1024 1024
         $PRK_TARGET_PATH/p2p-vector              10 1024 1024 100 100
         $PRK_TARGET_PATH/p2p-hyperplane-vector   10 1024
         $PRK_TARGET_PATH/p2p-hyperplane-vector   10 1024 64
         $PRK_TARGET_PATH/stencil-vector          10 1000
+        $PRK_TARGET_PATH/stencil-vector          10 1000 64 star 2 4 # temporal blocking
+        PRK_STENCIL_FUSED=1 $PRK_TARGET_PATH/stencil-vector 10 1000
+        PRK_STENCIL_OBLIVIOUS=1 $PRK_TARGET_PATH/stencil-vector 10 1000
+        PRK_STENCIL_ISA=sse2 $PRK_TARGET_PATH/stencil-vector 10 1000
+        PRK_STENCIL_ISA=none $PRK_TARGET_PATH/stencil-vector 10 1000
+        PRK_PRECISION=float $PRK_TARGET_PATH/stencil-vector 10 1000
+        PRK_PRECISION=mixed $PRK_TARGET_PATH/stencil-vector 10 1000
+        $PRK_TARGET_PATH/stencil3d-vector        10 100
         $PRK_TARGET_PATH/transpose-vector        10 1024 32
+        PRK_TRANSPOSE_ISA=sse2 $PRK_TARGET_PATH/transpose-vector 10 1031 32
+        PRK_TRANSPOSE_ISA=none $PRK_TARGET_PATH/transpose-vector 10 1024 32
+        PRK_TRANSPOSE_OBLIVIOUS=1 $PRK_TARGET_PATH/transpose-vector 10 1031
+        PRK_TRANSPOSE_INPLACE=1 $PRK_TARGET_PATH/transpose-vector 10 1031 32
+        PRK_TRANSPOSE_INPLACE=1 PRK_PRECISION=float $PRK_TARGET_PATH/transpose-vector 10 1024 32
         $PRK_TARGET_PATH/nstream-vector          10 16777216 32
+        PRK_PRECISION=float $PRK_TARGET_PATH/transpose-vector 10 1024 32
+        PRK_ROOFLINE=1 $PRK_TARGET_PATH/nstream-vector 10 16777216 32
+        PRK_PRECISION=mixed $PRK_TARGET_PATH/nstream-vector 10 16777216 32
         $PRK_TARGET_PATH/dgemm-vector            10 400 400 # untiled
         $PRK_TARGET_PATH/dgemm-vector            10 400 32
         $PRK_TARGET_PATH/sparse-vector           10 10 5
+        $PRK_TARGET_PATH/sparse                  10 10 5 sell
+        PRK_SPARSE_SIGMA=32 $PRK_TARGET_PATH/sparse 10 10 5 sell
+        PRK_SPARSE_ISA=none $PRK_TARGET_PATH/sparse 10 10 5 ell
+        $PRK_TARGET_PATH/sparse                  10 1 1 sell # partial chunk
+        $PRK_TARGET_PATH/sparse                  10 10 5 csr 32
+        $PRK_TARGET_PATH/sparse                  10 10 5 csr delta
+        $PRK_TARGET_PATH/sparse                  10 10 5 sell 32
+        $PRK_TARGET_PATH/sparse                  10 10 5 csr 64 rcm
+        $PRK_TARGET_PATH/sparse                  10 10 5 sell 32 hilbert
+        $PRK_TARGET_PATH/sparse                  10 10 5 csr delta morton
+        # a small symmetric Matrix Market file, then its binary CSR copy
+        printf '%%%%MatrixMarket matrix coordinate real symmetric\n%% 1D Laplacian\n5 5 9\n1 1 2\n2 1 -1\n2 2 2\n3 2 -1\n3 3 2\n4 3 -1\n4 4 2\n5 4 -1\n5 5 2\n' > /tmp/prk-sparse.mtx
+        PRK_SPARSE_SAVE_CSR=1 $PRK_TARGET_PATH/sparse 10 /tmp/prk-sparse.mtx
+        $PRK_TARGET_PATH/sparse                  10 /tmp/prk-sparse.csr sell 32 rcm
         #echo "Test stencil code generator"
         for s in star grid ; do
-            for r in 1 2 3 4 5 ; do
+            for r in 1 2 3 4 5 6 7 8 ; do
                 $PRK_TARGET_PATH/stencil-vector 10 200 20 $s $r
             done
         done
 
+        # 3D stencils
+        for s in star grid ; do
+            for r in 1 2 3 4 ; do
+                $PRK_TARGET_PATH/stencil3d-vector 10 50 8 $s $r
+            done
+        done
+
         # C++11 with CBLAS
         if [ "${TRAVIS_OS_NAME}" = "osx" ] ; then
             echo "CBLASFLAG=-DACCELERATE -framework Accelerate" >> common/make.defs
@@ -353,9 +390,17 @@ case "$PRK_TARGET" in
         fi
 
         # C++11 native parallelism
-        ${MAKE} -C $PRK_TARGET_PATH transpose-vector-thread transpose-vector-async
+        ${MAKE} -C $PRK_TARGET_PATH transpose-vector-thread transpose-vector-async stencil3d-vector-thread dgemm-vector-thread \
+                                 sparse-vector-thread
         $PRK_TARGET_PATH/transpose-vector-thread 10 1024 512 32
         $PRK_TARGET_PATH/transpose-vector-async  10 1024 512 32
+        PRK_NUM_THREADS=4 $PRK_TARGET_PATH/transpose-vector-thread 10 1024 32 32 # more blocks than workers
+        PRK_THREAD_PIN=1 $PRK_TARGET_PATH/transpose-vector-async 10 1024 64 32
+        $PRK_TARGET_PATH/stencil3d-vector-thread 10 100 32 star 1 4
+        $PRK_TARGET_PATH/dgemm-vector-thread     10 400 32
+        PRK_NUM_THREADS=3 PRK_DGEMM_GROUPS=2 $PRK_TARGET_PATH/dgemm-vector-thread 10 401 32
+        $PRK_TARGET_PATH/sparse-vector-thread    10 10 5
+        PRK_NUM_THREADS=3 $PRK_TARGET_PATH/sparse-vector-thread 10 10 5 # uneven row parts
 
         # C++11 with OpenMP
         export OMP_NUM_THREADS=2
@@ -364,16 +409,38 @@ case "$PRK_TARGET" in
                 # Host
                 echo "OPENMPFLAG=-fopenmp" >> common/make.defs
                 ${MAKE} -C $PRK_TARGET_PATH p2p-tasks-openmp p2p-hyperplane-openmp stencil-openmp \
-                                         transpose-openmp nstream-openmp
+                                         transpose-openmp nstream-openmp stencil3d-openmp dgemm-openmp \
+                                         dgemm-batched-openmp sparse-openmp
                 $PRK_TARGET_PATH/p2p-tasks-openmp                 10 1024 1024 100 100
                 $PRK_TARGET_PATH/p2p-hyperplane-openmp     10 1024
                 $PRK_TARGET_PATH/p2p-hyperplane-openmp     10 1024 64
                 $PRK_TARGET_PATH/stencil-openmp            10 1000
+                $PRK_TARGET_PATH/stencil-openmp            10 1000 64 grid 1 4 # temporal blocking
+                PRK_STENCIL_FUSED=1 $PRK_TARGET_PATH/stencil-openmp 10 1000
+                PRK_PRECISION=float $PRK_TARGET_PATH/stencil-openmp 10 1000
+                $PRK_TARGET_PATH/stencil3d-openmp          10 100 32 grid 1
                 $PRK_TARGET_PATH/transpose-openmp          10 1024 32
+                PRK_TRANSPOSE_ISA=none $PRK_TARGET_PATH/transpose-openmp 10 1024 32
+                PRK_TRANSPOSE_INPLACE=1 $PRK_TARGET_PATH/transpose-openmp 10 1031 32
                 $PRK_TARGET_PATH/nstream-openmp            10 16777216 32
+                PRK_ALLOC=thp,firsttouch $PRK_TARGET_PATH/nstream-openmp 10 16777216 32
+                $PRK_TARGET_PATH/dgemm-openmp              10 400 32
+                PRK_DGEMM_GROUPS=2 $PRK_TARGET_PATH/dgemm-openmp 10 401 32
+                $PRK_TARGET_PATH/dgemm-batched-openmp      10 8 10000
+                $PRK_TARGET_PATH/dgemm-batched-openmp      10 7 1001 # generic kernel, partial group
+                PRK_DGEMM_ISA=none $PRK_TARGET_PATH/dgemm-batched-openmp 10 16 1000
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5 sell
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5 ell
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5 csr delta
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5 sell 32
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5 csr 64 rcm
+                $PRK_TARGET_PATH/sparse-openmp             10 10 5 sell 32 hilbert
+                $PRK_TARGET_PATH/sparse-openmp             10 /tmp/prk-sparse.mtx csr delta rcm
+                $PRK_TARGET_PATH/sparse-openmp             10 /tmp/prk-sparse.csr ell
                 #echo "Test stencil code generator"
                 for s in star grid ; do
-                    for r in 1 2 3 4 5 ; do
+                    for r in 1 2 3 4 5 6 7 8 ; do
                         $PRK_TARGET_PATH/stencil-openmp 10 200 20 $s $r
                     done
                 done
@@ -384,7 +451,7 @@ case "$PRK_TARGET" in
                 $PRK_TARGET_PATH/transpose-openmp-target   10 1024 32
                 #echo "Test stencil code generator"
                 for s in star grid ; do
-                    for r in 1 2 3 4 5 ; do
+                    for r in 1 2 3 4 5 6 7 8 ; do
                         $PRK_TARGET_PATH/stencil-openmp 10 200 20 $s $r
                     done
                 done
@@ -408,7 +475,7 @@ case "$PRK_TARGET" in
                     $PRK_TARGET_PATH/nstream-openmp            10 16777216 32
                     #echo "Test stencil code generator"
                     for s in star grid ; do
-                        for r in 1 2 3 4 5 ; do
+                        for r in 1 2 3 4 5 6 7 8 ; do
                             $PRK_TARGET_PATH/stencil-openmp 10 200 20 $s $r
                         done
                     done
@@ -439,7 +506,7 @@ case "$PRK_TARGET" in
                 $PRK_TARGET_PATH/nstream-openmp            10 16777216 32
                 #echo "Test stencil code generator"
                 for s in star grid ; do
-                    for r in 1 2 3 4 5 ; do
+                    for r in 1 2 3 4 5 6 7 8 ; do
                         $PRK_TARGET_PATH/stencil-openmp 10 200 20 $s $r
                     done
                 done
@@ -481,7 +548,7 @@ case "$PRK_TARGET" in
         $PRK_TARGET_PATH/nstream-vector-rangefor     10 16777216 32
         #echo "Test stencil code generator"
         for s in star grid ; do
-            for r in 1 2 3 4 5 ; do
+            for r in 1 2 3 4 5 6 7 8 ; do
                 $PRK_TARGET_PATH/stencil-vector-rangefor 10 200 20 $s $r
             done
         done
@@ -503,17 +570,22 @@ case "$PRK_TARGET" in
                     export LD_LIBRARY_PATH=${TBBROOT}/lib:${LD_LIBRARY_PATH}
                     ;;
             esac
-            ${MAKE} -C $PRK_TARGET_PATH p2p-innerloop-vector-tbb p2p-hyperplane-vector-tbb p2p-tasks-tbb stencil-vector-tbb transpose-vector-tbb nstream-vector-tbb
+            ${MAKE} -C $PRK_TARGET_PATH p2p-innerloop-vector-tbb p2p-hyperplane-vector-tbb p2p-tasks-tbb stencil-vector-tbb transpose-vector-tbb nstream-vector-tbb \
+                                     stencil3d-vector-tbb sparse-vector-tbb
             $PRK_TARGET_PATH/p2p-innerloop-vector-tbb     10 1024
             $PRK_TARGET_PATH/p2p-hyperplane-vector-tbb    10 1024 1
             $PRK_TARGET_PATH/p2p-hyperplane-vector-tbb    10 1024 32
             $PRK_TARGET_PATH/p2p-tasks-tbb                10 1024 1024 32 32
             $PRK_TARGET_PATH/stencil-vector-tbb           10 1000
+            PRK_STENCIL_OBLIVIOUS=1 $PRK_TARGET_PATH/stencil-vector-tbb 10 1000
+            $PRK_TARGET_PATH/stencil3d-vector-tbb         10 100 32 star 2
             $PRK_TARGET_PATH/transpose-vector-tbb         10 1024 32
+            PRK_TRANSPOSE_OBLIVIOUS=1 $PRK_TARGET_PATH/transpose-vector-tbb 10 1024
             $PRK_TARGET_PATH/nstream-vector-tbb           10 16777216 32
+            $PRK_TARGET_PATH/sparse-vector-tbb            10 10 5
             #echo "Test stencil code generator"
             for s in star grid ; do
-                for r in 1 2 3 4 5 ; do
+                for r in 1 2 3 4 5 6 7 8 ; do
                     $PRK_TARGET_PATH/stencil-vector-tbb 10 200 20 $s $r
                 done
             done
@@ -550,7 +622,7 @@ case "$PRK_TARGET" in
             $PRK_TARGET_PATH/nstream-vector-pstl           10 16777216 32
             #echo "Test stencil code generator"
             for s in star grid ; do
-                for r in 1 2 3 4 5 ; do
+                for r in 1 2 3 4 5 6 7 8 ; do
                     $PRK_TARGET_PATH/stencil-vector-pstl 10 200 20 $s $r
                 done
             done
@@ -739,6 +811,9 @@ case "$PRK_TARGET" in
         $PRK_TARGET_PATH/nstream           10 16777216
         $PRK_TARGET_PATH/dgemm             10 400 400 # untiled
         $PRK_TARGET_PATH/dgemm             10 400 32
+        PRK_DGEMM_ISA=avx2 $PRK_TARGET_PATH/dgemm 10 401 32
+        PRK_DGEMM_ISA=none $PRK_TARGET_PATH/dgemm 10 401 32
+        PRK_DGEMM_PACKED=0 $PRK_TARGET_PATH/dgemm 10 400 32
 
         # Pretty
         ${MAKE} -C ${PRK_TARGET_PATH} stencil-pretty transpose-pretty nstream-pretty dgemm-pretty